@@ -0,0 +1,59 @@
+'use strict';
+
+// Compare two benchmark runs (output of bench/e2e.js or bench_signals, one JSON object per line).
+//
+//   node bench/compare.js base.jsonl head.jsonl
+//
+// Measurements are matched by their descriptive fields, every metric is printed with its
+// relative change from base to head.
+
+var fs = require('fs');
+
+// Numbers that are results rather than part of what was measured
+var METRICS = [ 'nsPerOp', 'nsPerFrame', 'rxFramesPerSec', 'txFramesPerSec', 'cpuUsPerFrame', 'dropRate' ];
+var IGNORED = [ 'commit', 'node', 'received', 'rxDropped', 'rxRingFull', 'latencyNs' ];
+
+function load(path) {
+    var results = new Map();
+
+    fs.readFileSync(path, 'utf8').split('\n').forEach(function(line) {
+        if (!line.trim()) return;
+
+        var record = JSON.parse(line);
+        var key = Object.keys(record)
+            .filter(function(k) { return METRICS.indexOf(k) < 0 && IGNORED.indexOf(k) < 0; })
+            .map(function(k) { return k + '=' + record[k]; })
+            .join(' ');
+
+        results.set(key, record);
+    });
+
+    return results;
+}
+
+function main() {
+    if (process.argv.length < 4) {
+        console.error('usage: node bench/compare.js base.jsonl head.jsonl');
+        process.exit(1);
+    }
+
+    var base = load(process.argv[2]);
+    var head = load(process.argv[3]);
+
+    head.forEach(function(record, key) {
+        var before = base.get(key);
+        if (!before) return;
+
+        METRICS.forEach(function(metric) {
+            if (typeof record[metric] !== 'number' || typeof before[metric] !== 'number') return;
+            if (!isFinite(record[metric]) || !isFinite(before[metric])) return;
+
+            var change = before[metric] ? (record[metric] - before[metric]) / before[metric] * 100 : 0;
+
+            console.log(key + ' ' + metric + ': ' + before[metric].toFixed(3) + ' -> ' +
+                        record[metric].toFixed(3) + ' (' + (change >= 0 ? '+' : '') + change.toFixed(1) + '%)');
+        });
+    });
+}
+
+main();
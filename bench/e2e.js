@@ -0,0 +1,172 @@
+'use strict';
+
+// End-to-end throughput of the receive and send paths over a virtual CAN interface.
+//
+//   node bench/e2e.js [--iface vcan0] [--frames 200000] [--burst 256] [--modes thread,poll,...]
+//
+// For every delivery mode one channel sends frames with sendRaw() through the native transmit
+// queue while another one receives them. Prints one JSON object per mode, see bench/compare.js.
+// Both channels live in this process, so cpuUsPerFrame covers sending and receiving.
+
+var can = require('../dist/socketcan');
+var childProcess = require('child_process');
+
+var MODES = {
+    thread:  { options: { rx_mode: 'thread' } },
+    poll:    { options: { rx_mode: 'poll' } },
+    reactor: { options: { rx_mode: 'reactor' } },
+    pooled:  { options: { rx_mode: 'thread', rx_pooled: true } },
+    batch:   { options: { rx_mode: 'thread' }, event: 'onBatch' }
+};
+
+var IDLE_TIMEOUT_MS = 1000;   // give up on frames not received by then
+
+function parseArgs(argv) {
+    var args = { iface: 'vcan0', frames: 200000, burst: 256, modes: Object.keys(MODES) };
+
+    for (var i = 2; i < argv.length; i += 2) {
+        var value = argv[i + 1];
+
+        switch (argv[i]) {
+            case '--iface':  args.iface = value; break;
+            case '--frames': args.frames = parseInt(value, 10); break;
+            case '--burst':  args.burst = parseInt(value, 10); break;
+            case '--modes':  args.modes = value.split(','); break;
+            default:
+                throw new Error('Unknown option ' + argv[i]);
+        }
+    }
+
+    args.modes.forEach(function(mode) {
+        if (!MODES[mode]) throw new Error('Unknown mode ' + mode);
+    });
+
+    return args;
+}
+
+function commit() {
+    try {
+        return childProcess.execSync('git rev-parse --short HEAD', { cwd: __dirname, stdio: ['ignore', 'pipe', 'ignore'] })
+            .toString().trim();
+    } catch (e) {
+        return null;
+    }
+}
+
+function run(args, name, done) {
+    var mode = MODES[name];
+    var options = Object.assign({ timestamps: true }, mode.options);
+
+    var rx = can.createRawChannelWithOptions(args.iface, options);
+    var tx = can.createRawChannelWithOptions(args.iface, { tx_queue_size: 4096 });
+
+    var received = 0;
+    var sent = 0;
+    var rxEnd = null;
+    var payload = Buffer.from([ 0, 1, 2, 3, 4, 5, 6, 7 ]);
+
+    function count(n) {
+        received += n;
+        if (received >= args.frames && !rxEnd) rxEnd = process.hrtime.bigint();
+    }
+
+    if (mode.event === 'onBatch')
+        rx.addListener('onBatch', function(batch) { count(batch.count); });
+    else
+        rx.addListener('onMessage', function() { count(1); });
+
+    rx.enableLatencyHistograms();
+    rx.start();
+    tx.start();
+
+    var cpu = process.cpuUsage();
+    var start = process.hrtime.bigint();
+    var txEnd = null;   // set once all frames are taken by the transmit queue
+
+    function send() {
+        var end = Math.min(args.frames, sent + args.burst);
+
+        while (sent < end) {
+            payload.writeUInt32LE(sent, 0);
+            sent++;
+
+            // Queue full, continue on onDrain
+            if (tx.sendRaw(0x100 + (sent & 0xFF), 0, payload) === false)
+                return;
+        }
+
+        if (sent < args.frames)
+            setImmediate(send);
+        else
+            txEnd = process.hrtime.bigint();
+    }
+
+    tx.addListener('onDrain', function() { setImmediate(send); });
+    setImmediate(send);
+
+    var lastReceived = 0;
+    var lastProgress = process.hrtime.bigint();
+
+    var check = setInterval(function() {
+        var now = process.hrtime.bigint();
+
+        if (received != lastReceived) {
+            lastReceived = received;
+            lastProgress = now;
+        }
+
+        var idle = now - lastProgress > BigInt(IDLE_TIMEOUT_MS) * 1000000n;
+
+        // Done, or nothing arrived for a while (frames lost or sending stalled)
+        if (!rxEnd && !idle)
+            return;
+
+        clearInterval(check);
+
+        var seconds = Number((rxEnd || lastProgress) - start) / 1e9;
+        var elapsed = process.cpuUsage(cpu);
+        var stats = rx.getStats();
+        var latency = rx.getLatencyHistograms();
+
+        rx.stop();
+        tx.stop();
+
+        var result = {
+            bench: 'e2e',
+            mode: name,
+            commit: commit(),
+            node: process.version,
+            frames: args.frames,
+            received: received,
+            rxFramesPerSec: seconds > 0 ? received / seconds : 0,
+            cpuUsPerFrame: (elapsed.user + elapsed.system) / args.frames,
+            dropRate: (args.frames - received) / args.frames,
+            rxDropped: stats.rxDropped,
+            rxRingFull: stats.rxRingFull,
+            latencyNs: latency
+        };
+
+        // Left out if sending stalled, there is no rate to compare then
+        if (txEnd && txEnd > start)
+            result.txFramesPerSec = sent / (Number(txEnd - start) / 1e9);
+
+        done(result);
+    }, 50);
+}
+
+function main() {
+    var args = parseArgs(process.argv);
+    var modes = args.modes.slice();
+
+    (function next() {
+        var name = modes.shift();
+        if (!name) return;
+
+        run(args, name, function(result) {
+            console.log(JSON.stringify(result));
+            next();
+        });
+    })();
+}
+
+main();
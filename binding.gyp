@@ -1,4 +1,7 @@
 {
+  "variables": {
+    "enable_bench%": 0
+  },
   "targets": [
     {
       "target_name": "can",
@@ -6,7 +9,7 @@
       "include_dirs": [
         "<!@(node -p \"require('node-addon-api').include_dir\")"
       ],
-      "defines": [ "NAPI_DISABLE_CPP_EXCEPTIONS" ],
+      "defines": [ "NAPI_DISABLE_CPP_EXCEPTIONS", "NAPI_VERSION=10" ],
       "cflags_cc": [ "-std=c++20" ]
     },
     {
@@ -18,5 +21,17 @@
       "defines": [ "NAPI_DISABLE_CPP_EXCEPTIONS" ],
       "cflags_cc": [ "-std=c++20" ]
     }
+  ],
+  "conditions": [
+    [ "enable_bench==1", {
+      "targets": [
+        {
+          "target_name": "bench_signals",
+          "type": "executable",
+          "sources": [ "native/bench_signals.cc" ],
+          "cflags_cc": [ "-std=c++20", "-O3" ]
+        }
+      ]
+    }]
   ]
 }
@@ -0,0 +1,174 @@
+/* Copyright Sebastian Haas <sebastian@sebastianhaas.info>. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Microbenchmarks of the signal codec. Built only on request:
+//   node-gyp rebuild -- -Denable_bench=1
+//   build/Release/bench_signals [iterations]
+// Prints one JSON object per measurement, see bench/compare.js.
+
+#include "signals_core.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#define BENCH_FRAMES       64       // payloads cycled through by the single value benchmarks
+#define BENCH_COLUMN_COUNT 65536    // frames per column kernel run
+
+// Sink for results, so the measured work is not optimized away
+static volatile uint64_t g_Sink;
+
+// Average time of op(i) for i in [0, iterations), after a short warm up
+template <typename Op>
+static double _ns_per_op(size_t iterations, Op&& op)
+{
+    for (size_t i = 0; i < iterations / 10; i++)
+        op(i);
+
+    auto start = std::chrono::steady_clock::now();
+
+    for (size_t i = 0; i < iterations; i++)
+        op(i);
+
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / iterations;
+}
+
+static const char* _endianess_name(ENDIANESS e)
+{
+    return e == ENDIANESS::INTEL ? "intel" : "motorola";
+}
+
+static const char* _type_name(SIGNAL_TYPE t)
+{
+    switch (t) {
+        case SIGNAL_TYPE::SIGNED:  return "signed";
+        case SIGNAL_TYPE::FLOAT32: return "float32";
+        case SIGNAL_TYPE::FLOAT64: return "float64";
+        default:                   return "unsigned";
+    }
+}
+
+static const char* _kernel_name(ColumnKernel kernel)
+{
+#ifdef HAVE_X86_KERNELS
+    if (kernel == _decode_column_avx2)
+        return "avx2";
+    if (kernel == _decode_column_sse41)
+        return "sse41";
+#endif
+    return "scalar";
+}
+
+// _getvalue() and _setvalue() across bit lengths, offsets and byte orders
+static void _bench_values(size_t iterations)
+{
+    static const uint32_t lengths[] = { 1, 8, 12, 16, 32, 64 };
+    static const uint32_t offsets[] = { 0, 3, 8, 29 };
+    static const ENDIANESS orders[] = { ENDIANESS::INTEL, ENDIANESS::MOTOROLA };
+
+    std::vector<uint8_t> frames(BENCH_FRAMES * 8);
+    for (size_t i = 0; i < frames.size(); i++)
+        frames[i] = static_cast<uint8_t>(i * 151 + 7);
+
+    for (ENDIANESS order : orders) {
+        for (uint32_t length : lengths) {
+            for (uint32_t offset : offsets) {
+                if (offset + length > 64)
+                    continue;
+
+                uint64_t sum = 0;
+                double get = _ns_per_op(iterations, [&](size_t i) {
+                    sum += _getvalue(&frames[(i % BENCH_FRAMES) * 8], offset, length, order);
+                });
+                g_Sink = sum;
+
+                double set = _ns_per_op(iterations, [&](size_t i) {
+                    _setvalue(offset, length, order, &frames[(i % BENCH_FRAMES) * 8], i);
+                });
+
+                printf("{\"bench\":\"getvalue\",\"endianess\":\"%s\",\"offset\":%u,\"bitLength\":%u,\"nsPerOp\":%.3f}\n",
+                       _endianess_name(order), offset, length, get);
+                printf("{\"bench\":\"setvalue\",\"endianess\":\"%s\",\"offset\":%u,\"bitLength\":%u,\"nsPerOp\":%.3f}\n",
+                       _endianess_name(order), offset, length, set);
+            }
+        }
+    }
+}
+
+// Column kernels, the scalar one against the one chosen for this CPU
+static void _bench_columns(size_t iterations)
+{
+    static const size_t strides[] = { 8, 64 };
+
+    const SignalLayout signals[] = {
+        { 4,  12, ENDIANESS::INTEL,    SIGNAL_TYPE::UNSIGNED, 0.5,  -40.0, 0.0, 0.0 },
+        { 16, 16, ENDIANESS::MOTOROLA, SIGNAL_TYPE::SIGNED,   0.01, 0.0,   0.0, 0.0 },
+        { 0,  32, ENDIANESS::INTEL,    SIGNAL_TYPE::FLOAT32,  1.0,  0.0,   0.0, 0.0 },
+        { 0,  64, ENDIANESS::INTEL,    SIGNAL_TYPE::FLOAT64,  1.0,  0.0,   0.0, 0.0 },
+        { 0,  64, ENDIANESS::INTEL,    SIGNAL_TYPE::UNSIGNED, 1.0,  0.0,   0.0, 0.0 },
+    };
+
+    const ColumnKernel dispatched = _select_column_kernel();
+    const size_t runs = std::max<size_t>(1, iterations / BENCH_COLUMN_COUNT);
+
+    std::vector<double> out(BENCH_COLUMN_COUNT);
+
+    for (size_t stride : strides) {
+        std::vector<uint8_t> frames(BENCH_COLUMN_COUNT * stride);
+        for (size_t i = 0; i < frames.size(); i++)
+            frames[i] = static_cast<uint8_t>(i * 151 + 7);
+
+        for (const SignalLayout& sl : signals) {
+            ColumnKernel kernels[] = { _decode_column_scalar, dispatched };
+
+            for (ColumnKernel kernel : kernels) {
+                // Signals the vector kernels cannot decode exactly go to the scalar one, see _decode_column()
+                if (kernel != _decode_column_scalar && !_column_vectorizable(sl, stride))
+                    break;
+
+                double ns = _ns_per_op(runs, [&](size_t) {
+                    kernel(frames.data(), stride, BENCH_COLUMN_COUNT, sl, out.data());
+                });
+                g_Sink = static_cast<uint64_t>(out[BENCH_COLUMN_COUNT - 1]);
+
+                printf("{\"bench\":\"column\",\"kernel\":\"%s\",\"type\":\"%s\",\"endianess\":\"%s\",\"bitLength\":%u,"
+                       "\"stride\":%zu,\"nsPerFrame\":%.3f}\n",
+                       _kernel_name(kernel), _type_name(sl.type), _endianess_name(sl.endianess), sl.bitLength,
+                       stride, ns / BENCH_COLUMN_COUNT);
+
+                if (dispatched == _decode_column_scalar)
+                    break;
+            }
+        }
+    }
+}
+
+int main(int argc, char** argv)
+{
+    size_t iterations = (argc > 1) ? strtoull(argv[1], nullptr, 10) : 10000000;
+
+    if (iterations == 0) {
+        fprintf(stderr, "usage: %s [iterations]\n", argv[0]);
+        return 1;
+    }
+
+    _bench_values(iterations);
+    _bench_columns(iterations);
+
+    return 0;
+}
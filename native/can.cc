@@ -28,21 +28,38 @@
 #include <stdlib.h>
 #include <unistd.h>
 #include <string.h>
+#include <errno.h>
 #include <assert.h>
 
 #include <pthread.h>
 
+#include <time.h>
+
 #include <sys/types.h>
 #include <sys/time.h>
 #include <sys/socket.h>
 #include <sys/ioctl.h>
 #include <sys/poll.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
 #include <net/if.h>
 
 #include <linux/can.h>
 #include <linux/can/raw.h>
+#include <linux/can/bcm.h>
+#include <linux/can/isotp.h>
+#include <linux/can/j1939.h>
 #include <linux/sockios.h>
+#include <linux/net_tstamp.h>
+#include <linux/errqueue.h>
 
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <memory>
 #include <vector>
 #include <string>
 
@@ -54,6 +71,13 @@
 
 #define MAX_FRAMES_PER_ASYNC_EVENT 100
 
+#define DEFAULT_RX_RING_SIZE 1024
+#define MIN_RX_RING_SIZE     64
+#define MAX_RX_RING_SIZE     (1 << 20)
+#define RX_BATCH_SIZE        64 // frames fetched per recvmmsg() call
+#define TX_BATCH_SIZE        64 // frames submitted per sendmmsg() call
+#define TX_RETRY_MS          1  // transmit queue retry interval after ENOBUFS
+
 #define likely(x)   __builtin_expect( x , 1)
 #define unlikely(x) __builtin_expect( x , 0)
 
@@ -64,650 +88,6857 @@
 
 //-----------------------------------------------------------------------------------------
 /**
- * A Raw channel to access a certain CAN channel (e.g. vcan0) via CAN messages.
- * @class RawChannel
+ * One received frame as stored in the receive ring.
  */
-class RawChannel : public Napi::ObjectWrap<RawChannel>
+struct rx_slot
+{
+  struct canfd_frame frame;
+  uint32_t           mtu;    // CAN_MTU or CANFD_MTU as returned by the kernel
+  uint64_t           ts_ns;  // kernel receive timestamp in ns, 0 if not available
+  uint64_t           read_ns;// CLOCK_REALTIME when the reader thread fetched the frame, 0 unless latency is measured
+};
+
+/**
+ * Source of receive timestamps
+ */
+enum TimestampMode
+{
+  TIMESTAMPS_NONE = 0,
+  TIMESTAMPS_SOFTWARE,  // SO_TIMESTAMPNS, taken by the kernel when the frame is queued
+  TIMESTAMPS_HARDWARE,  // SO_TIMESTAMPING, taken by the controller if the driver supports it
+};
+
+/**
+ * How a channel waits for received frames
+ */
+enum RxMode
+{
+  RX_MODE_THREAD = 0,   // dedicated reader thread per channel
+  RX_MODE_POLL,         // uv_poll on the socket, frames are received on the event loop thread
+  RX_MODE_REACTOR,      // shared epoll reactor, see RxReactor
+};
+
+/**
+ * What a full transmit queue does with another frame
+ */
+enum TxOverflow
+{
+  TX_OVERFLOW_REJECT = 0,   // send() throws, nothing is dropped
+  TX_OVERFLOW_DROP_NEWEST,  // the new frame is dropped
+  TX_OVERFLOW_DROP_OLDEST,  // the oldest queued frame is dropped to make room
+};
+
+// Size of the control buffer needed for a timestamp plus the SO_RXQ_OVFL drop counter
+#define RX_CTRL_SIZE (CMSG_SPACE(sizeof(struct scm_timestamping)) + CMSG_SPACE(sizeof(uint32_t)))
+
+/**
+ * Counters reported by getStats(), see ChannelStatNames for their meaning
+ */
+enum ChannelStat
+{
+  STAT_RX_FRAMES = 0,
+  STAT_RX_BYTES,
+  STAT_RX_DROPPED,
+  STAT_RX_RING_FULL,
+  STAT_TX_FRAMES,
+  STAT_TX_EAGAIN,
+  STAT_TX_ENOBUFS,
+  STAT_TX_ERRORS,
+  STAT_TX_QUEUE_DROPPED,
+  STAT_WAKEUPS,
+  STAT_WAKEUP_FRAMES,
+  STAT_WAKEUP_FRAMES_MAX,
+  STAT_WAKEUPS_TRUNCATED,
+  STAT_CALLBACK_ERRORS,
+  STAT_COUNT
+};
+
+static const char *ChannelStatNames[STAT_COUNT] = {
+  "rxFrames",          // frames received from the socket
+  "rxBytes",           // payload bytes received
+  "rxDropped",         // frames dropped by the kernel because the socket queue was full (SO_RXQ_OVFL)
+  "rxRingFull",        // times the reader thread had to wait for JS to drain the receive ring
+  "txFrames",          // frames accepted by the kernel
+  "txEagain",          // transmissions failed with EAGAIN (non-blocking send, queue full)
+  "txEnobufs",         // transmissions failed with ENOBUFS (device queue full)
+  "txErrors",          // transmissions failed for any other reason
+  "txQueueDropped",    // frames dropped by the overflow policy of a full transmit queue
+  "wakeups",           // main thread dispatch rounds
+  "wakeupFrames",      // frames handled by all dispatch rounds
+  "wakeupFramesMax",   // most frames handled by a single dispatch round
+  "wakeupsTruncated",  // dispatch rounds cut short by MAX_FRAMES_PER_ASYNC_EVENT
+  "callbackErrors",    // exceptions thrown by listeners
+};
+
+/**
+ * Bounded lock-free single-producer/single-consumer ring of received frames.
+ *
+ * The reader thread receives directly into free slots (see WritableSlots()) and
+ * publishes them with Commit(); the main thread consumes them with At()/Release().
+ */
+class RxRing
 {
 public:
-  static Napi::Object Init(Napi::Env env, Napi::Object exports)
+  explicit RxRing(size_t size)
+    : m_Head(0), m_Tail(0)
   {
-    Napi::Function func = DefineClass(env, "RawChannel", {
-      InstanceMethod("addListener",     &RawChannel::AddListener),
-      InstanceMethod("start",           &RawChannel::Start),
-      InstanceMethod("stop",            &RawChannel::Stop),
-      InstanceMethod("send",            &RawChannel::Send),
-      InstanceMethod("sendFD",          &RawChannel::SendFD),
-      InstanceMethod("setRxFilters",    &RawChannel::SetRxFilters),
-      InstanceMethod("setErrorFilters", &RawChannel::SetErrorFilters),
-      InstanceMethod("disableLoopback", &RawChannel::DisableLoopback),
-    });
+    size_t capacity = MIN_RX_RING_SIZE;
+    while (capacity < size && capacity < MAX_RX_RING_SIZE)
+      capacity <<= 1;
 
-    exports.Set("RawChannel", func);
-    return exports;
+    m_Slots.resize(capacity);
+    m_Mask = capacity - 1;
   }
 
-  /**
-   * Create a new CAN channel object
-   * @constructor RawChannel
-   * @param interface {string} interface name to create channel on (e.g. can0)
-   * @return new RawChannel object
-   */
-  explicit RawChannel(const Napi::CallbackInfo& info)
-    : Napi::ObjectWrap<RawChannel>(info),
-      m_Thread(0), m_Name(""), m_ReadPending(false), m_SocketFd(-1),
-      m_ThreadStopRequested(false), m_TimestampsSupported(false),
-      m_NonBlockingSend(false), m_napi_env(nullptr), m_async_ctx(nullptr)
-  {
-    Napi::Env env = info.Env();
+  size_t Capacity() const { return m_Mask + 1; }
 
-    if (!info.IsConstructCall()) {
-      Napi::Error::New(env, "Must be called with new").ThrowAsJavaScriptException();
-      return;
-    }
-    if (info.Length() < 1) {
-      Napi::Error::New(env, "Too few arguments").ThrowAsJavaScriptException();
-      return;
-    }
-    if (!info[0].IsString()) {
-      Napi::Error::New(env, "First argument must be a string").ThrowAsJavaScriptException();
-      return;
-    }
+  // Producer: number of contiguous free slots starting at *first
+  size_t WritableSlots(struct rx_slot **first)
+  {
+    size_t head = m_Head.load(std::memory_order_relaxed);
+    size_t tail = m_Tail.load(std::memory_order_acquire);
+    size_t free = Capacity() - (head - tail);
+    size_t contiguous = Capacity() - (head & m_Mask);
 
-    m_napi_env = env;
+    *first = &m_Slots[head & m_Mask];
+    return free < contiguous ? free : contiguous;
+  }
 
-    std::string name = info[0].As<Napi::String>().Utf8Value();
-    m_Name = name;
+  bool Full() const
+  {
+    return m_Head.load(std::memory_order_relaxed) - m_Tail.load(std::memory_order_acquire) >= Capacity();
+  }
 
-    bool timestamps     = false;
-    int  protocol       = CAN_RAW;
-    bool non_block_send = false;
+  // Producer: publish n slots previously obtained via WritableSlots()
+  void Commit(size_t n) { m_Head.store(m_Head.load(std::memory_order_relaxed) + n, std::memory_order_release); }
 
-    if (info.Length() >= 2 && info[1].IsBoolean())
-      timestamps = info[1].As<Napi::Boolean>().Value();
+  // Consumer: number of slots ready to be read
+  size_t Readable() const { return m_Head.load(std::memory_order_acquire) - m_Tail.load(std::memory_order_relaxed); }
 
-    if (info.Length() >= 3 && info[2].IsNumber())
-      protocol = info[2].As<Napi::Number>().Int32Value();
+  // Consumer: i-th readable slot
+  struct rx_slot &At(size_t i) { return m_Slots[(m_Tail.load(std::memory_order_relaxed) + i) & m_Mask]; }
 
-    if (info.Length() >= 4 && info[3].IsBoolean())
-      non_block_send = info[3].As<Napi::Boolean>().Value();
+  // Consumer: hand n slots back to the producer
+  void Release(size_t n) { m_Tail.store(m_Tail.load(std::memory_order_relaxed) + n, std::memory_order_release); }
 
-    m_TimestampsSupported = timestamps;
-    m_NonBlockingSend     = non_block_send;
+private:
+  std::vector<struct rx_slot> m_Slots;
+  size_t m_Mask;
 
-    const int canfd_on = 1;
-    m_SocketFd = socket(PF_CAN, SOCK_RAW, protocol);
+  alignas(64) std::atomic<size_t> m_Head;
+  alignas(64) std::atomic<size_t> m_Tail;
+};
 
-    if (m_SocketFd > 0)
-    {
-      can_err_mask_t err_mask;
-      struct ifreq ifr;
+/**
+ * Log-linear latency histogram in the spirit of HdrHistogram: values below 64 ns have their own
+ * bucket, above that each power of two is split into 32 buckets (about 3% resolution).
+ * Not thread safe, only used from the main thread.
+ */
+class LatencyHistogram
+{
+public:
+  LatencyHistogram() { Reset(); }
 
-      memset(&ifr, 0, sizeof(ifr));
-      strncpy(ifr.ifr_name, name.c_str(), IFNAMSIZ - 1);
-      if (ioctl(m_SocketFd, SIOCGIFINDEX, &ifr) != 0)
-        goto on_error;
+  void Reset()
+  {
+    memset(m_Counts, 0, sizeof(m_Counts));
+    m_Total = 0;
+    m_Max   = 0;
+  }
 
-      err_mask = CAN_ERR_MASK;
+  void Record(uint64_t value_ns, uint64_t count = 1)
+  {
+    m_Counts[IndexOf(value_ns)] += count;
+    m_Total += count;
+    if (value_ns > m_Max)
+      m_Max = value_ns;
+  }
 
-      setsockopt(m_SocketFd, SOL_CAN_RAW, CAN_RAW_FD_FRAMES, &canfd_on, sizeof(canfd_on));
+  uint64_t Count() const { return m_Total; }
+  uint64_t Max() const { return m_Max; }
 
-      if (setsockopt(m_SocketFd, SOL_CAN_RAW, CAN_RAW_ERR_FILTER, &err_mask, sizeof(err_mask)) != 0)
-        goto on_error;
+  // Upper bound of the bucket holding the given quantile (0..1), never above Max()
+  uint64_t Percentile(double quantile) const
+  {
+    if (m_Total == 0)
+      return 0;
 
-      memset(&m_SocketAddr, 0, sizeof(m_SocketAddr));
-      m_SocketAddr.can_family  = PF_CAN;
-      m_SocketAddr.can_ifindex = ifr.ifr_ifindex;
+    uint64_t rank = (uint64_t)(quantile * (double)m_Total + 0.5);
+    if (rank < 1)
+      rank = 1;
 
-      if (bind(m_SocketFd, (struct sockaddr *)&m_SocketAddr, sizeof(m_SocketAddr)) < 0)
-        goto on_error;
+    uint64_t seen = 0;
+    for (size_t i = 0; i < BUCKETS; i++)
+    {
+      seen += m_Counts[i];
+      if (seen >= rank)
+        return UpperBoundOf(i) < m_Max ? UpperBoundOf(i) : m_Max;
+    }
 
-      pthread_mutex_init(&m_ReadPendingMtx, NULL);
-      pthread_cond_init(&m_ReadPendingCond, NULL);
+    return m_Max;
+  }
 
-      return;
+private:
+  static const size_t LINEAR  = 64;
+  static const size_t SUB     = 32;
+  static const size_t BUCKETS = LINEAR + 58 * SUB;
 
-      on_error:
-      close(m_SocketFd);
-      m_SocketFd = -1;
-    }
+  static size_t IndexOf(uint64_t v)
+  {
+    if (v < LINEAR)
+      return v;
 
-    if (!IsValid()) {
-      Napi::Error::New(env, "Error while creating channel").ThrowAsJavaScriptException();
-    }
+    unsigned shift = 63 - __builtin_clzll(v) - 5;   // keeps the top 6 bits, 32..63
+    return LINEAR + (shift - 1) * SUB + ((v >> shift) - SUB);
   }
 
-  ~RawChannel()
+  static uint64_t UpperBoundOf(size_t index)
   {
-    for (size_t i = 0; i < m_OnMessageListeners.size(); i++)
-      delete m_OnMessageListeners.at(i);
-    m_OnMessageListeners.clear();
+    if (index < LINEAR)
+      return index;
 
-    for (size_t i = 0; i < m_OnChannelStoppedListeners.size(); i++)
-      delete m_OnChannelStoppedListeners.at(i);
-    m_OnChannelStoppedListeners.clear();
+    unsigned shift = (index - LINEAR) / SUB + 1;
+    uint64_t top   = (index - LINEAR) % SUB + SUB;
+    return ((top + 1) << shift) - 1;
+  }
 
-    if (m_SocketFd >= 0)
-      close(m_SocketFd);
+  uint64_t m_Counts[BUCKETS];
+  uint64_t m_Total;
+  uint64_t m_Max;
+};
 
-    if (m_Thread)
-      stopThread();
-  }
+/**
+ * Stages of the receive path covered by the latency histograms
+ */
+enum LatencyStage
+{
+  LATENCY_KERNEL_TO_THREAD = 0, // kernel timestamp -> reader thread fetched the frame (software timestamps only)
+  LATENCY_THREAD_TO_DISPATCH,   // reader thread -> main thread starts dispatching the frame
+  LATENCY_DISPATCH_TO_RETURN,   // dispatch start -> all listeners returned
+  LATENCY_STAGE_COUNT
+};
 
-private:
-  /**
-   * Add listener to receive certain notifications
-   * @method addListener
-   * @param event {string} onMessage to register for incoming messages
-   * @param callback {any} JS callback object
-   * @param instance {any} Optional instance pointer to call callback
-   */
-  Napi::Value AddListener(const Napi::CallbackInfo& info)
-  {
-    Napi::Env env = info.Env();
-    CHECK_CONDITION(info.Length() >= 2, "Too few arguments");
-    CHECK_CONDITION(info[0].IsString(), "First argument must be a string");
-    CHECK_CONDITION(info[1].IsFunction(), "Second argument must be a function");
+static const char *LatencyStageNames[LATENCY_STAGE_COUNT] = {
+  "kernelToThread",
+  "threadToDispatch",
+  "dispatchToReturn",
+};
 
-    std::string event = info[0].As<Napi::String>().Utf8Value();
+static uint64_t RealtimeNs()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_REALTIME, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
 
-    struct listener *l = new struct listener;
-    l->callback = Napi::Persistent(info[1].As<Napi::Function>());
+/**
+ * Open-addressing hash table (linear probing) from CAN identifier to a value pointer.
+ *
+ * Keys are the 29/11 bit identifier plus CAN_EFF_FLAG, see IdKeyOf(). Removed entries leave a
+ * tombstone that a later Insert() reuses. The table does not own the values.
+ */
+template <typename T>
+class IdTable
+{
+public:
+  IdTable() : m_Count(0), m_Used(0) { m_Slots.resize(64); }
 
-    if (info.Length() >= 3 && info[2].IsObject())
-      l->handle = Napi::Persistent(info[2].As<Napi::Object>());
+  T *Find(canid_t key) const
+  {
+    size_t mask = m_Slots.size() - 1;
 
-    if (event == "onMessage")
-      m_OnMessageListeners.push_back(l);
-    else if (event == "onStopped")
-      m_OnChannelStoppedListeners.push_back(l);
-    else {
-      delete l;
-      Napi::Error::New(env, "Event not supported").ThrowAsJavaScriptException();
-      return env.Undefined();
+    for (size_t i = Hash(key) & mask;; i = (i + 1) & mask)
+    {
+      const struct slot &s = m_Slots[i];
+      if (!s.value && !s.removed)
+        return nullptr;
+      if (s.value && s.key == key)
+        return s.value;
     }
+  }
 
-    return info.This();
+  // key must not be in the table yet
+  void Insert(canid_t key, T *value)
+  {
+    // Keep the load factor (tombstones included) at or below 1/2 so probe sequences stay short
+    if (2 * (m_Used + 1) > m_Slots.size())
+      Rehash(2 * (m_Count + 1) > m_Slots.size() / 2 ? m_Slots.size() * 2 : m_Slots.size());
+
+    if (!Place(key, value))
+      m_Used++;
+    m_Count++;
   }
 
   /**
-   * Start operation on this CAN channel
-   * @method start
+   * Remove key
+   * @return its value, nullptr if key was not in the table
    */
-  Napi::Value Start(const Napi::CallbackInfo& info)
+  T *Remove(canid_t key)
   {
-    CHECK_CONDITION(IsValid(), "Cannot start invalid channel");
+    size_t mask = m_Slots.size() - 1;
 
-    Napi::Env env = info.Env();
-    uv_loop_t* loop;
-    napi_get_uv_event_loop(env, &loop);
+    for (size_t i = Hash(key) & mask;; i = (i + 1) & mask)
+    {
+      struct slot &s = m_Slots[i];
+      if (!s.value && !s.removed)
+        return nullptr;
 
-    uv_async_init(loop, &m_AsyncReceiverReady, async_receiver_ready_cb);
-    m_AsyncReceiverReady.data = this;
+      if (s.value && s.key == key)
+      {
+        T *value = s.value;
+        s.value   = nullptr;
+        s.removed = true;
+        m_Count--;
+        return value;
+      }
+    }
+  }
 
-    uv_async_init(loop, &m_AsyncChannelStopped, async_channel_stopped_cb);
-    m_AsyncChannelStopped.data = this;
+  bool Empty() const { return m_Count == 0; }
 
-    // Create an async context so napi_make_callback runs microtask checkpoints
-    // and fires async hooks after each onMessage callback, matching the behaviour
-    // of the old NaN implementation (which used node::MakeCallback internally).
-    napi_value resource_name;
-    napi_create_string_utf8(env, "socketcan:RawChannel:onMessage", NAPI_AUTO_LENGTH, &resource_name);
-    napi_async_init(env, (napi_value)info.This(), resource_name, &m_async_ctx);
+  template <typename F> void ForEach(F fn) const
+  {
+    for (const struct slot &s : m_Slots)
+      if (s.value)
+        fn(s.value);
+  }
 
-    m_ThreadStopRequested = false;
-    pthread_create(&m_Thread, NULL, c_thread_entry, this);
+private:
+  struct slot
+  {
+    canid_t key;
+    T      *value;    // nullptr marks a free slot or a tombstone
+    bool    removed;  // tombstone, probing continues behind it
+  };
 
-    CHECK_CONDITION(m_Thread, "Error starting dispatch thread");
+  static size_t Hash(canid_t key) { return (size_t)(key * 0x9E3779B1u) >> 7; }
 
-    Ref();
+  // Store into the first free slot or tombstone of the probe sequence, true for a tombstone
+  bool Place(canid_t key, T *value)
+  {
+    size_t mask = m_Slots.size() - 1;
+    size_t i = Hash(key) & mask;
 
-    return info.This();
+    while (m_Slots[i].value)
+      i = (i + 1) & mask;
+
+    bool reused = m_Slots[i].removed;
+
+    m_Slots[i].key     = key;
+    m_Slots[i].value   = value;
+    m_Slots[i].removed = false;
+    return reused;
   }
 
-  /**
-   * Stop any operations on this CAN channel
-   * @method stop
-   */
-  Napi::Value Stop(const Napi::CallbackInfo& info)
+  // Rebuild with size slots, dropping the tombstones
+  void Rehash(size_t size)
   {
-    CHECK_CONDITION(m_Thread, "Channel not started");
-    async_channel_stopped();
-    return info.This();
+    std::vector<struct slot> old(size);
+    old.swap(m_Slots);
+
+    for (const struct slot &s : old)
+      if (s.value)
+        Place(s.key, s.value);
+
+    m_Used = m_Count;
   }
 
+  std::vector<struct slot> m_Slots;
+  size_t m_Count;   // entries
+  size_t m_Used;    // entries and tombstones
+};
+
+/**
+ * JS callbacks registered for one event with addListener(), owned by the list. Listeners added
+ * or removed by a callback are seen by the invocation in progress.
+ */
+class ListenerList
+{
+public:
+  ListenerList() : m_Live(0), m_Calls(0) {}
+  ~ListenerList() { Clear(); }
+
+  ListenerList(const ListenerList &) = delete;
+  ListenerList &operator=(const ListenerList &) = delete;
+
   /**
-   * Send a CAN message immediately.
-   *
-   * PLEASE NOTE: By default, this function may block if the Tx buffer is not available. Please use
-   * createRawChannelWithOptions({non_block_send: false}) to get non-blocking sending activated.
-   *
-   * @method send
-   * @param message {Object} JSON object describing the CAN message, keys are id, length, data {Buffer}, ext or rtr
+   * Append callback, invoked on handle if that is an object and on the global object otherwise
    */
-  Napi::Value Send(const Napi::CallbackInfo& info)
+  void Add(Napi::Function callback, Napi::Value handle)
   {
-    Napi::Env env = info.Env();
-    CHECK_CONDITION(info.Length() >= 1, "Invalid arguments");
-    CHECK_CONDITION(info[0].IsObject(), "First argument must be an Object");
-    CHECK_CONDITION(IsValid(), "Invalid channel!");
-
-    struct can_frame frame;
-    Napi::Object obj = info[0].As<Napi::Object>();
-
-    frame.can_id = obj.Get("id").As<Napi::Number>().Uint32Value();
+    struct listener *l = new struct listener;
+    l->callback = Napi::Persistent(callback);
 
-    if (obj.Get("ext").ToBoolean().Value())
-      frame.can_id |= CAN_EFF_FLAG;
+    if (handle.IsObject())
+      l->handle = Napi::Persistent(handle.As<Napi::Object>());
 
-    if (obj.Get("rtr").ToBoolean().Value())
-      frame.can_id |= CAN_RTR_FLAG;
+    l->removed = false;
 
-    Napi::Value dataArg = obj.Get("data");
-    CHECK_CONDITION(dataArg.IsBuffer(), "Data field must be a Buffer");
+    m_Listeners.push_back(l);
+    m_Live++;
+  }
 
-    Napi::Buffer<uint8_t> dataBuf = dataArg.As<Napi::Buffer<uint8_t>>();
-    CHECK_CONDITION(dataBuf.ByteLength() <= sizeof(frame.data), "Data field too long for a CAN frame (max 8 bytes)");
-    frame.can_dlc = dataBuf.ByteLength();
-    memcpy(frame.data, dataBuf.Data(), frame.can_dlc);
+  /**
+   * Remove the listeners of callback, all of them if it is not a function. While the list is
+   * invoked they are only marked, so that the invocation does not skip the next one.
+   */
+  void Remove(Napi::Value callback)
+  {
+    bool all = !callback.IsFunction();
 
+    for (struct listener *l : m_Listeners)
     {
-      struct timeval now;
-      if (gettimeofday(&now, 0) == 0) {
-        obj.Set("ts_sec",  Napi::Number::New(env, (int32_t)now.tv_sec));
-        obj.Set("ts_usec", Napi::Number::New(env, (int32_t)now.tv_usec));
+      if (!l->removed && (all || l->callback.Value().StrictEquals(callback)))
+      {
+        l->removed = true;
+        m_Live--;
       }
     }
 
+    if (!m_Calls)
+      Compact();
+  }
+
+  void Clear()
+  {
+    for (struct listener *l : m_Listeners)
+      delete l;
+    m_Listeners.clear();
+    m_Live = 0;
+  }
+
+  bool Empty() const { return m_Live == 0; }
+
+  // An invocation of this list is in progress
+  bool Calling() const { return m_Calls > 0; }
+
+  /**
+   * Invoke every listener with arg, or without argument if arg is nullptr
+   * @return false if a callback threw (the exception has been forwarded to Node.js)
+   */
+  bool Call(Napi::Env env, napi_async_context ctx, napi_value arg)
+  {
+    m_Calls++;
+    bool ok = CallEach(env, ctx, arg);
+
+    if (--m_Calls == 0)
+      Compact();
+    return ok;
+  }
+
+  /**
+   * Hand an exception thrown by a callback to Node.js as uncaught exception
+   * @return false if there was one
+   */
+  static bool ForwardException(Napi::Env env)
+  {
+    if (!env.IsExceptionPending())
+      return true;
+
+    napi_value exception;
+    napi_get_and_clear_last_exception(env, &exception);
+    napi_fatal_exception(env, exception);
+    return false;
+  }
+
+private:
+  struct listener {
+    Napi::FunctionReference callback;
+    Napi::ObjectReference   handle;
+    bool                    removed;
+  };
+
+  bool CallEach(Napi::Env env, napi_async_context ctx, napi_value arg)
+  {
+    for (size_t i = 0; i < m_Listeners.size(); i++)
+    {
+      struct listener *l = m_Listeners[i];
+      if (l->removed)
+        continue;
+
+      // Use napi_make_callback instead of plain fn.Call() so that
+      // Node.js runs a microtask checkpoint and fires async hooks
+      // after each invocation, matching the old NaN behaviour
+      // (Nan::Callback::Call used node::MakeCallback internally).
+      napi_value recv_val = l->handle.IsEmpty()
+          ? (napi_value)env.Global()
+          : (napi_value)l->handle.Value();
+      napi_value fn_val   = (napi_value)l->callback.Value();
+      napi_value result;
+      napi_make_callback(env, ctx, recv_val, fn_val, arg ? 1 : 0, arg ? &arg : NULL, &result);
+
+      if (!ForwardException(env))
+        return false;
+    }
+
+    return true;
+  }
+
+  // Free the listeners marked as removed
+  void Compact()
+  {
+    size_t kept = 0;
+
+    for (struct listener *l : m_Listeners)
+    {
+      if (l->removed)
+        delete l;
+      else
+        m_Listeners[kept++] = l;
+    }
+
+    m_Listeners.resize(kept);
+  }
+
+  std::vector<struct listener *> m_Listeners;
+  size_t m_Live;    // listeners not marked as removed
+  int    m_Calls;   // nested invocations in progress
+};
+
+/**
+ * One frame to be transmitted
+ */
+struct tx_frame
+{
+  struct canfd_frame frame;
+  uint32_t           mtu;    // CAN_MTU or CANFD_MTU, selects classic or FD transmission
+};
+
+/**
+ * Bounded FIFO of frames waiting for room in the socket, only touched by the main thread
+ */
+class TxQueue
+{
+public:
+  explicit TxQueue(size_t size)
+    : m_Slots(size), m_Head(0), m_Count(0)
+  {
+  }
+
+  size_t Size() const { return m_Count; }
+  bool   Empty() const { return m_Count == 0; }
+  bool   Full() const { return m_Count == m_Slots.size(); }
+
+  void Push(const struct tx_frame &frame)
+  {
+    m_Slots[(m_Head + m_Count) % m_Slots.size()] = frame;
+    m_Count++;
+  }
+
+  // Oldest frame and the number of frames stored contiguously behind it
+  struct tx_frame *Head() { return &m_Slots[m_Head]; }
+  size_t Contiguous() const { return std::min(m_Count, m_Slots.size() - m_Head); }
+
+  // Remove the count oldest frames
+  void Release(size_t count)
+  {
+    m_Head   = (m_Head + count) % m_Slots.size();
+    m_Count -= count;
+  }
+
+private:
+  std::vector<struct tx_frame> m_Slots;
+  size_t m_Head;
+  size_t m_Count;
+};
+
+//-----------------------------------------------------------------------------------------
+/**
+ * Per-frame flags as used in the columnar batch representation
+ */
+enum FrameFlags
+{
+  FRAME_FLAG_EXT = 0x01,
+  FRAME_FLAG_RTR = 0x02,
+  FRAME_FLAG_ERR = 0x04,
+  FRAME_FLAG_FD  = 0x08,
+  FRAME_FLAG_BRS = 0x10,
+  FRAME_FLAG_ESI = 0x20,
+};
+
+/**
+ * Raw pointers into the columns of a batch created by NewFrameBatch()
+ */
+struct frame_batch
+{
+  uint64_t *ts_ns;
+  uint32_t *ids;
+  uint8_t  *flags;
+  uint8_t  *lens;
+  uint8_t  *data;   // count * stride bytes
+  size_t    stride;
+};
+
+/**
+ * Allocate a columnar batch of count frames backed by one ArrayBuffer:
+ *
+ *   { count, stride, buffer, tsNs: BigUint64Array, ids: Uint32Array,
+ *     flags: Uint8Array, lens: Uint8Array, data: Uint8Array }
+ *
+ * The payload of frame i starts at data[i * stride].
+ */
+static Napi::Object NewFrameBatch(Napi::Env env, size_t count, size_t stride, struct frame_batch *batch)
+{
+  size_t ts_off    = 0;
+  size_t ids_off   = ts_off + count * sizeof(uint64_t);
+  size_t flags_off = ids_off + count * sizeof(uint32_t);
+  size_t lens_off  = flags_off + count;
+  size_t data_off  = (lens_off + count + 7) & ~(size_t)7;
+  size_t total     = data_off + count * stride;
+
+  Napi::ArrayBuffer buffer = Napi::ArrayBuffer::New(env, total);
+  uint8_t *base = static_cast<uint8_t *>(buffer.Data());
+
+  batch->ts_ns  = reinterpret_cast<uint64_t *>(base + ts_off);
+  batch->ids    = reinterpret_cast<uint32_t *>(base + ids_off);
+  batch->flags  = base + flags_off;
+  batch->lens   = base + lens_off;
+  batch->data   = base + data_off;
+  batch->stride = stride;
+
+  Napi::Object obj = Napi::Object::New(env);
+  obj.Set("count",  Napi::Number::New(env, count));
+  obj.Set("stride", Napi::Number::New(env, stride));
+  obj.Set("buffer", buffer);
+  obj.Set("tsNs",   Napi::BigUint64Array::New(env, count, buffer, ts_off, napi_biguint64_array));
+  obj.Set("ids",    Napi::Uint32Array::New(env, count, buffer, ids_off, napi_uint32_array));
+  obj.Set("flags",  Napi::Uint8Array::New(env, count, buffer, flags_off, napi_uint8_array));
+  obj.Set("lens",   Napi::Uint8Array::New(env, count, buffer, lens_off, napi_uint8_array));
+  obj.Set("data",   Napi::Uint8Array::New(env, count * stride, buffer, data_off, napi_uint8_array));
+
+  return obj;
+}
+
+//-----------------------------------------------------------------------------------------
+#define RX_SLAB_SIZE     (MAX_FRAMES_PER_ASYNC_EVENT * CANFD_MAX_DLEN) // payloads of one wakeup
+#define RX_SLAB_POOL_MAX 32                                            // free slabs kept per channel
+
+class RxSlabPool;
+
+/**
+ * Backing store of the payload Buffers handed to JS in one wakeup
+ */
+struct rx_slab
+{
+  std::shared_ptr<RxSlabPool> pool;   // set while JS owns the slab
+  uint8_t data[RX_SLAB_SIZE];
+};
+
+/**
+ * Recycles the slabs of a channel with pooled receive buffers. A slab returns once V8
+ * collected the ArrayBuffer (and thereby every payload view) of its wakeup, so a slab is
+ * only ever reused when no JS object refers to it any more.
+ */
+class RxSlabPool : public std::enable_shared_from_this<RxSlabPool>
+{
+public:
+  RxSlabPool() { pthread_mutex_init(&m_Mutex, NULL); }
+
+  ~RxSlabPool()
+  {
+    for (size_t i = 0; i < m_Free.size(); i++)
+      delete m_Free[i];
+
+    pthread_mutex_destroy(&m_Mutex);
+  }
+
+  /**
+   * An empty slab wrapped into an ArrayBuffer that returns it to the pool when collected
+   */
+  Napi::ArrayBuffer Acquire(Napi::Env env, struct rx_slab **slab)
+  {
+    struct rx_slab *s = nullptr;
+
+    pthread_mutex_lock(&m_Mutex);
+    if (!m_Free.empty())
+    {
+      s = m_Free.back();
+      m_Free.pop_back();
+    }
+    pthread_mutex_unlock(&m_Mutex);
+
+    if (!s)
+      s = new rx_slab();
+
+    s->pool = shared_from_this();
+    *slab = s;
+
+    return Napi::ArrayBuffer::New(env, s->data, sizeof(s->data), Release, s);
+  }
+
+private:
+  // Finalizer of the ArrayBuffer, the pool reference is dropped last as it may be the final one
+  static void Release(Napi::Env env, void *data, struct rx_slab *slab)
+  {
+    std::shared_ptr<RxSlabPool> pool = std::move(slab->pool);
+
+    pthread_mutex_lock(&pool->m_Mutex);
+    if (pool->m_Free.size() < RX_SLAB_POOL_MAX)
+    {
+      pool->m_Free.push_back(slab);
+      slab = nullptr;
+    }
+    pthread_mutex_unlock(&pool->m_Mutex);
+
+    delete slab;
+  }
+
+  pthread_mutex_t         m_Mutex;  // finalizers are not guaranteed to run on the main thread
+  std::vector<rx_slab *>  m_Free;
+};
+
+/**
+ * Slab filled by the current wakeup of a channel with pooled receive buffers
+ */
+struct rx_slab_cursor
+{
+  Napi::ArrayBuffer buffer;   // empty until the first payload
+  struct rx_slab   *slab;
+  size_t            used;
+};
+
+static uint8_t FrameFlagsOf(const struct canfd_frame &frame, bool fd)
+{
+  uint8_t flags = 0;
+
+  if (frame.can_id & CAN_EFF_FLAG) flags |= FRAME_FLAG_EXT;
+  if (frame.can_id & CAN_RTR_FLAG) flags |= FRAME_FLAG_RTR;
+  if (frame.can_id & CAN_ERR_FLAG) flags |= FRAME_FLAG_ERR;
+
+  if (fd)
+  {
+    flags |= FRAME_FLAG_FD;
+    if (frame.flags & CANFD_BRS) flags |= FRAME_FLAG_BRS;
+    if (frame.flags & CANFD_ESI) flags |= FRAME_FLAG_ESI;
+  }
+
+  return flags;
+}
+
+// Ensure discrete CAN FD length values 0..8, 12, 16, 20, 24, 32, 48, 64 bytes cf ISO11898-1
+static uint8_t CanFdLen(size_t len)
+{
+  static const unsigned char len2dlc[] = {0, 1, 2, 3, 4, 5, 6, 7, 8,
+      12, 12, 12, 12,
+      16, 16, 16, 16,
+      20, 20, 20, 20,
+      24, 24, 24, 24,
+      32, 32, 32, 32, 32, 32, 32, 32,
+      48, 48, 48, 48, 48, 48, 48, 48, 48, 48, 48, 48, 48, 48, 48, 48,
+      64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64};
+
+  if (len > 64)
+    len = 64;
+
+  return len2dlc[len];
+}
+
+static canid_t FrameIdOf(const struct canfd_frame &frame)
+{
+  return (frame.can_id & CAN_EFF_FLAG) ? frame.can_id & CAN_EFF_MASK : frame.can_id & CAN_SFF_MASK;
+}
+
+// Key of an identifier in an IdTable, the EFF flag keeps 11 and 29 bit ids apart
+static canid_t IdKeyOf(canid_t id, bool ext)
+{
+  return ext ? (id & CAN_EFF_MASK) | CAN_EFF_FLAG : id & CAN_SFF_MASK;
+}
+
+//-----------------------------------------------------------------------------------------
+/*
+ * Broadcast ring of received frames in a SharedArrayBuffer. The receiving thread of one channel
+ * writes, any number of worker threads read with their own cursor (src/shared_ring.ts) and never
+ * hold the writer back; a reader that falls more than a ring behind loses frames. Little endian:
+ *
+ *   header (64 bytes): magic, version, capacity (slots, power of two), slot size (all u32),
+ *                      notify (i32, low half of the write index, for Atomics.wait),
+ *                      reserved u32, write index (u64, frames published so far)
+ *   slot:              version u32, id u32, ts_ns u64, flags u8, len u8, reserved[6], data[64]
+ *
+ * The slot of frame s has version 2 * (s / capacity + 1), odd while it is being written, so a
+ * reader can tell whether the slot was overwritten while it copied it.
+ */
+#define SHARED_RING_MAGIC   0x5253434e // "NCSR"
+#define SHARED_RING_VERSION 1
+
+struct shared_ring_header
+{
+  uint32_t magic;
+  uint32_t version;
+  uint32_t capacity;
+  uint32_t slot_size;
+  int32_t  notify;
+  uint32_t reserved;
+  uint64_t write;
+  uint8_t  reserved2[32];
+};
+
+struct shared_ring_slot
+{
+  uint32_t version;
+  uint32_t id;
+  uint64_t ts_ns;
+  uint8_t  flags;
+  uint8_t  len;
+  uint8_t  reserved[6];
+  uint8_t  data[CANFD_MAX_DLEN];
+};
+
+static_assert(sizeof(struct shared_ring_header) == 64, "shared ring header layout");
+static_assert(sizeof(struct shared_ring_slot) == 88, "shared ring slot layout");
+
+/**
+ * Writer side of a shared ring, used by one receiving thread at a time
+ */
+class SharedFrameRing
+{
+public:
+  /**
+   * @return nullptr unless base holds an initialized ring of at most len bytes
+   */
+  static SharedFrameRing *Attach(uint8_t *base, size_t len)
+  {
+    struct shared_ring_header *header = reinterpret_cast<struct shared_ring_header *>(base);
+
+    if (!base || ((uintptr_t)base & 7) || len < sizeof(*header) ||
+        header->magic != SHARED_RING_MAGIC || header->version != SHARED_RING_VERSION ||
+        header->slot_size != sizeof(struct shared_ring_slot) ||
+        header->capacity == 0 || (header->capacity & (header->capacity - 1)) ||
+        len < sizeof(*header) + (size_t)header->capacity * sizeof(struct shared_ring_slot))
+      return nullptr;
+
+    return new SharedFrameRing(header);
+  }
+
+  void Publish(const struct rx_slot *slots, size_t count)
+  {
+    for (size_t i = 0; i < count; i++)
+    {
+      const struct rx_slot &src = slots[i];
+      struct shared_ring_slot &dst = m_Slots[m_Write & m_Mask];
+
+      std::atomic_ref<uint32_t> version(dst.version);
+      uint32_t v = (uint32_t)(((m_Write >> m_Shift) + 1) * 2);
+
+      version.store(v - 1, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_release);
+
+      uint8_t len = std::min<uint8_t>(src.frame.len & 0x7f, CANFD_MAX_DLEN);
+
+      dst.id    = FrameIdOf(src.frame);
+      dst.ts_ns = src.ts_ns;
+      dst.flags = FrameFlagsOf(src.frame, src.mtu == CANFD_MTU);
+      dst.len   = len;
+      memcpy(dst.data, src.frame.data, len);
+
+      version.store(v, std::memory_order_release);
+      m_Write++;
+    }
+
+    std::atomic_ref<uint64_t>(m_Header->write).store(m_Write, std::memory_order_release);
+    std::atomic_ref<int32_t>(m_Header->notify).store((int32_t)m_Write, std::memory_order_release);
+  }
+
+  // Frames published so far
+  uint64_t Written() const { return std::atomic_ref<uint64_t>(m_Header->write).load(std::memory_order_acquire); }
+
+private:
+  explicit SharedFrameRing(struct shared_ring_header *header)
+    : m_Header(header),
+      m_Slots(reinterpret_cast<struct shared_ring_slot *>(header + 1)),
+      m_Mask(header->capacity - 1),
+      m_Shift(__builtin_ctz(header->capacity)),
+      m_Write(header->write) {}
+
+  struct shared_ring_header *m_Header;
+  struct shared_ring_slot   *m_Slots;
+  uint64_t                   m_Mask;
+  unsigned                   m_Shift;
+  uint64_t                   m_Write;   // continues a ring written before
+};
+
+//-----------------------------------------------------------------------------------------
+/*
+ * Binary capture format ("NCANLOG") written by FrameRecorder. A file starts with a
+ * log_file_header followed by one log_record per frame. Each record is followed by its len
+ * payload bytes, padded to a multiple of 8 so that all records stay 8 byte aligned. All
+ * fields are in host (little endian) byte order.
+ */
+#define LOG_MAGIC   "NCANLOG"
+#define LOG_VERSION 1
+
+struct log_file_header
+{
+  char     magic[8];     // LOG_MAGIC, zero terminated
+  uint32_t version;      // LOG_VERSION
+  uint32_t header_size;  // offset of the first record
+};
+
+enum LogRecordFlags
+{
+  LOG_FLAG_FD  = 0x01,   // CAN FD frame
+  LOG_FLAG_BRS = 0x02,   // CAN FD bit rate switch
+  LOG_FLAG_ESI = 0x04,   // CAN FD error state indicator
+};
+
+struct log_record
+{
+  uint64_t ts_ns;        // receive time in ns
+  uint32_t can_id;       // including CAN_EFF_FLAG, CAN_RTR_FLAG and CAN_ERR_FLAG
+  uint8_t  len;          // payload bytes
+  uint8_t  flags;        // LogRecordFlags
+  uint8_t  reserved[2];
+};
+
+static inline size_t LogRecordSize(uint8_t len)
+{
+  return sizeof(struct log_record) + ((len + 7) & ~7u);
+}
+
+enum RecordFormat
+{
+  RECORD_BINARY,
+  RECORD_CANDUMP,       // candump -l compatible text
+};
+
+#define CANDUMP_MAX_LINE    256               // "(sec.usec) ifname id##f" with 64 data bytes fits easily
+#define RECORD_PREALLOCATE  (16 * 1024 * 1024) // file space reserved ahead of the written data
+#define RECORD_MIN_BLOCK    4096              // holds several records of either format
+
+static uint64_t MonotonicNs()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/**
+ * Writes received frames to disk without passing them through JS. The receiving thread
+ * copies frames into fixed size blocks (Append), a writer thread writes full blocks and
+ * rotates files. When the writer falls behind until no block is free, frames are dropped
+ * and counted instead of stalling reception.
+ */
+class FrameRecorder
+{
+public:
+  struct options
+  {
+    std::string  path;
+    std::string  ifname;        // interface name written to candump lines
+    RecordFormat format;
+    uint64_t     max_size;      // bytes per file, 0 = unlimited
+    uint64_t     max_time_ns;   // duration per file, 0 = unlimited
+    uint64_t     flush_ns;      // longest time a frame stays buffered
+    size_t       block_size;
+    size_t       blocks;
+  };
+
+  explicit FrameRecorder(const options &opts)
+    : m_Options(opts), m_Memory(nullptr), m_Current(nullptr), m_Stopping(false),
+      m_FlushRequested(false), m_FlushDone(0), m_Fd(-1), m_FileIndex(0), m_FileBytes(0),
+      m_FileStarted(0), m_Preallocated(0), m_Written(0), m_Dropped(0), m_Bytes(0), m_Files(0), m_Error(0)
+  {
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+
+    pthread_mutex_init(&m_Mtx, NULL);
+    pthread_cond_init(&m_Cond, &attr);
+    pthread_cond_init(&m_FlushedCond, NULL);
+    pthread_condattr_destroy(&attr);
+
+    // Files are rotated between blocks, keep blocks within the size limit
+    if (m_Options.max_size && m_Options.max_size < m_Options.block_size)
+      m_Options.block_size = std::max<uint64_t>(m_Options.max_size, RECORD_MIN_BLOCK);
+
+    m_Memory = (char *)malloc(m_Options.block_size * m_Options.blocks);
+
+    m_Blocks.resize(m_Options.blocks);
+    for (size_t i = 0; i < m_Options.blocks; i++)
+    {
+      m_Blocks[i].data = m_Memory + i * m_Options.block_size;
+      m_Blocks[i].used = 0;
+      m_Blocks[i].records = 0;
+      m_Blocks[i].started_ns = 0;
+      m_Free.push_back(&m_Blocks[i]);
+    }
+  }
+
+  ~FrameRecorder()
+  {
+    pthread_mutex_destroy(&m_Mtx);
+    pthread_cond_destroy(&m_Cond);
+    pthread_cond_destroy(&m_FlushedCond);
+    free(m_Memory);
+  }
+
+  /**
+   * Open the first file and start the writer thread
+   * @return 0 or an errno value
+   */
+  int Start()
+  {
+    if (!m_Memory)
+      return ENOMEM;
+
+    int err = OpenFile();
+    if (err)
+      return err;
+
+    if (pthread_create(&m_Thread, NULL, c_thread_entry, this) != 0)
+    {
+      CloseFile();
+      return EAGAIN;
+    }
+
+    return 0;
+  }
+
+  /**
+   * Write out everything buffered, stop the writer thread and close the file. Append must
+   * not be called anymore.
+   */
+  void Stop()
+  {
+    pthread_mutex_lock(&m_Mtx);
+    m_Stopping = true;
+    pthread_cond_signal(&m_Cond);
+    pthread_mutex_unlock(&m_Mtx);
+
+    pthread_join(m_Thread, NULL);
+    CloseFile();
+  }
+
+  /**
+   * Write out everything buffered and wait until it reached the disk
+   */
+  void Flush()
+  {
+    pthread_mutex_lock(&m_Mtx);
+
+    uint64_t generation = m_FlushDone;
+    m_FlushRequested = true;
+    pthread_cond_signal(&m_Cond);
+
+    while (m_FlushDone == generation)
+      pthread_cond_wait(&m_FlushedCond, &m_Mtx);
+
+    pthread_mutex_unlock(&m_Mtx);
+  }
+
+  /**
+   * Called by the receiving thread with the frames of one recvmmsg() call
+   */
+  void Append(const struct rx_slot *slots, size_t count)
+  {
+    uint64_t now_ns = 0;
+
+    pthread_mutex_lock(&m_Mtx);
+
+    for (size_t i = 0; i < count; i++)
+    {
+      const struct rx_slot &slot = slots[i];
+
+      // Frames without receive timestamp are stamped with the time they were read
+      uint64_t ts_ns = slot.ts_ns;
+      if (!ts_ns)
+      {
+        if (!now_ns)
+          now_ns = RealtimeNs();
+        ts_ns = now_ns;
+      }
+
+      size_t need = m_Options.format == RECORD_BINARY ? LogRecordSize(slot.frame.len & 0x7f) : CANDUMP_MAX_LINE;
+
+      if (m_Current && m_Current->used + need > m_Options.block_size)
+        QueueCurrent();
+
+      if (!m_Current)
+      {
+        if (m_Free.empty())
+        {
+          m_Dropped.fetch_add(1, std::memory_order_relaxed);
+          continue;
+        }
+
+        m_Current = m_Free.back();
+        m_Free.pop_back();
+        m_Current->started_ns = MonotonicNs();
+      }
+
+      char *out = m_Current->data + m_Current->used;
+
+      if (m_Options.format == RECORD_BINARY)
+        m_Current->used += FormatBinary(out, slot, ts_ns);
+      else
+        m_Current->used += FormatCandump(out, slot, ts_ns);
+
+      m_Current->records++;
+    }
+
+    pthread_mutex_unlock(&m_Mtx);
+  }
+
+  uint64_t Written() const { return m_Written.load(std::memory_order_relaxed); }
+  uint64_t Dropped() const { return m_Dropped.load(std::memory_order_relaxed); }
+  uint64_t Bytes()   const { return m_Bytes.load(std::memory_order_relaxed); }
+  uint64_t Files()   const { return m_Files.load(std::memory_order_relaxed); }
+  int      Error()   const { return m_Error.load(std::memory_order_relaxed); }
+
+private:
+  struct block
+  {
+    char    *data;
+    size_t   used;        // bytes
+    size_t   records;     // frames
+    uint64_t started_ns;  // monotonic time of the first frame
+  };
+
+  static size_t FormatBinary(char *out, const struct rx_slot &slot, uint64_t ts_ns)
+  {
+    const struct canfd_frame &frame = slot.frame;
+    struct log_record rec;
+
+    uint8_t len = frame.len & 0x7f;
+
+    rec.ts_ns       = ts_ns;
+    rec.can_id      = frame.can_id;
+    rec.len         = len;
+    rec.flags       = 0;
+    rec.reserved[0] = 0;
+    rec.reserved[1] = 0;
+
+    if (slot.mtu == CANFD_MTU)
+    {
+      rec.flags |= LOG_FLAG_FD;
+      if (frame.flags & CANFD_BRS) rec.flags |= LOG_FLAG_BRS;
+      if (frame.flags & CANFD_ESI) rec.flags |= LOG_FLAG_ESI;
+    }
+
+    size_t size = LogRecordSize(len);
+
+    memcpy(out, &rec, sizeof(rec));
+    memcpy(out + sizeof(rec), frame.data, len);
+    memset(out + sizeof(rec) + len, 0, size - sizeof(rec) - len);
+
+    return size;
+  }
+
+  static char *PutHex(char *out, uint32_t value, int digits)
+  {
+    static const char hex[] = "0123456789ABCDEF";
+
+    for (int i = digits - 1; i >= 0; i--)
+      out[i] = hex[value & 0xF], value >>= 4;
+
+    return out + digits;
+  }
+
+  // One line as written by candump -l: "(1436509052.249713) can0 123#DEADBEEF"
+  size_t FormatCandump(char *out, const struct rx_slot &slot, uint64_t ts_ns)
+  {
+    const struct canfd_frame &frame = slot.frame;
+    uint8_t len = frame.len & 0x7f;
+
+    char *p = out + snprintf(out, CANDUMP_MAX_LINE - (2 * CANFD_MAX_DLEN + 16), "(%010llu.%06llu) %s ",
+                             (unsigned long long)(ts_ns / 1000000000ULL),
+                             (unsigned long long)(ts_ns % 1000000000ULL / 1000),
+                             m_Options.ifname.c_str());
+
+    if (frame.can_id & CAN_ERR_FLAG)
+      p = PutHex(p, frame.can_id & (CAN_ERR_MASK | CAN_ERR_FLAG), 8);
+    else if (frame.can_id & CAN_EFF_FLAG)
+      p = PutHex(p, frame.can_id & CAN_EFF_MASK, 8);
+    else
+      p = PutHex(p, frame.can_id & CAN_SFF_MASK, 3);
+
+    *p++ = '#';
+
+    if (slot.mtu == CANFD_MTU)
+    {
+      *p++ = '#';
+      p = PutHex(p, frame.flags & 0xF, 1);
+    }
+    else if (frame.can_id & CAN_RTR_FLAG)
+    {
+      *p++ = 'R';
+      len = 0;
+    }
+
+    for (uint8_t i = 0; i < len; i++)
+      p = PutHex(p, frame.data[i], 2);
+
+    *p++ = '\n';
+
+    return p - out;
+  }
+
+  // Hand the current block to the writer, m_Mtx held
+  void QueueCurrent()
+  {
+    m_Full.push_back(m_Current);
+    m_Current = nullptr;
+    pthread_cond_signal(&m_Cond);
+  }
+
+  static void *c_thread_entry(void *_this) { assert(_this); reinterpret_cast<FrameRecorder*>(_this)->run(); return NULL; }
+
+  void run()
+  {
+    pthread_mutex_lock(&m_Mtx);
+
+    for (;;)
+    {
+      while (m_Full.empty() && !m_Stopping && !m_FlushRequested)
+      {
+        if (!m_Current || !m_Current->used)
+        {
+          pthread_cond_wait(&m_Cond, &m_Mtx);
+          continue;
+        }
+
+        // Partially filled blocks are written once their first frame is flush_ns old
+        uint64_t due = m_Current->started_ns + m_Options.flush_ns;
+
+        if (MonotonicNs() >= due)
+        {
+          QueueCurrent();
+          break;
+        }
+
+        struct timespec ts;
+        ts.tv_sec  = due / 1000000000ULL;
+        ts.tv_nsec = due % 1000000000ULL;
+        pthread_cond_timedwait(&m_Cond, &m_Mtx, &ts);
+      }
+
+      bool flush    = m_FlushRequested;
+      bool stopping = m_Stopping;
+
+      if ((flush || stopping) && m_Current && m_Current->used)
+        QueueCurrent();
+
+      m_FlushRequested = false;
+
+      std::vector<struct block *> full;
+      full.swap(m_Full);
+
+      pthread_mutex_unlock(&m_Mtx);
+
+      for (size_t i = 0; i < full.size(); i++)
+        WriteBlock(full[i]);
+
+      if (flush && m_Fd >= 0)
+        fdatasync(m_Fd);
+
+      pthread_mutex_lock(&m_Mtx);
+
+      for (size_t i = 0; i < full.size(); i++)
+      {
+        full[i]->used = 0;
+        full[i]->records = 0;
+        m_Free.push_back(full[i]);
+      }
+
+      if (flush)
+      {
+        m_FlushDone++;
+        pthread_cond_broadcast(&m_FlushedCond);
+      }
+
+      if (stopping && m_Full.empty())
+        break;
+    }
+
+    pthread_mutex_unlock(&m_Mtx);
+  }
+
+  void WriteBlock(struct block *b)
+  {
+    if (!m_Error.load(std::memory_order_relaxed) && m_FileBytes > HeaderSize() && NeedsRotation(b->used))
+    {
+      CloseFile();
+
+      int err = OpenFile();
+      if (err)
+        m_Error.store(err, std::memory_order_relaxed);
+    }
+
+    if (m_Error.load(std::memory_order_relaxed))
+    {
+      m_Dropped.fetch_add(b->records, std::memory_order_relaxed);
+      return;
+    }
+
+    int err = WriteAll(b->data, b->used);
+    if (err)
+    {
+      m_Error.store(err, std::memory_order_relaxed);
+      m_Dropped.fetch_add(b->records, std::memory_order_relaxed);
+      return;
+    }
+
+    m_Written.fetch_add(b->records, std::memory_order_relaxed);
+    m_Bytes.fetch_add(b->used, std::memory_order_relaxed);
+
+    // Reserve disk space ahead so that writes do not allocate block by block
+    if (m_FileBytes + m_Options.block_size > m_Preallocated)
+    {
+      fallocate(m_Fd, FALLOC_FL_KEEP_SIZE, m_Preallocated, RECORD_PREALLOCATE);
+      m_Preallocated += RECORD_PREALLOCATE;
+    }
+  }
+
+  bool NeedsRotation(size_t bytes)
+  {
+    if (m_Options.max_size && m_FileBytes + bytes > m_Options.max_size)
+      return true;
+
+    return m_Options.max_time_ns && MonotonicNs() - m_FileStarted >= m_Options.max_time_ns;
+  }
+
+  size_t HeaderSize() const
+  {
+    return m_Options.format == RECORD_BINARY ? sizeof(struct log_file_header) : 0;
+  }
+
+  int WriteAll(const char *data, size_t len)
+  {
+    while (len > 0)
+    {
+      ssize_t n = write(m_Fd, data, len);
+
+      if (n < 0)
+      {
+        if (errno == EINTR)
+          continue;
+        return errno;
+      }
+
+      data        += n;
+      len         -= n;
+      m_FileBytes += n;
+    }
+
+    return 0;
+  }
+
+  // Rotated files are numbered: path.0, path.1, ...
+  int OpenFile()
+  {
+    std::string name = m_Options.path;
+
+    if (m_Options.max_size || m_Options.max_time_ns)
+      name += "." + std::to_string(m_FileIndex);
+
+    m_Fd = open(name.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (m_Fd < 0)
+      return errno;
+
+    m_FileIndex++;
+    m_FileBytes    = 0;
+    m_FileStarted  = MonotonicNs();
+    m_Preallocated = m_Options.max_size ? std::min<uint64_t>(m_Options.max_size, RECORD_PREALLOCATE) : RECORD_PREALLOCATE;
+
+    fallocate(m_Fd, FALLOC_FL_KEEP_SIZE, 0, m_Preallocated);
+
+    m_Files.fetch_add(1, std::memory_order_relaxed);
+
+    if (m_Options.format == RECORD_BINARY)
+    {
+      struct log_file_header header;
+
+      memset(&header, 0, sizeof(header));
+      memcpy(header.magic, LOG_MAGIC, sizeof(LOG_MAGIC));
+      header.version     = LOG_VERSION;
+      header.header_size = sizeof(header);
+
+      return WriteAll((const char *)&header, sizeof(header));
+    }
+
+    return 0;
+  }
+
+  void CloseFile()
+  {
+    if (m_Fd < 0)
+      return;
+
+    // Give back the space reserved beyond the data
+    if (ftruncate(m_Fd, m_FileBytes) != 0)
+      m_Error.store(errno, std::memory_order_relaxed);
+
+    close(m_Fd);
+    m_Fd = -1;
+  }
+
+  options m_Options;
+
+  pthread_t       m_Thread;
+  pthread_mutex_t m_Mtx;
+  pthread_cond_t  m_Cond;          // writer waits for blocks
+  pthread_cond_t  m_FlushedCond;   // Flush() waits for the writer
+
+  // Guarded by m_Mtx
+  char                        *m_Memory;
+  std::vector<struct block>    m_Blocks;
+  std::vector<struct block *>  m_Free;
+  std::vector<struct block *>  m_Full;
+  struct block                *m_Current;
+  bool                         m_Stopping;
+  bool                         m_FlushRequested;
+  uint64_t                     m_FlushDone;
+
+  // Writer thread only
+  int      m_Fd;
+  unsigned m_FileIndex;
+  uint64_t m_FileBytes;
+  uint64_t m_FileStarted;
+  uint64_t m_Preallocated;
+
+  std::atomic<uint64_t> m_Written;
+  std::atomic<uint64_t> m_Dropped;
+  std::atomic<uint64_t> m_Bytes;
+  std::atomic<uint64_t> m_Files;
+  std::atomic<int>      m_Error;
+};
+
+//-----------------------------------------------------------------------------------------
+/**
+ * Frame read back from a capture
+ */
+struct log_frame
+{
+  struct canfd_frame frame;
+  uint32_t           mtu;     // CAN_MTU or CANFD_MTU
+  uint64_t           ts_ns;   // capture timestamp
+};
+
+static int HexValue(char c)
+{
+  if (c >= '0' && c <= '9')
+    return c - '0';
+
+  c |= 0x20;
+  if (c >= 'a' && c <= 'f')
+    return c - 'a' + 10;
+
+  return -1;
+}
+
+/**
+ * Parse one candump -l line ("(1436509052.249713) can0 123#DEADBEEF", "123##1AABB", "123#R")
+ * @return false if the line holds no frame
+ */
+static bool ParseCandumpLine(const char *p, const char *end, struct log_frame *out)
+{
+  memset(&out->frame, 0, sizeof(out->frame));
+  out->mtu = CAN_MTU;
+
+  while (p < end && *p == ' ')
+    p++;
+
+  if (p >= end || *p++ != '(')
+    return false;
+
+  uint64_t sec = 0, frac = 0;
+  int digits = 0;
+
+  while (p < end && *p >= '0' && *p <= '9')
+    sec = sec * 10 + (*p++ - '0');
+
+  if (p < end && *p == '.')
+  {
+    for (p++; p < end && *p >= '0' && *p <= '9'; p++)
+    {
+      if (digits < 9)
+      {
+        frac = frac * 10 + (*p - '0');
+        digits++;
+      }
+    }
+  }
+
+  if (p >= end || *p++ != ')')
+    return false;
+
+  for (; digits < 9; digits++)
+    frac *= 10;
+
+  out->ts_ns = sec * 1000000000ULL + frac;
+
+  // Interface name
+  while (p < end && *p == ' ')
+    p++;
+  while (p < end && *p != ' ')
+    p++;
+  while (p < end && *p == ' ')
+    p++;
+
+  const char *id_start = p;
+  canid_t id = 0;
+
+  while (p < end && HexValue(*p) >= 0)
+    id = (id << 4) | HexValue(*p++);
+
+  if (p - id_start == 8)
+  {
+    // Error frames are written with CAN_ERR_FLAG, everything else with 8 digits is extended
+    if (!(id & CAN_ERR_FLAG))
+      id |= CAN_EFF_FLAG;
+  }
+  else if (p - id_start != 3)
+  {
+    return false;
+  }
+
+  if (p >= end || *p++ != '#')
+    return false;
+
+  size_t max_len = CAN_MAX_DLEN;
+
+  if (p < end && *p == '#')
+  {
+    int flags = (p + 1 < end) ? HexValue(p[1]) : -1;
+    if (flags < 0)
+      return false;
+
+    out->frame.flags = flags;
+    out->mtu = CANFD_MTU;
+    max_len = CANFD_MAX_DLEN;
+    p += 2;
+  }
+  else if (p < end && *p == 'R')
+  {
+    int len = (p + 1 < end) ? HexValue(p[1]) : -1;
+
+    out->frame.can_id = id | CAN_RTR_FLAG;
+    out->frame.len    = (len >= 0 && len <= CAN_MAX_DLEN) ? len : 0;
+    return true;
+  }
+
+  size_t len = 0;
+
+  while (p < end)
+  {
+    if (*p == '.')
+    {
+      p++;
+      continue;
+    }
+
+    int hi = HexValue(*p);
+    if (hi < 0)
+      break;
+
+    int lo = (p + 1 < end) ? HexValue(p[1]) : -1;
+    if (lo < 0 || len >= max_len)
+      return false;
+
+    out->frame.data[len++] = (hi << 4) | lo;
+    p += 2;
+  }
+
+  out->frame.can_id = id;
+  out->frame.len    = len;
+  return true;
+}
+
+/**
+ * Private mapping of a capture, either in the binary format written by FrameRecorder or
+ * candump -l text. Read-only until MakeWritable().
+ */
+class LogFile
+{
+public:
+  LogFile() : m_Data(nullptr), m_Size(0), m_Format(RECORD_CANDUMP), m_First(0) {}
+
+  ~LogFile()
+  {
+    if (m_Data)
+      munmap((void *)m_Data, m_Size);
+  }
+
+  /**
+   * Map the file and detect its format
+   * @return 0 or an errno value
+   */
+  int Open(const std::string &path)
+  {
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+      return errno;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0)
+    {
+      int err = errno;
+      close(fd);
+      return err;
+    }
+
+    m_Size = st.st_size;
+
+    if (m_Size > 0)
+    {
+      // A writable private mapping would be charged in full against the commit limit, too much
+      // for captures beyond RAM + swap. MAP_NORESERVE keeps a later MakeWritable() uncharged.
+      void *data = mmap(NULL, m_Size, PROT_READ, MAP_PRIVATE | MAP_NORESERVE, fd, 0);
+      if (data == MAP_FAILED)
+      {
+        int err = errno;
+        close(fd);
+        return err;
+      }
+
+      m_Data = (const char *)data;
+    }
+
+    close(fd);
+
+    struct log_file_header header;
+
+    if (m_Size >= sizeof(header))
+    {
+      memcpy(&header, m_Data, sizeof(header));
+
+      if (memcmp(header.magic, LOG_MAGIC, sizeof(LOG_MAGIC)) == 0)
+      {
+        if (header.version != LOG_VERSION || header.header_size < sizeof(header) || header.header_size > m_Size)
+          return EINVAL;
+
+        m_Format = RECORD_BINARY;
+        m_First  = header.header_size;
+      }
+    }
+
+    return 0;
+  }
+
+  /**
+   * Allow writes to the mapping, they go to private copies of the touched pages
+   * @return 0 or an errno value
+   */
+  int MakeWritable()
+  {
+    if (m_Size > 0 && mprotect((void *)m_Data, m_Size, PROT_READ | PROT_WRITE) != 0)
+      return errno;
+    return 0;
+  }
+
+  const char  *Data()   const { return m_Data; }
+  size_t       Size()   const { return m_Size; }
+  RecordFormat Format() const { return m_Format; }
+
+  // Offset of the first record
+  size_t First() const { return m_First; }
+
+  /**
+   * Read the frame at *offset and advance *offset behind it
+   * @return false at the end of the file (or at a truncated binary record)
+   */
+  bool Next(size_t *offset, struct log_frame *out) const
+  {
+    if (m_Format == RECORD_BINARY)
+      return NextRecord(offset, out);
+
+    while (*offset < m_Size)
+    {
+      const char *line = m_Data + *offset;
+      const char *eol  = (const char *)memchr(line, '\n', m_Size - *offset);
+
+      if (!eol)
+        eol = m_Data + m_Size;
+
+      *offset = eol - m_Data + 1;
+
+      if (ParseCandumpLine(line, eol, out))
+        return true;
+    }
+
+    return false;
+  }
+
+  /**
+   * Binary format only: the record header at offset, nullptr behind the last complete record
+   */
+  const struct log_record *RecordAt(size_t offset) const
+  {
+    if (offset + sizeof(struct log_record) > m_Size)
+      return nullptr;
+
+    const struct log_record *rec = (const struct log_record *)(m_Data + offset);
+
+    if (rec->len > CANFD_MAX_DLEN || offset + LogRecordSize(rec->len) > m_Size)
+      return nullptr;
+
+    return rec;
+  }
+
+private:
+  bool NextRecord(size_t *offset, struct log_frame *out) const
+  {
+    const struct log_record *rec = RecordAt(*offset);
+    if (!rec)
+      return false;
+
+    memset(&out->frame, 0, sizeof(out->frame));
+
+    out->ts_ns        = rec->ts_ns;
+    out->frame.can_id = rec->can_id;
+    out->frame.len    = rec->len;
+    out->mtu          = (rec->flags & LOG_FLAG_FD) ? CANFD_MTU : CAN_MTU;
+
+    if (rec->flags & LOG_FLAG_BRS) out->frame.flags |= CANFD_BRS;
+    if (rec->flags & LOG_FLAG_ESI) out->frame.flags |= CANFD_ESI;
+
+    memcpy(out->frame.data, rec + 1, rec->len);
+
+    *offset += LogRecordSize(rec->len);
+    return true;
+  }
+
+  const char  *m_Data;
+  size_t       m_Size;
+  RecordFormat m_Format;
+  size_t       m_First;
+};
+
+#define REPLAY_COARSE_SLEEP_NS 10000000ULL // longest single sleep, bounds the reaction time to Stop()
+
+/**
+ * Transmits a capture on a socket from a thread of its own, paced against the original
+ * timestamps with clock_nanosleep(). The deviation of every transmission from its target
+ * time is kept in a histogram.
+ */
+class FrameReplayer
+{
+public:
+  struct options
+  {
+    double   speed;     // 2 replays twice as fast
+    uint32_t loops;     // passes over the file, 0 = until stopped
+    bool     max_rate;  // ignore timestamps and send as fast as the socket accepts
+    int64_t  loop_gap;  // capture time between the last frame of a pass and the first of the next,
+                        // < 0 = mean frame spacing of the capture
+
+    // Identifier replacements, sorted by the IdKeyOf() of the source identifier
+    std::vector<std::pair<canid_t, canid_t>> remap;
+  };
+
+  FrameReplayer(int fd, std::atomic<uint64_t> *stats, const options &opts, uv_async_t *done)
+    : m_Fd(fd), m_Stats(stats), m_Options(opts), m_Done(done), m_StopRequested(false),
+      m_Sent(0), m_Errors(0), m_Loops(0), m_ErrorSum(0), m_StartNs(0), m_EndNs(0), m_Result(0)
+  {
+    pthread_mutex_init(&m_TimingMtx, NULL);
+  }
+
+  ~FrameReplayer()
+  {
+    pthread_mutex_destroy(&m_TimingMtx);
+  }
+
+  /**
+   * Map the capture and start transmitting, m_Done is signalled when finished
+   * @return 0 or an errno value
+   */
+  int Start(const std::string &path)
+  {
+    int err = m_Log.Open(path);
+    if (err)
+      return err;
+
+    if (pthread_create(&m_Thread, NULL, c_thread_entry, this) != 0)
+      return EAGAIN;
+
+    return 0;
+  }
+
+  // Ask the thread to finish early, it signals m_Done as usual
+  void Stop() { m_StopRequested = true; }
+
+  // Wait for the thread after m_Done was signalled
+  void Join() { pthread_join(m_Thread, NULL); }
+
+  uv_async_t *DoneHandle() const { return m_Done; }
+
+  /**
+   * Report progress and timing accuracy
+   */
+  Napi::Object StatsOf(Napi::Env env)
+  {
+    Napi::Object obj = Napi::Object::New(env);
+
+    obj.Set("sent",    Napi::Number::New(env, (double)m_Sent.load(std::memory_order_relaxed)));
+    obj.Set("errors",  Napi::Number::New(env, (double)m_Errors.load(std::memory_order_relaxed)));
+    obj.Set("loops",   Napi::Number::New(env, (double)m_Loops.load(std::memory_order_relaxed)));
+    obj.Set("stopped", Napi::Boolean::New(env, m_StopRequested.load()));
+
+    uint64_t start = m_StartNs.load(), end = m_EndNs.load();
+    if (start)
+      obj.Set("duration", Napi::Number::New(env, (double)((end ? end : MonotonicNs()) - start) / 1e6));
+
+    if (m_Result)
+      obj.Set("error", Napi::String::New(env, strerror(m_Result)));
+
+    if (!m_Options.max_rate)
+    {
+      pthread_mutex_lock(&m_TimingMtx);
+
+      Napi::Object timing = Napi::Object::New(env);
+      uint64_t count = m_Timing.Count();
+
+      timing.Set("count", Napi::Number::New(env, (double)count));
+      timing.Set("mean",  Napi::Number::New(env, count ? (double)m_ErrorSum / count : 0));
+      timing.Set("p50",   Napi::Number::New(env, (double)m_Timing.Percentile(0.5)));
+      timing.Set("p99",   Napi::Number::New(env, (double)m_Timing.Percentile(0.99)));
+      timing.Set("p999",  Napi::Number::New(env, (double)m_Timing.Percentile(0.999)));
+      timing.Set("max",   Napi::Number::New(env, (double)m_Timing.Max()));
+
+      pthread_mutex_unlock(&m_TimingMtx);
+
+      obj.Set("timingError", timing);
+    }
+
+    return obj;
+  }
+
+private:
+  static void *c_thread_entry(void *_this) { assert(_this); reinterpret_cast<FrameReplayer*>(_this)->run(); return NULL; }
+
+  void run()
+  {
+    uint64_t start_ns   = MonotonicNs();
+    uint64_t first_ts   = 0;
+    uint64_t loop_shift = 0;   // capture time covered by the previous passes
+    bool     first      = true;
+
+    m_StartNs = start_ns;
+
+    for (uint32_t loop = 0; !m_StopRequested && (m_Options.loops == 0 || loop < m_Options.loops); loop++)
+    {
+      size_t offset = m_Log.First();
+      uint64_t last_rel = 0;
+      uint64_t frames = 0;
+      struct log_frame f;
+
+      while (!m_StopRequested && m_Log.Next(&offset, &f))
+      {
+        if (first)
+        {
+          first_ts = f.ts_ns;
+          first = false;
+        }
+
+        // Timestamps running backwards are sent right away
+        uint64_t rel = f.ts_ns > first_ts ? f.ts_ns - first_ts : 0;
+        if (rel > last_rel)
+          last_rel = rel;
+
+        uint64_t target_ns = 0;
+
+        if (!m_Options.max_rate)
+        {
+          target_ns = start_ns + (uint64_t)((double)(loop_shift + rel) / m_Options.speed);
+          if (!SleepUntil(target_ns))
+            break;
+        }
+
+        Remap(&f.frame);
+        frames++;
+
+        if (!Send(f))
+          continue;
+
+        if (!m_Options.max_rate)
+        {
+          uint64_t now = MonotonicNs();
+          uint64_t error_ns = now > target_ns ? now - target_ns : 0;
+
+          pthread_mutex_lock(&m_TimingMtx);
+          m_Timing.Record(error_ns);
+          m_ErrorSum += error_ns;
+          pthread_mutex_unlock(&m_TimingMtx);
+        }
+      }
+
+      if (!m_StopRequested)
+        m_Loops++;
+
+      // An empty capture would loop forever without ever sleeping
+      if (!frames)
+        break;
+
+      // Without a gap the first frame of the next pass would go out together with the last one
+      uint64_t gap = m_Options.loop_gap >= 0 ? (uint64_t)m_Options.loop_gap
+                                             : (frames > 1 ? last_rel / (frames - 1) : 0);
+
+      loop_shift += last_rel + gap;
+    }
+
+    m_EndNs = MonotonicNs();
+    uv_async_send(m_Done);
+  }
+
+  /**
+   * Sleep coarsely while far from target_ns (to notice Stop()), then precisely up to it
+   * @return false if stopped
+   */
+  bool SleepUntil(uint64_t target_ns)
+  {
+    for (;;)
+    {
+      if (m_StopRequested)
+        return false;
+
+      uint64_t now = MonotonicNs();
+      if (now >= target_ns)
+        return true;
+
+      uint64_t wake = (target_ns - now > REPLAY_COARSE_SLEEP_NS) ? now + REPLAY_COARSE_SLEEP_NS : target_ns;
+
+      struct timespec ts;
+      ts.tv_sec  = wake / 1000000000ULL;
+      ts.tv_nsec = wake % 1000000000ULL;
+      clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+    }
+  }
+
+  void Remap(struct canfd_frame *frame)
+  {
+    if (m_Options.remap.empty())
+      return;
+
+    canid_t key = IdKeyOf(frame->can_id, frame->can_id & CAN_EFF_FLAG);
+
+    auto it = std::lower_bound(m_Options.remap.begin(), m_Options.remap.end(), std::make_pair(key, (canid_t)0));
+    if (it == m_Options.remap.end() || it->first != key)
+      return;
+
+    canid_t mask = (frame->can_id & CAN_EFF_FLAG) ? CAN_EFF_MASK : CAN_SFF_MASK;
+    frame->can_id = (frame->can_id & ~mask) | (it->second & mask);
+  }
+
+  /**
+   * Transmit one frame, waiting while the device queue is full
+   * @return false if the frame could not be sent
+   */
+  bool Send(const struct log_frame &f)
+  {
+    for (;;)
+    {
+      if (send(m_Fd, &f.frame, f.mtu, 0) >= 0)
+      {
+        m_Stats[STAT_TX_FRAMES].fetch_add(1, std::memory_order_relaxed);
+        m_Sent++;
+        return true;
+      }
+
+      if (errno == ENOBUFS && !m_StopRequested)
+      {
+        // The queue discipline does not wake writers, retry shortly
+        m_Stats[STAT_TX_ENOBUFS].fetch_add(1, std::memory_order_relaxed);
+        usleep(100);
+        continue;
+      }
+
+      if (errno == EINTR)
+        continue;
+
+      m_Stats[STAT_TX_ERRORS].fetch_add(1, std::memory_order_relaxed);
+      m_Errors++;
+
+      if (!m_Result)
+        m_Result = errno;
+
+      return false;
+    }
+  }
+
+  int                    m_Fd;
+  std::atomic<uint64_t> *m_Stats;   // getStats() counters of the channel
+  options                m_Options;
+  uv_async_t            *m_Done;
+  LogFile                m_Log;
+  pthread_t              m_Thread;
+
+  std::atomic<bool>     m_StopRequested;
+  std::atomic<uint64_t> m_Sent;
+  std::atomic<uint64_t> m_Errors;
+  std::atomic<uint64_t> m_Loops;
+
+  // Deviation of the transmissions from their target time
+  pthread_mutex_t  m_TimingMtx;
+  LatencyHistogram m_Timing;
+  uint64_t         m_ErrorSum;
+
+  std::atomic<uint64_t> m_StartNs;
+  std::atomic<uint64_t> m_EndNs;
+  std::atomic<int>      m_Result;  // errno of the first failed send
+};
+
+//-----------------------------------------------------------------------------------------
+class RawChannel;
+
+/**
+ * Registration of a channel socket with the reactor
+ */
+struct reactor_entry
+{
+  pthread_mutex_t mtx;      // held by a worker while it receives for the channel
+  RawChannel     *channel;  // nullptr once removed
+  bool            stalled;  // not re-armed because the receive ring was full
+};
+
+class RxReactor;
+
+struct reactor_worker
+{
+  RxReactor            *reactor;
+  pthread_t             thread;
+  std::atomic<uint64_t> rounds;   // epoll rounds handled completely
+};
+
+/**
+ * Receive reactor shared by all channels of one Node.js environment that use RX_MODE_REACTOR.
+ *
+ * All sockets are registered with one epoll instance (EPOLLONESHOT, so only one worker at a time
+ * receives for a channel and a full channel stops being polled until JS drained it). Workers
+ * receive into the rings of the channels and collect them in a ready list; one uv_async wakes
+ * the event loop for all channels that became ready in the meantime. An eventfd stops the workers.
+ */
+class RxReactor
+{
+public:
+  static RxReactor *Get(napi_env env);
+
+  bool SetWorkers(unsigned workers);
+
+  reactor_entry *Add(RawChannel *channel, int fd);
+  void Remove(reactor_entry *entry, int fd);
+  void Resume(reactor_entry *entry, int fd);
+
+private:
+  explicit RxReactor(napi_env env);
+
+  static void *c_worker_entry(void *_worker)
+  {
+    reactor_worker *worker = reinterpret_cast<reactor_worker *>(_worker);
+    worker->reactor->WorkerEntry(worker);
+    return NULL;
+  }
+  void WorkerEntry(reactor_worker *worker);
+  bool StartWorkers();
+  void Arm(reactor_entry *entry, int fd, int op);
+  void FreeEntry(reactor_entry *entry);
+  void FreeRetiredEntries();
+
+  static void async_ready_cb(uv_async_t *handle);
+  void async_ready();
+
+  static void cleanup_hook(void *arg);
+  void Shutdown();
+
+  napi_env   m_Env;
+  int        m_EpollFd;
+  int        m_StopFd;
+  uv_async_t m_AsyncReady;
+
+  // Started with the first channel, setReactorWorkers() may raise the count before or after
+  unsigned                      m_WorkerCount;
+  std::vector<reactor_worker *> m_Workers;
+
+  // Channels with frames in their ring, filled by the workers, drained by the main thread
+  pthread_mutex_t           m_ReadyMtx;
+  std::vector<RawChannel *> m_Ready;
+  std::vector<RawChannel *> m_Dispatching;
+
+  // Entries of the registered channels
+  std::vector<reactor_entry *> m_Entries;
+
+  // Removed entries may still be referenced by an event a worker fetched before, they are freed
+  // once every worker that existed then has completed its round. Main thread only.
+  struct retired_entry
+  {
+    reactor_entry        *entry;
+    std::vector<uint64_t> rounds;   // of the workers at removal
+  };
+  std::vector<retired_entry> m_Retired;
+};
+
+//-----------------------------------------------------------------------------------------
+/**
+ * A Raw channel to access a certain CAN channel (e.g. vcan0) via CAN messages.
+ * @class RawChannel
+ */
+class RawChannel : public Napi::ObjectWrap<RawChannel>
+{
+  friend class RxReactor;
+
+public:
+  static Napi::Object Init(Napi::Env env, Napi::Object exports)
+  {
+    Napi::Function func = DefineClass(env, "RawChannel", {
+      InstanceMethod("addListener",     &RawChannel::AddListener),
+      InstanceMethod("addIdListener",   &RawChannel::AddIdListener),
+      InstanceMethod("removeIdListener", &RawChannel::RemoveIdListener),
+      InstanceMethod("start",           &RawChannel::Start),
+      InstanceMethod("stop",            &RawChannel::Stop),
+      InstanceMethod("send",            &RawChannel::Send),
+      InstanceMethod("sendFD",          &RawChannel::SendFD),
+      InstanceMethod("sendBatch",       &RawChannel::SendBatch),
+      InstanceMethod("sendRaw",         &RawChannel::SendRaw),
+      InstanceMethod("setRxFilters",    &RawChannel::SetRxFilters),
+      InstanceMethod("setErrorFilters", &RawChannel::SetErrorFilters),
+      InstanceMethod("disableLoopback", &RawChannel::DisableLoopback),
+      InstanceMethod("getStats",        &RawChannel::GetStats),
+      InstanceMethod("resetStats",      &RawChannel::ResetStats),
+      InstanceMethod("enableLatencyHistograms", &RawChannel::EnableLatencyHistograms),
+      InstanceMethod("getLatencyHistograms",    &RawChannel::GetLatencyHistograms),
+      InstanceMethod("resetLatencyHistograms",  &RawChannel::ResetLatencyHistograms),
+      InstanceMethod("attachSharedRing",  &RawChannel::AttachSharedRing),
+      InstanceMethod("detachSharedRing",  &RawChannel::DetachSharedRing),
+      InstanceMethod("startRecording",    &RawChannel::StartRecording),
+      InstanceMethod("stopRecording",     &RawChannel::StopRecording),
+      InstanceMethod("flushRecording",    &RawChannel::FlushRecording),
+      InstanceMethod("getRecordingStats", &RawChannel::GetRecordingStats),
+      InstanceMethod("startReplay",       &RawChannel::StartReplay),
+      InstanceMethod("stopReplay",        &RawChannel::StopReplay),
+      InstanceMethod("getReplayStats",    &RawChannel::GetReplayStats),
+    });
+
+    exports.Set("RawChannel", func);
+    return exports;
+  }
+
+  /**
+   * Create a new CAN channel object
+   * @constructor RawChannel
+   * @param interface {string} interface name to create channel on (e.g. can0)
+   * @param timestamps {bool|string} Optional, request receive timestamps: true or "software" for kernel
+   *                   timestamps, "hardware" for controller timestamps where supported (falls back to software)
+   * @param protocol {integer} Optional, socket protocol (default CAN_RAW)
+   * @param non_block_send {bool} Optional, never block in send()
+   * @param rx_ring_size {integer} Optional, number of frames buffered between reader thread and JS (rounded up to a power of two)
+   * @param rx_mode {string} Optional, "thread" (default) receives on a dedicated thread, "poll" on the event loop
+   *                thread via uv_poll without any helper thread, "reactor" on the epoll reactor threads shared
+   *                by all channels (see setReactorWorkers)
+   * @param rx_pooled {bool} Optional, deliver the payloads of one wakeup as Buffer views into one pooled slab
+   *                  instead of one copied Buffer per frame
+   * @param tx_queue_size {integer} Optional, queue up to this many frames the socket has no room for and send
+   *                      them once it has (default 0, no queue)
+   * @param tx_overflow {string} Optional, what a full queue does with another frame: "reject" (default) throws,
+   *                    "drop-newest" drops it, "drop-oldest" drops the oldest queued frame
+   * @return new RawChannel object
+   */
+  explicit RawChannel(const Napi::CallbackInfo& info)
+    : Napi::ObjectWrap<RawChannel>(info),
+      m_Thread(0), m_RxMode(RX_MODE_THREAD), m_Polling(false), m_ReactorEntry(nullptr), m_ReactorQueued(false), m_Name(""), m_RxRingFull(false), m_RxRing(nullptr), m_RxBatched(0), m_SocketFd(-1),
+      m_ThreadStopRequested(false), m_Recorder(nullptr), m_Replayer(nullptr), m_SharedRing(nullptr), m_SharedRingNotified(0), m_TimestampMode(TIMESTAMPS_NONE), m_HwTstampRestore(false),
+      m_NonBlockingSend(false), m_TxQueue(nullptr), m_TxOverflow(TX_OVERFLOW_REJECT), m_TxPollFd(-1), m_TxPoll(nullptr),
+      m_TxTimer(nullptr), m_TxArmed(false), m_TxNeedDrain(false), m_napi_env(nullptr), m_async_ctx(nullptr)
+  {
+    Napi::Env env = info.Env();
+
+    if (!info.IsConstructCall()) {
+      Napi::Error::New(env, "Must be called with new").ThrowAsJavaScriptException();
+      return;
+    }
+    if (info.Length() < 1) {
+      Napi::Error::New(env, "Too few arguments").ThrowAsJavaScriptException();
+      return;
+    }
+    if (!info[0].IsString()) {
+      Napi::Error::New(env, "First argument must be a string").ThrowAsJavaScriptException();
+      return;
+    }
+
+    m_napi_env = env;
+
+    for (int i = 0; i < STAT_COUNT; i++)
+    {
+      m_Stats[i] = 0;
+      m_StatsBase[i] = 0;
+    }
+
+    m_LatencyEnabled = false;
+
+    memset(&m_TxRawFrame, 0, sizeof(m_TxRawFrame));
+
+    std::string name = info[0].As<Napi::String>().Utf8Value();
+    m_Name = name;
+
+    TimestampMode timestamps = TIMESTAMPS_NONE;
+    int  protocol       = CAN_RAW;
+    bool non_block_send = false;
+    uint32_t rx_ring_size = DEFAULT_RX_RING_SIZE;
+
+    if (info.Length() >= 2 && info[1].IsBoolean())
+    {
+      timestamps = info[1].As<Napi::Boolean>().Value() ? TIMESTAMPS_SOFTWARE : TIMESTAMPS_NONE;
+    }
+    else if (info.Length() >= 2 && info[1].IsString())
+    {
+      std::string source = info[1].As<Napi::String>().Utf8Value();
+
+      if (source == "software")
+        timestamps = TIMESTAMPS_SOFTWARE;
+      else if (source == "hardware")
+        timestamps = TIMESTAMPS_HARDWARE;
+      else if (source != "none") {
+        Napi::Error::New(env, "Invalid timestamp source").ThrowAsJavaScriptException();
+        return;
+      }
+    }
+
+    if (info.Length() >= 3 && info[2].IsNumber())
+      protocol = info[2].As<Napi::Number>().Int32Value();
+
+    if (info.Length() >= 4 && info[3].IsBoolean())
+      non_block_send = info[3].As<Napi::Boolean>().Value();
+
+    if (info.Length() >= 5 && info[4].IsNumber())
+      rx_ring_size = info[4].As<Napi::Number>().Uint32Value();
+
+    if (info.Length() >= 7 && info[6].IsBoolean() && info[6].As<Napi::Boolean>().Value())
+      m_RxPool = std::make_shared<RxSlabPool>();
+
+    if (info.Length() >= 9 && info[8].IsString())
+    {
+      std::string overflow = info[8].As<Napi::String>().Utf8Value();
+
+      if (overflow == "drop-newest")
+        m_TxOverflow = TX_OVERFLOW_DROP_NEWEST;
+      else if (overflow == "drop-oldest")
+        m_TxOverflow = TX_OVERFLOW_DROP_OLDEST;
+      else if (overflow != "reject") {
+        Napi::Error::New(env, "Invalid transmit overflow policy").ThrowAsJavaScriptException();
+        return;
+      }
+    }
+
+    if (info.Length() >= 8 && info[7].IsNumber() && info[7].As<Napi::Number>().Uint32Value() > 0)
+      m_TxQueue = new TxQueue(info[7].As<Napi::Number>().Uint32Value());
+
+    if (info.Length() >= 6 && info[5].IsString())
+    {
+      std::string mode = info[5].As<Napi::String>().Utf8Value();
+
+      if (mode == "poll")
+        m_RxMode = RX_MODE_POLL;
+      else if (mode == "reactor")
+        m_RxMode = RX_MODE_REACTOR;
+      else if (mode != "thread") {
+        Napi::Error::New(env, "Invalid receive mode").ThrowAsJavaScriptException();
+        return;
+      }
+    }
+
+    m_TimestampMode       = timestamps;
+    m_NonBlockingSend     = non_block_send;
+
+    const int canfd_on = 1;
+    const int rxq_ovfl_on = 1;
+    m_SocketFd = socket(PF_CAN, SOCK_RAW, protocol);
+
+    if (m_SocketFd > 0)
+    {
+      can_err_mask_t err_mask;
+      struct ifreq ifr;
+
+      memset(&ifr, 0, sizeof(ifr));
+      strncpy(ifr.ifr_name, name.c_str(), IFNAMSIZ - 1);
+      if (ioctl(m_SocketFd, SIOCGIFINDEX, &ifr) != 0)
+        goto on_error;
+
+      err_mask = CAN_ERR_MASK;
+
+      setsockopt(m_SocketFd, SOL_CAN_RAW, CAN_RAW_FD_FRAMES, &canfd_on, sizeof(canfd_on));
+
+      if (setsockopt(m_SocketFd, SOL_CAN_RAW, CAN_RAW_ERR_FILTER, &err_mask, sizeof(err_mask)) != 0)
+        goto on_error;
+
+      memset(&m_SocketAddr, 0, sizeof(m_SocketAddr));
+      m_SocketAddr.can_family  = PF_CAN;
+      m_SocketAddr.can_ifindex = ifr.ifr_ifindex;
+
+      if (bind(m_SocketFd, (struct sockaddr *)&m_SocketAddr, sizeof(m_SocketAddr)) < 0)
+        goto on_error;
+
+      if (timestamps != TIMESTAMPS_NONE)
+        EnableTimestamps(&ifr);
+
+      // Have the kernel report its drop counter with every received frame
+      setsockopt(m_SocketFd, SOL_SOCKET, SO_RXQ_OVFL, &rxq_ovfl_on, sizeof(rxq_ovfl_on));
+
+      m_RxRing = new RxRing(rx_ring_size);
+
+      pthread_mutex_init(&m_RxRingFullMtx, NULL);
+      pthread_cond_init(&m_RxRingFullCond, NULL);
+      pthread_mutex_init(&m_RecorderMtx, NULL);
+      pthread_mutex_init(&m_SharedRingMtx, NULL);
+
+      return;
+
+      on_error:
+      close(m_SocketFd);
+      m_SocketFd = -1;
+    }
+
+    if (!IsValid()) {
+      Napi::Error::New(env, "Error while creating channel").ThrowAsJavaScriptException();
+    }
+  }
+
+  ~RawChannel()
+  {
+    m_IdListeners.ForEach([](ListenerList *list) { delete list; });
+    FreeRetiredIdListeners();
+
+    if (m_Replayer)
+    {
+      m_Replayer->Stop();
+      m_Replayer->Join();
+      delete m_Replayer;
+    }
+
+    if (m_SocketFd >= 0)
+    {
+      RestoreHwTimestamps();
+      close(m_SocketFd);
+    }
+
+    if (m_Thread)
+      stopThread();
+
+    delete DetachRecorder();
+    delete DetachRing();
+
+    delete m_RxRing;
+
+    // Frames still queued are dropped, the handles are idle then
+    if (m_TxPoll)
+      uv_close((uv_handle_t *)m_TxPoll, [](uv_handle_t *handle) { delete (uv_poll_t *)handle; });
+
+    if (m_TxTimer)
+      uv_close((uv_handle_t *)m_TxTimer, [](uv_handle_t *handle) { delete (uv_timer_t *)handle; });
+
+    if (m_TxPollFd >= 0)
+      close(m_TxPollFd);
+
+    delete m_TxQueue;
+  }
+
+private:
+  /**
+   * Add listener to receive certain notifications
+   * @method addListener
+   * @param event {string} onMessage to register for incoming messages, onBatch to receive them
+   *                      in columnar batches, onStopped to get notified when the channel stops,
+   *                      onReplayDone to get the final stats of startReplay(), onDrain to get notified
+   *                      when the transmit queue emptied after a send returned false
+   * @param callback {any} JS callback object
+   * @param instance {any} Optional instance pointer to call callback
+   */
+  Napi::Value AddListener(const Napi::CallbackInfo& info)
+  {
+    Napi::Env env = info.Env();
+    CHECK_CONDITION(info.Length() >= 2, "Too few arguments");
+    CHECK_CONDITION(info[0].IsString(), "First argument must be a string");
+    CHECK_CONDITION(info[1].IsFunction(), "Second argument must be a function");
+
+    std::string event = info[0].As<Napi::String>().Utf8Value();
+    ListenerList *list = nullptr;
+
+    if (event == "onMessage")
+      list = &m_OnMessageListeners;
+    else if (event == "onBatch")
+      list = &m_OnBatchListeners;
+    else if (event == "onStopped")
+      list = &m_OnChannelStoppedListeners;
+    else if (event == "onReplayDone")
+      list = &m_OnReplayDoneListeners;
+    else if (event == "onDrain")
+      list = &m_OnDrainListeners;
+
+    CHECK_CONDITION(list, "Event not supported");
+
+    list->Add(info[1].As<Napi::Function>(), info.Length() >= 3 ? info[2] : env.Undefined());
+
+    return info.This();
+  }
+
+  /**
+   * Add listener for frames with a certain identifier only. Frames nobody subscribed to
+   * (neither via onMessage nor by identifier) are dropped without calling into JS.
+   * @method addIdListener
+   * @param id {integer} CAN identifier
+   * @param ext {bool} true for a 29 bit identifier
+   * @param callback {any} JS callback object, called with the same message object as onMessage
+   * @param instance {any} Optional instance pointer to call callback
+   */
+  Napi::Value AddIdListener(const Napi::CallbackInfo& info)
+  {
+    CHECK_CONDITION(info.Length() >= 3, "Too few arguments");
+    CHECK_CONDITION(info[0].IsNumber(), "First argument must be a number");
+    CHECK_CONDITION(info[2].IsFunction(), "Third argument must be a function");
+
+    canid_t key = IdKeyOf(info[0].As<Napi::Number>().Uint32Value(), info[1].ToBoolean().Value());
+
+    ListenerList *list = m_IdListeners.Find(key);
+    if (!list)
+    {
+      list = new ListenerList;
+      m_IdListeners.Insert(key, list);
+    }
+
+    list->Add(info[2].As<Napi::Function>(), info.Length() >= 4 ? info[3] : info.Env().Undefined());
+
+    return info.This();
+  }
+
+  /**
+   * Remove listeners added with addIdListener()
+   * @method removeIdListener
+   * @param id {integer} CAN identifier
+   * @param ext {bool} true for a 29 bit identifier
+   * @param callback {any} Optional, remove only this callback instead of all listeners of the id
+   */
+  Napi::Value RemoveIdListener(const Napi::CallbackInfo& info)
+  {
+    CHECK_CONDITION(info.Length() >= 1, "Too few arguments");
+    CHECK_CONDITION(info[0].IsNumber(), "First argument must be a number");
+
+    canid_t key = IdKeyOf(info[0].As<Napi::Number>().Uint32Value(), info.Length() >= 2 && info[1].ToBoolean().Value());
+
+    ListenerList *list = m_IdListeners.Find(key);
+    if (list)
+    {
+      list->Remove(info.Length() >= 3 ? info[2] : info.Env().Undefined());
+
+      if (list->Empty())
+      {
+        m_IdListeners.Remove(key);
+
+        // A list removed by one of its own callbacks is freed once the frame is dispatched
+        if (list->Calling())
+          m_IdRetired.push_back(list);
+        else
+          delete list;
+      }
+    }
+
+    return info.This();
+  }
+
+  /**
+   * Start operation on this CAN channel
+   * @method start
+   */
+  Napi::Value Start(const Napi::CallbackInfo& info)
+  {
+    CHECK_CONDITION(IsValid(), "Cannot start invalid channel");
+
+    Napi::Env env = info.Env();
+    uv_loop_t* loop;
+    napi_get_uv_event_loop(env, &loop);
+
+    uv_async_init(loop, &m_AsyncReceiverReady, async_receiver_ready_cb);
+    m_AsyncReceiverReady.data = this;
+
+    uv_async_init(loop, &m_AsyncChannelStopped, async_channel_stopped_cb);
+    m_AsyncChannelStopped.data = this;
+
+    // Create an async context so napi_make_callback runs microtask checkpoints
+    // and fires async hooks after each onMessage callback, matching the behaviour
+    // of the old NaN implementation (which used node::MakeCallback internally).
+    napi_value resource_name;
+    napi_create_string_utf8(env, "socketcan:RawChannel:onMessage", NAPI_AUTO_LENGTH, &resource_name);
+    napi_async_init(env, (napi_value)info.This(), resource_name, &m_async_ctx);
+
+    if (m_TimestampMode == TIMESTAMPS_HARDWARE)
+      EnableHwTimestamps();
+
+    if (m_RxMode == RX_MODE_POLL)
+    {
+      // Level triggered, fires again on the next loop iteration if frames are left in the socket
+      CHECK_CONDITION(uv_poll_init(loop, &m_RxPoll, m_SocketFd) == 0, "Error registering socket with event loop");
+      m_RxPoll.data = this;
+      uv_poll_start(&m_RxPoll, UV_READABLE | UV_DISCONNECT, rx_poll_cb);
+      m_Polling = true;
+    }
+    else if (m_RxMode == RX_MODE_REACTOR)
+    {
+      RxReactor *reactor = RxReactor::Get(env);
+      CHECK_CONDITION(reactor, "Error starting receive reactor");
+
+      m_ReactorEntry = reactor->Add(this, m_SocketFd);
+      CHECK_CONDITION(m_ReactorEntry, "Error registering socket with receive reactor");
+    }
+    else
+    {
+      m_ThreadStopRequested = false;
+      pthread_create(&m_Thread, NULL, c_thread_entry, this);
+
+      CHECK_CONDITION(m_Thread, "Error starting dispatch thread");
+    }
+
+    Ref();
+
+    return info.This();
+  }
+
+  /**
+   * Stop any operations on this CAN channel
+   * @method stop
+   */
+  Napi::Value Stop(const Napi::CallbackInfo& info)
+  {
+    CHECK_CONDITION(m_Thread || m_Polling || m_ReactorEntry, "Channel not started");
+    async_channel_stopped();
+    return info.This();
+  }
+
+  /**
+   * Send a CAN message immediately.
+   *
+   * PLEASE NOTE: By default, this function may block if the Tx buffer is not available. Please use
+   * createRawChannelWithOptions({non_block_send: false}) to get non-blocking sending activated.
+   *
+   * With a transmit queue (tx_queue_size) sending never blocks, frames the socket has no room for
+   * are queued and sent once it has.
+   *
+   * @method send
+   * @param message {Object} JSON object describing the CAN message, keys are id, length, data {Buffer}, ext or rtr
+   * @return {integer|bool} result of send(), with a transmit queue false if it is full and onDrain should
+   *                        be awaited before sending more
+   */
+  Napi::Value Send(const Napi::CallbackInfo& info)
+  {
+    Napi::Env env = info.Env();
+    CHECK_CONDITION(info.Length() >= 1, "Invalid arguments");
+    CHECK_CONDITION(info[0].IsObject(), "First argument must be an Object");
+    CHECK_CONDITION(IsValid(), "Invalid channel!");
+
+    struct can_frame frame;
+    Napi::Object obj = info[0].As<Napi::Object>();
+
+    frame.can_id = obj.Get("id").As<Napi::Number>().Uint32Value();
+
+    if (obj.Get("ext").ToBoolean().Value())
+      frame.can_id |= CAN_EFF_FLAG;
+
+    if (obj.Get("rtr").ToBoolean().Value())
+      frame.can_id |= CAN_RTR_FLAG;
+
+    Napi::Value dataArg = obj.Get("data");
+    CHECK_CONDITION(dataArg.IsBuffer(), "Data field must be a Buffer");
+
+    Napi::Buffer<uint8_t> dataBuf = dataArg.As<Napi::Buffer<uint8_t>>();
+    CHECK_CONDITION(dataBuf.ByteLength() <= sizeof(frame.data), "Data field too long for a CAN frame (max 8 bytes)");
+    frame.can_dlc = dataBuf.ByteLength();
+    memcpy(frame.data, dataBuf.Data(), frame.can_dlc);
+
+    {
+      struct timeval now;
+      if (gettimeofday(&now, 0) == 0) {
+        obj.Set("ts_sec",  Napi::Number::New(env, (double)now.tv_sec));
+        obj.Set("ts_usec", Napi::Number::New(env, (double)now.tv_usec));
+      }
+    }
+
+    if (m_TxQueue)
+    {
+      struct tx_frame tx;
+      memset(&tx, 0, sizeof(tx));
+      memcpy(&tx.frame, &frame, sizeof(frame));
+      tx.mtu = CAN_MTU;
+
+      return QueueResult(info, QueueFrames(&tx, 1) == 1);
+    }
+
+    int flags = m_NonBlockingSend ? MSG_DONTWAIT : 0;
+    int i = send(m_SocketFd, &frame, sizeof(struct can_frame), flags);
+    CountSendResult(i);
+
+    return Napi::Number::New(env, i);
+  }
+
+  /**
+   * Send a CAN FD message immediately.
+   *
+   * PLEASE NOTE: By default, this function may block if the Tx buffer is not available. Please use
+   * createRawChannelWithOptions({non_block_send: false}) to get non-blocking sending activated.
+   *
+   * PLEASE NOTE: Might fail if underlying device doesnt support CAN FD. Structure is not yet validated.
+   *
+   * @method sendFD
+   * @param message {Object} JSON object describing the CAN message, keys are id, length, data {Buffer}, ext
+   * @return {integer|bool} as send()
+   */
+  Napi::Value SendFD(const Napi::CallbackInfo& info)
+  {
+    Napi::Env env = info.Env();
+    CHECK_CONDITION(info.Length() >= 1, "Invalid arguments");
+    CHECK_CONDITION(info[0].IsObject(), "First argument must be an Object");
+    CHECK_CONDITION(IsValid(), "Invalid channel!");
+
+    struct canfd_frame frameFD;
+    frameFD.flags = 0;
+
+    Napi::Object obj = info[0].As<Napi::Object>();
+
+    frameFD.can_id = obj.Get("id").As<Napi::Number>().Uint32Value();
+
+    if (obj.Get("ext").ToBoolean().Value())
+      frameFD.can_id |= CAN_EFF_FLAG;
+
+    if (obj.Get("fd_brs").ToBoolean().Value())
+      frameFD.flags |= CANFD_BRS;
+
+    Napi::Value dataArg = obj.Get("data");
+    CHECK_CONDITION(dataArg.IsBuffer(), "Data field must be a Buffer");
+
+    Napi::Buffer<uint8_t> dataBuf = dataArg.As<Napi::Buffer<uint8_t>>();
+    CHECK_CONDITION(dataBuf.ByteLength() <= sizeof(frameFD.data), "Data field too long for a CAN FD frame (max 64 bytes)");
+    frameFD.len = dataBuf.ByteLength();
+    memset(frameFD.data, 0, sizeof(frameFD.data));
+    memcpy(frameFD.data, dataBuf.Data(), frameFD.len);
+
+    {
+      struct timeval now;
+      if (gettimeofday(&now, 0) == 0) {
+        obj.Set("ts_sec",  Napi::Number::New(env, (double)now.tv_sec));
+        obj.Set("ts_usec", Napi::Number::New(env, (double)now.tv_usec));
+      }
+    }
+
+    frameFD.len = CanFdLen(frameFD.len);
+
+    if (m_TxQueue)
+    {
+      struct tx_frame tx;
+      tx.frame = frameFD;
+      tx.mtu   = CANFD_MTU;
+
+      return QueueResult(info, QueueFrames(&tx, 1) == 1);
+    }
+
     int flags = m_NonBlockingSend ? MSG_DONTWAIT : 0;
-    int i = send(m_SocketFd, &frame, sizeof(struct can_frame), flags);
+    int i = send(m_SocketFd, &frameFD, sizeof(struct canfd_frame), flags);
+    CountSendResult(i);
+
+    return Napi::Number::New(env, i);
+  }
+
+  /**
+   * Send a CAN or CAN FD frame given as plain values. Unlike send() no message object is read
+   * or stamped with ts_sec/ts_usec, and nothing is allocated.
+   *
+   * PLEASE NOTE: Same blocking behaviour as send().
+   *
+   * @method sendRaw
+   * @param id {integer} CAN identifier
+   * @param flags {integer} FrameFlags bits, EXT, RTR, FD and BRS are used
+   * @param data {Buffer} payload
+   * @param offset {integer} Optional, start of the payload in data
+   * @param length {integer} Optional, payload length (default up to the end of data)
+   * @return {integer|bool} as send()
+   */
+  Napi::Value SendRaw(const Napi::CallbackInfo& info)
+  {
+    Napi::Env env = info.Env();
+    CHECK_CONDITION(info.Length() >= 3, "Invalid arguments");
+    CHECK_CONDITION(info[0].IsNumber() && info[1].IsNumber(), "Identifier and flags must be numbers");
+    CHECK_CONDITION(info[2].IsTypedArray(), "Third argument must be a Buffer");
+    CHECK_CONDITION(IsValid(), "Invalid channel!");
+
+    Napi::Uint8Array data = info[2].As<Napi::Uint8Array>();
+    CHECK_CONDITION(data.TypedArrayType() == napi_uint8_array, "Third argument must be a Buffer");
+
+    uint32_t f      = info[1].As<Napi::Number>().Uint32Value();
+    bool     fd     = f & FRAME_FLAG_FD;
+    size_t   size   = data.ByteLength();
+    size_t   offset = info.Length() >= 4 && info[3].IsNumber() ? info[3].As<Napi::Number>().Uint32Value() : 0;
+    CHECK_CONDITION(offset <= size, "Offset beyond end of data");
+
+    size_t len = info.Length() >= 5 && info[4].IsNumber() ? info[4].As<Napi::Number>().Uint32Value() : size - offset;
+    CHECK_CONDITION(len <= size - offset, "Length beyond end of data");
+    CHECK_CONDITION(len <= (fd ? CANFD_MAX_DLEN : CAN_MAX_DLEN), "Data field too long for a CAN frame");
+
+    struct tx_frame &tx = m_TxRawFrame;
+
+    tx.frame.can_id = info[0].As<Napi::Number>().Uint32Value();
+    tx.frame.flags  = 0;
+
+    if (f & FRAME_FLAG_EXT) tx.frame.can_id |= CAN_EFF_FLAG;
+    if (!fd && (f & FRAME_FLAG_RTR)) tx.frame.can_id |= CAN_RTR_FLAG;
+    if (fd && (f & FRAME_FLAG_BRS)) tx.frame.flags |= CANFD_BRS;
+
+    memcpy(tx.frame.data, data.Data() + offset, len);
+
+    if (fd)
+    {
+      // Padding up to the next valid CAN FD length goes out as zeroes
+      memset(tx.frame.data + len, 0, CANFD_MAX_DLEN - len);
+      tx.frame.len = CanFdLen(len);
+      tx.mtu = CANFD_MTU;
+    }
+    else
+    {
+      tx.frame.len = len;
+      tx.mtu = CAN_MTU;
+    }
+
+    if (m_TxQueue)
+      return QueueResult(info, QueueFrames(&tx, 1) == 1);
+
+    int flags = m_NonBlockingSend ? MSG_DONTWAIT : 0;
+    int i = send(m_SocketFd, &tx.frame, tx.mtu, flags);
+    CountSendResult(i);
+
+    return Napi::Number::New(env, i);
+  }
+
+  /**
+   * Send several CAN / CAN FD messages with a single sendmmsg() call.
+   *
+   * Accepts either an array of message objects (as used with send(), set fd: true to send an
+   * element like sendFD()) or a packed batch in the onBatch layout, i.e. an object providing
+   * count, stride, ids, flags, lens and data (see FrameFlags for the flag bits).
+   *
+   * PLEASE NOTE: Same blocking behaviour as send(). With non_block_send the kernel may accept
+   * only part of the batch; resend the remaining frames starting at the returned index.
+   * With a transmit queue the frames the kernel does not accept are queued instead, fewer than
+   * all are taken only if the queue fills up and its policy is "reject".
+   *
+   * @method sendBatch
+   * @param frames {Array|Object} array of message objects or packed batch
+   * @return {integer} number of frames accepted by the kernel (or the transmit queue)
+   */
+  Napi::Value SendBatch(const Napi::CallbackInfo& info)
+  {
+    Napi::Env env = info.Env();
+    CHECK_CONDITION(info.Length() >= 1, "Invalid arguments");
+    CHECK_CONDITION(info[0].IsObject(), "First argument must be an Array or a batch Object");
+    CHECK_CONDITION(IsValid(), "Invalid channel!");
+
+    size_t count;
+
+    if (info[0].IsArray())
+    {
+      Napi::Array list = info[0].As<Napi::Array>();
+      count = list.Length();
+
+      if (m_TxFrames.size() < count)
+        m_TxFrames.resize(count);
+
+      for (uint32_t idx = 0; idx < count; idx++)
+      {
+        Napi::Value item = list.Get(idx);
+        CHECK_CONDITION(item.IsObject(), "Array elements must be Objects");
+
+        Napi::Object obj = item.As<Napi::Object>();
+        struct canfd_frame &frame = m_TxFrames[idx].frame;
+
+        bool fd = obj.Get("fd").ToBoolean().Value();
+
+        frame.can_id = obj.Get("id").As<Napi::Number>().Uint32Value();
+        frame.flags  = 0;
+
+        if (obj.Get("ext").ToBoolean().Value())
+          frame.can_id |= CAN_EFF_FLAG;
+
+        if (fd)
+        {
+          if (obj.Get("fd_brs").ToBoolean().Value())
+            frame.flags |= CANFD_BRS;
+        }
+        else if (obj.Get("rtr").ToBoolean().Value())
+        {
+          frame.can_id |= CAN_RTR_FLAG;
+        }
+
+        Napi::Value dataArg = obj.Get("data");
+        CHECK_CONDITION(dataArg.IsBuffer(), "Data field must be a Buffer");
+
+        Napi::Buffer<uint8_t> dataBuf = dataArg.As<Napi::Buffer<uint8_t>>();
+        CHECK_CONDITION(dataBuf.ByteLength() <= (fd ? CANFD_MAX_DLEN : CAN_MAX_DLEN), "Data field too long for a CAN frame");
+
+        memset(frame.data, 0, sizeof(frame.data));
+        memcpy(frame.data, dataBuf.Data(), dataBuf.ByteLength());
+
+        frame.len = fd ? CanFdLen(dataBuf.ByteLength()) : dataBuf.ByteLength();
+        m_TxFrames[idx].mtu = fd ? CANFD_MTU : CAN_MTU;
+      }
+    }
+    else
+    {
+      Napi::Object batch = info[0].As<Napi::Object>();
+
+      Napi::Value countArg  = batch.Get("count");
+      Napi::Value strideArg = batch.Get("stride");
+      Napi::Value idsArg    = batch.Get("ids");
+      Napi::Value flagsArg  = batch.Get("flags");
+      Napi::Value lensArg   = batch.Get("lens");
+      Napi::Value dataArg   = batch.Get("data");
+
+      CHECK_CONDITION(countArg.IsNumber() && strideArg.IsNumber(), "Batch count and stride must be numbers");
+      CHECK_CONDITION(idsArg.IsTypedArray() && flagsArg.IsTypedArray() && lensArg.IsTypedArray() && dataArg.IsTypedArray(),
+                      "Batch columns must be typed arrays");
+
+      Napi::Uint32Array ids   = idsArg.As<Napi::Uint32Array>();
+      Napi::Uint8Array  flags = flagsArg.As<Napi::Uint8Array>();
+      Napi::Uint8Array  lens  = lensArg.As<Napi::Uint8Array>();
+      Napi::Uint8Array  data  = dataArg.As<Napi::Uint8Array>();
+
+      CHECK_CONDITION(ids.TypedArrayType() == napi_uint32_array && flags.TypedArrayType() == napi_uint8_array &&
+                      lens.TypedArrayType() == napi_uint8_array && data.TypedArrayType() == napi_uint8_array,
+                      "Batch columns have unexpected types");
+
+      count = countArg.As<Napi::Number>().Uint32Value();
+      size_t stride = strideArg.As<Napi::Number>().Uint32Value();
+
+      CHECK_CONDITION(stride > 0 && stride <= CANFD_MAX_DLEN, "Invalid batch stride");
+      CHECK_CONDITION(ids.ElementLength() >= count && flags.ElementLength() >= count &&
+                      lens.ElementLength() >= count && data.ElementLength() >= count * stride,
+                      "Batch columns shorter than count");
+
+      if (m_TxFrames.size() < count)
+        m_TxFrames.resize(count);
+
+      for (size_t idx = 0; idx < count; idx++)
+      {
+        struct canfd_frame &frame = m_TxFrames[idx].frame;
+        uint8_t f   = flags[idx];
+        bool    fd  = f & FRAME_FLAG_FD;
+        size_t  len = lens[idx];
+
+        CHECK_CONDITION(len <= stride && len <= (fd ? CANFD_MAX_DLEN : CAN_MAX_DLEN), "Data field too long for a CAN frame");
+
+        frame.can_id = ids[idx];
+        frame.flags  = 0;
+
+        if (f & FRAME_FLAG_EXT) frame.can_id |= CAN_EFF_FLAG;
+        if (!fd && (f & FRAME_FLAG_RTR)) frame.can_id |= CAN_RTR_FLAG;
+        if (fd && (f & FRAME_FLAG_BRS)) frame.flags |= CANFD_BRS;
+
+        memset(frame.data, 0, sizeof(frame.data));
+        memcpy(frame.data, data.Data() + idx * stride, len);
+
+        frame.len = fd ? CanFdLen(len) : len;
+        m_TxFrames[idx].mtu = fd ? CANFD_MTU : CAN_MTU;
+      }
+    }
+
+    if (m_TxQueue)
+    {
+      size_t taken = QueueFrames(m_TxFrames.data(), count);
+
+      if (m_TxQueue->Full())
+        m_TxNeedDrain = true;
+
+      return Napi::Number::New(env, taken);
+    }
+
+    return Napi::Number::New(env, SendFrames(m_TxFrames.data(), count, m_NonBlockingSend ? MSG_DONTWAIT : 0));
+  }
+
+  /**
+   * Submit frames to the kernel with as few sendmmsg() calls as possible
+   * @return number of frames accepted, if less than count errno tells why
+   */
+  size_t SendFrames(const struct tx_frame *frames, size_t count, int flags)
+  {
+    struct mmsghdr msgs[TX_BATCH_SIZE];
+    struct iovec   iov[TX_BATCH_SIZE];
+    size_t sent = 0;
+
+    while (sent < count)
+    {
+      size_t n = count - sent;
+      if (n > TX_BATCH_SIZE)
+        n = TX_BATCH_SIZE;
+
+      for (size_t i = 0; i < n; i++)
+      {
+        iov[i].iov_base = (void *)&frames[sent + i].frame;
+        iov[i].iov_len  = frames[sent + i].mtu;
+
+        memset(&msgs[i].msg_hdr, 0, sizeof(msgs[i].msg_hdr));
+        msgs[i].msg_hdr.msg_iov    = &iov[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+      }
+
+      int accepted = sendmmsg(m_SocketFd, msgs, n, flags);
+
+      if (accepted < 0)
+      {
+        CountSendResult(accepted);
+        break;
+      }
+
+      // Nothing sent and no error, report it like a full queue so that callers retry
+      if (accepted == 0)
+      {
+        errno = EAGAIN;
+        break;
+      }
+
+      // A short count means a later frame failed, the next call reports why
+      CountStat(STAT_TX_FRAMES, accepted);
+      sent += accepted;
+    }
+
+    return sent;
+  }
+
+  /**
+   * Hand frames to the transmit queue. They are sent right away as long as nothing is queued
+   * and the socket has room, the others are queued behind subject to the overflow policy.
+   * @return number of frames taken, less than count only if the queue is full and rejects
+   */
+  size_t QueueFrames(const struct tx_frame *frames, size_t count)
+  {
+    size_t taken = 0;
+    int    error = EAGAIN;
+
+    while (taken < count && m_TxQueue->Empty())
+    {
+      taken += SendFrames(frames + taken, count - taken, MSG_DONTWAIT);
+
+      if (taken == count)
+        return count;
+
+      error = errno;
+      if (error == EAGAIN || error == EWOULDBLOCK || error == ENOBUFS)
+        break;
+
+      // Cannot be sent at all, counted in txErrors
+      taken++;
+    }
+
+    for (; taken < count; taken++)
+    {
+      if (m_TxQueue->Full())
+      {
+        if (m_TxOverflow == TX_OVERFLOW_REJECT)
+          break;
+
+        CountStat(STAT_TX_QUEUE_DROPPED);
+
+        if (m_TxOverflow == TX_OVERFLOW_DROP_NEWEST)
+          continue;
+
+        m_TxQueue->Release(1);
+      }
+
+      m_TxQueue->Push(frames[taken]);
+    }
+
+    if (!m_TxArmed && !m_TxQueue->Empty())
+    {
+      // Keep the channel alive until the queue is sent
+      m_TxArmed = true;
+      Ref();
+      WaitForTxRoom(error);
+    }
+
+    return taken;
+  }
+
+  /**
+   * Return value of send() and sendFD() with a transmit queue
+   */
+  Napi::Value QueueResult(const Napi::CallbackInfo& info, bool taken)
+  {
+    CHECK_CONDITION(taken, "Transmit queue full");
+
+    if (m_TxQueue->Full())
+      m_TxNeedDrain = true;
+
+    return Napi::Boolean::New(info.Env(), !m_TxQueue->Full());
+  }
+
+  /**
+   * Flush the transmit queue again once the socket is writable (EAGAIN) or, as CAN sockets
+   * stay writable while the device queue is full, after TX_RETRY_MS (ENOBUFS)
+   */
+  void WaitForTxRoom(int error)
+  {
+    if (!m_TxTimer)
+    {
+      uv_loop_t* loop;
+      napi_get_uv_event_loop(m_napi_env, &loop);
+
+      m_TxTimer = new uv_timer_t;
+      uv_timer_init(loop, m_TxTimer);
+      m_TxTimer->data = this;
+
+      // uv_poll allows only one handle per descriptor and RX_MODE_POLL has one on the socket already
+      m_TxPollFd = dup(m_SocketFd);
+
+      if (m_TxPollFd >= 0)
+      {
+        m_TxPoll = new uv_poll_t;
+        if (uv_poll_init(loop, m_TxPoll, m_TxPollFd) == 0)
+        {
+          m_TxPoll->data = this;
+        }
+        else
+        {
+          delete m_TxPoll;
+          m_TxPoll = nullptr;
+        }
+      }
+    }
+
+    if (error == ENOBUFS || !m_TxPoll)
+      uv_timer_start(m_TxTimer, tx_timer_cb, TX_RETRY_MS, 0);
+    else
+      uv_poll_start(m_TxPoll, UV_WRITABLE, tx_poll_cb);
+  }
+
+  static void tx_poll_cb(uv_poll_t* handle, int status, int events)
+  {
+    assert(handle && handle->data);
+    reinterpret_cast<RawChannel*>(handle->data)->FlushTxQueue();
+  }
+
+  static void tx_timer_cb(uv_timer_t* handle)
+  {
+    assert(handle && handle->data);
+    reinterpret_cast<RawChannel*>(handle->data)->FlushTxQueue();
+  }
+
+  /**
+   * Send as much of the transmit queue as the socket takes, notify onDrain once it is empty
+   */
+  void FlushTxQueue()
+  {
+    if (m_TxPoll)
+      uv_poll_stop(m_TxPoll);
+    uv_timer_stop(m_TxTimer);
+
+    while (!m_TxQueue->Empty())
+    {
+      size_t count = m_TxQueue->Contiguous();
+      size_t sent  = SendFrames(m_TxQueue->Head(), count, MSG_DONTWAIT);
+
+      m_TxQueue->Release(sent);
+
+      if (sent == count)
+        continue;
+
+      int error = errno;
+      if (error == EAGAIN || error == EWOULDBLOCK || error == ENOBUFS)
+      {
+        WaitForTxRoom(error);
+        return;
+      }
+
+      // Cannot be sent at all, counted in txErrors
+      m_TxQueue->Release(1);
+    }
+
+    m_TxArmed = false;
+
+    if (m_TxNeedDrain)
+    {
+      Napi::Env env(m_napi_env);
+      Napi::HandleScope scope(env);
+
+      m_TxNeedDrain = false;
+      CallListeners(env, m_OnDrainListeners, env.Undefined());
+    }
+
+    Unref();
+  }
+
+  /**
+   * Set a list of active filters to be applied for incoming messages
+   * @method setRxFilters
+   * @param filters {Object} single filter or array of filter e.g. { id: 0x1ff, mask: 0x1ff, invert: false}
+   */
+  Napi::Value SetRxFilters(const Napi::CallbackInfo& info)
+  {
+    CHECK_CONDITION(info.Length() > 0, "Too few arguments");
+    CHECK_CONDITION(info[0].IsArray() || info[0].IsObject(), "Invalid argument");
+    CHECK_CONDITION(IsValid(), "Channel not ready");
+
+    struct can_filter *rfilter;
+    int numfilter = 0;
+
+    if (info[0].IsArray())
+    {
+      Napi::Array list = info[0].As<Napi::Array>();
+      rfilter = (struct can_filter *)malloc(sizeof(struct can_filter) * list.Length());
+      CHECK_CONDITION(rfilter, "Couldn't allocate memory for filter list");
+
+      for (uint32_t idx = 0; idx < list.Length(); idx++)
+      {
+        if (ObjectToFilter(list.Get(idx).As<Napi::Object>(), &rfilter[numfilter]))
+          numfilter++;
+      }
+    }
+    else
+    {
+      rfilter = (struct can_filter *)malloc(sizeof(struct can_filter));
+      CHECK_CONDITION(rfilter, "Couldn't allocate memory for filter list");
+
+      if (ObjectToFilter(info[0].As<Napi::Object>(), &rfilter[numfilter]))
+        numfilter++;
+    }
+
+    if (numfilter)
+      setsockopt(m_SocketFd, SOL_CAN_RAW, CAN_RAW_FILTER, rfilter, numfilter * sizeof(struct can_filter));
+
+    if (rfilter)
+      free(rfilter);
+
+    return info.This();
+  }
+
+  /**
+   * Set a list of active filters to be applied for errors
+   * @method setErrorFilters
+   * @param errorMask {Uint32} CAN error mask
+   */
+  Napi::Value SetErrorFilters(const Napi::CallbackInfo& info)
+  {
+    CHECK_CONDITION(info.Length() > 0, "Too few arguments");
+    CHECK_CONDITION(info[0].IsNumber(), "Invalid argument");
+    CHECK_CONDITION(IsValid(), "Channel not ready");
+
+    can_err_mask_t err_mask = (can_err_mask_t)info[0].As<Napi::Number>().Uint32Value();
+    setsockopt(m_SocketFd, SOL_CAN_RAW, CAN_RAW_ERR_FILTER, &err_mask, sizeof(err_mask));
+
+    return info.This();
+  }
+
+  /**
+   * Get the counters of this channel accumulated since its creation or the last resetStats()
+   * @method getStats
+   * @return {Object} rxFrames, rxBytes, rxDropped, rxRingFull, txFrames, txEagain, txEnobufs, txErrors,
+   *                  wakeups, wakeupFrames, wakeupFramesMax, wakeupsTruncated, callbackErrors
+   */
+  Napi::Value GetStats(const Napi::CallbackInfo& info)
+  {
+    Napi::Env env = info.Env();
+    Napi::Object obj = Napi::Object::New(env);
+
+    for (int i = 0; i < STAT_COUNT; i++)
+      obj.Set(ChannelStatNames[i], Napi::Number::New(env, (double)(m_Stats[i].load(std::memory_order_relaxed) - m_StatsBase[i])));
+
+    return obj;
+  }
+
+  /**
+   * Restart all counters reported by getStats() from zero
+   * @method resetStats
+   */
+  Napi::Value ResetStats(const Napi::CallbackInfo& info)
+  {
+    // Counters written by the reader thread are never reset in place, getStats() reports
+    // the difference to this snapshot instead.
+    for (int i = 0; i < STAT_COUNT; i++)
+      m_StatsBase[i] = m_Stats[i].load(std::memory_order_relaxed);
+
+    // Only ever written by the main thread
+    m_Stats[STAT_WAKEUP_FRAMES_MAX] = 0;
+    m_StatsBase[STAT_WAKEUP_FRAMES_MAX] = 0;
+
+    return info.This();
+  }
+
+  /**
+   * Measure the latency of the receive path. Disabled by default, it costs one clock read
+   * per recvmmsg() call and two per dispatched frame while enabled.
+   * @method enableLatencyHistograms
+   * @param enable {bool} Optional, false to stop measuring (default true)
+   */
+  Napi::Value EnableLatencyHistograms(const Napi::CallbackInfo& info)
+  {
+    bool enable = info.Length() < 1 || info[0].ToBoolean().Value();
+    m_LatencyEnabled.store(enable, std::memory_order_relaxed);
+    return info.This();
+  }
+
+  /**
+   * Get the latency histograms of the receive path, all values in nanoseconds
+   * @method getLatencyHistograms
+   * @return {Object} kernelToThread, threadToDispatch and dispatchToReturn, each { count, p50, p99, p999, max }
+   */
+  Napi::Value GetLatencyHistograms(const Napi::CallbackInfo& info)
+  {
+    Napi::Env env = info.Env();
+    Napi::Object obj = Napi::Object::New(env);
+
+    for (int i = 0; i < LATENCY_STAGE_COUNT; i++)
+    {
+      const LatencyHistogram &h = m_Latency[i];
+      Napi::Object stage = Napi::Object::New(env);
+
+      stage.Set("count", Napi::Number::New(env, (double)h.Count()));
+      stage.Set("p50",   Napi::Number::New(env, (double)h.Percentile(0.5)));
+      stage.Set("p99",   Napi::Number::New(env, (double)h.Percentile(0.99)));
+      stage.Set("p999",  Napi::Number::New(env, (double)h.Percentile(0.999)));
+      stage.Set("max",   Napi::Number::New(env, (double)h.Max()));
+
+      obj.Set(LatencyStageNames[i], stage);
+    }
+
+    return obj;
+  }
+
+  /**
+   * Clear the latency histograms
+   * @method resetLatencyHistograms
+   */
+  Napi::Value ResetLatencyHistograms(const Napi::CallbackInfo& info)
+  {
+    for (int i = 0; i < LATENCY_STAGE_COUNT; i++)
+      m_Latency[i].Reset();
+
+    return info.This();
+  }
+
+  /**
+   * Write all received frames to a file. Frames are recorded by the receiving thread and never
+   * pass through JS, recording ends with stopRecording() or when the channel stops.
+   * @method startRecording
+   * @param path {string} file to write, with rotation enabled files are numbered path.0, path.1, ...
+   * @param options {Object} Optional, format {string} "binary" (default) or "candump", maxSize {integer}
+   *                bytes per file, maxTime {integer} seconds per file, flushInterval {integer} longest time
+   *                in ms a frame stays buffered (default 1000), bufferSize {integer} bytes buffered for the
+   *                writer thread (default 4 MiB)
+   */
+  Napi::Value StartRecording(const Napi::CallbackInfo& info)
+  {
+    CHECK_CONDITION(IsValid(), "Channel not ready");
+    CHECK_CONDITION(info.Length() >= 1 && info[0].IsString(), "First argument must be a string");
+    CHECK_CONDITION(!m_Recorder.load(), "Recording already active");
+
+    Napi::Object options = (info.Length() >= 2 && info[1].IsObject()) ? info[1].As<Napi::Object>()
+                                                                       : Napi::Object::New(info.Env());
+
+    FrameRecorder::options opts;
+    opts.path        = info[0].As<Napi::String>().Utf8Value();
+    opts.ifname      = m_Name;
+    opts.format      = RECORD_BINARY;
+    opts.max_size    = 0;
+    opts.max_time_ns = 0;
+    opts.flush_ns    = 1000000000ULL;
+    opts.block_size  = 64 * 1024;
+    opts.blocks      = 64;
+
+    Napi::Value format = options.Get("format");
+    if (format.IsString())
+    {
+      std::string name = format.As<Napi::String>().Utf8Value();
+      CHECK_CONDITION(name == "binary" || name == "candump", "Invalid recording format");
+
+      if (name == "candump")
+        opts.format = RECORD_CANDUMP;
+    }
+
+    Napi::Value value = options.Get("maxSize");
+    if (value.IsNumber())
+      opts.max_size = value.As<Napi::Number>().Int64Value();
+
+    value = options.Get("maxTime");
+    if (value.IsNumber())
+      opts.max_time_ns = value.As<Napi::Number>().DoubleValue() * 1e9;
+
+    value = options.Get("flushInterval");
+    if (value.IsNumber())
+      opts.flush_ns = value.As<Napi::Number>().DoubleValue() * 1e6;
+
+    value = options.Get("bufferSize");
+    if (value.IsNumber())
+      opts.blocks = std::max<int64_t>(value.As<Napi::Number>().Int64Value() / (int64_t)opts.block_size, 2);
+
+    FrameRecorder *recorder = new FrameRecorder(opts);
+
+    int err = recorder->Start();
+    if (err)
+    {
+      delete recorder;
+      Napi::Error::New(info.Env(), std::string("Error starting recording: ") + strerror(err)).ThrowAsJavaScriptException();
+      return info.Env().Undefined();
+    }
+
+    pthread_mutex_lock(&m_RecorderMtx);
+    m_Recorder.store(recorder, std::memory_order_release);
+    pthread_mutex_unlock(&m_RecorderMtx);
+
+    return info.This();
+  }
+
+  /**
+   * Stop recording, buffered frames are written and the file is closed
+   * @method stopRecording
+   * @return {Object} final counters as reported by getRecordingStats()
+   */
+  Napi::Value StopRecording(const Napi::CallbackInfo& info)
+  {
+    FrameRecorder *recorder = DetachRecorder();
+    CHECK_CONDITION(recorder, "Recording not active");
+
+    Napi::Object stats = RecordingStatsOf(info.Env(), recorder);
+    delete recorder;
+
+    return stats;
+  }
+
+  /**
+   * Write all buffered frames and wait until they reached the disk
+   * @method flushRecording
+   */
+  Napi::Value FlushRecording(const Napi::CallbackInfo& info)
+  {
+    FrameRecorder *recorder = m_Recorder.load(std::memory_order_acquire);
+    CHECK_CONDITION(recorder, "Recording not active");
+
+    // Only the main thread ever stops a recorder, it stays valid here
+    recorder->Flush();
+
+    return info.This();
+  }
+
+  /**
+   * Get the counters of the active recording
+   * @method getRecordingStats
+   * @return {Object} written and dropped frames, bytes written, files opened and error (if writing failed)
+   */
+  Napi::Value GetRecordingStats(const Napi::CallbackInfo& info)
+  {
+    FrameRecorder *recorder = m_Recorder.load(std::memory_order_acquire);
+    CHECK_CONDITION(recorder, "Recording not active");
+
+    return RecordingStatsOf(info.Env(), recorder);
+  }
+
+  static Napi::Object RecordingStatsOf(Napi::Env env, const FrameRecorder *recorder)
+  {
+    Napi::Object obj = Napi::Object::New(env);
+
+    obj.Set("written", Napi::Number::New(env, (double)recorder->Written()));
+    obj.Set("dropped", Napi::Number::New(env, (double)recorder->Dropped()));
+    obj.Set("bytes",   Napi::Number::New(env, (double)recorder->Bytes()));
+    obj.Set("files",   Napi::Number::New(env, (double)recorder->Files()));
+
+    if (recorder->Error())
+      obj.Set("error", Napi::String::New(env, strerror(recorder->Error())));
+
+    return obj;
+  }
+
+  /**
+   * Publish every received frame to a shared ring that worker threads read without any message
+   * passing. Waiting readers are woken with Atomics.notify() once per wakeup of this channel.
+   * Replaces a ring attached before.
+   * @method attachSharedRing
+   * @param ring {Int32Array} view of a SharedArrayBuffer initialized by createSharedRing()
+   */
+  Napi::Value AttachSharedRing(const Napi::CallbackInfo& info)
+  {
+    Napi::Env env = info.Env();
+
+    CHECK_CONDITION(IsValid(), "Channel not ready");
+    CHECK_CONDITION(info.Length() >= 1 && info[0].IsTypedArray(), "First argument must be an Int32Array");
+
+    Napi::Int32Array view = info[0].As<Napi::Int32Array>();
+    CHECK_CONDITION(view.TypedArrayType() == napi_int32_array, "First argument must be an Int32Array");
+
+    SharedFrameRing *ring = SharedFrameRing::Attach(reinterpret_cast<uint8_t *>(view.Data()), view.ByteLength());
+    CHECK_CONDITION(ring, "Not a shared frame ring");
+
+    delete DetachRing();
+
+    Napi::Object atomics = env.Global().Get("Atomics").As<Napi::Object>();
+
+    m_SharedRingView.Reset(view, 1);
+    m_AtomicsNotify = Napi::Persistent(atomics.Get("notify").As<Napi::Function>());
+    m_SharedRingNotified = ring->Written();
+
+    pthread_mutex_lock(&m_SharedRingMtx);
+    m_SharedRing.store(ring, std::memory_order_release);
+    pthread_mutex_unlock(&m_SharedRingMtx);
+
+    return info.This();
+  }
+
+  /**
+   * Stop publishing to the shared ring, readers keep what was published so far
+   * @method detachSharedRing
+   */
+  Napi::Value DetachSharedRing(const Napi::CallbackInfo& info)
+  {
+    SharedFrameRing *ring = DetachRing();
+    CHECK_CONDITION(ring, "No shared ring attached");
+
+    delete ring;
+    return info.This();
+  }
+
+  /**
+   * Take the shared ring away from the receiving thread
+   * @return the ring (to be deleted by the caller) or nullptr
+   */
+  SharedFrameRing *DetachRing()
+  {
+    if (!m_SharedRing.load())
+      return nullptr;
+
+    pthread_mutex_lock(&m_SharedRingMtx);
+    SharedFrameRing *ring = m_SharedRing.exchange(nullptr);
+    pthread_mutex_unlock(&m_SharedRingMtx);
+
+    m_SharedRingView.Reset();
+    m_AtomicsNotify.Reset();
+
+    return ring;
+  }
+
+  // Called by the receiving thread with freshly received slots
+  void Publish(const struct rx_slot *slots, size_t count)
+  {
+    pthread_mutex_lock(&m_SharedRingMtx);
+
+    SharedFrameRing *ring = m_SharedRing.load(std::memory_order_relaxed);
+    if (ring)
+      ring->Publish(slots, count);
+
+    pthread_mutex_unlock(&m_SharedRingMtx);
+  }
+
+  /**
+   * Wake the readers of the shared ring if frames were published since the last call
+   */
+  void NotifySharedRing(Napi::Env env)
+  {
+    SharedFrameRing *ring = m_SharedRing.load(std::memory_order_acquire);
+    if (!ring)
+      return;
+
+    uint64_t written = ring->Written();
+    if (written == m_SharedRingNotified)
+      return;
+
+    m_SharedRingNotified = written;
+
+    // Index 4 is the notify word of the ring header
+    m_AtomicsNotify.Call({ m_SharedRingView.Value(), Napi::Number::New(env, 4) });
+
+    if (env.IsExceptionPending())
+      env.GetAndClearPendingException();
+  }
+
+  /**
+   * Take the recorder away from the receiving thread and finish its files
+   * @return the stopped recorder (to be deleted by the caller) or nullptr
+   */
+  FrameRecorder *DetachRecorder()
+  {
+    if (!m_Recorder.load())
+      return nullptr;
+
+    pthread_mutex_lock(&m_RecorderMtx);
+    FrameRecorder *recorder = m_Recorder.exchange(nullptr);
+    pthread_mutex_unlock(&m_RecorderMtx);
+
+    recorder->Stop();
+    return recorder;
+  }
+
+  /**
+   * Transmit a capture (binary or candump format) on this channel, paced by a native thread
+   * against the original timestamps. onReplayDone listeners receive the final stats.
+   * @method startReplay
+   * @param path {string} capture to replay
+   * @param options {Object} Optional, speed {number} time scale (2 replays twice as fast, default 1),
+   *                loop {bool|integer} true to repeat until stopReplay() or number of passes (default 1),
+   *                loopGap {number} ms of capture time between passes (default the mean frame spacing),
+   *                maxRate {bool} ignore timestamps and send as fast as possible,
+   *                remap {Object} identifier replacements { [from]: to }, the frame format is kept.
+   *                Keys are 11 bit identifiers, 29 bit ones have CAN_EFF_FLAG (0x80000000) set.
+   */
+  Napi::Value StartReplay(const Napi::CallbackInfo& info)
+  {
+    CHECK_CONDITION(IsValid(), "Channel not ready");
+    CHECK_CONDITION(info.Length() >= 1 && info[0].IsString(), "First argument must be a string");
+    CHECK_CONDITION(!m_Replayer, "Replay already active");
+
+    Napi::Env env = info.Env();
+    Napi::Object options = (info.Length() >= 2 && info[1].IsObject()) ? info[1].As<Napi::Object>()
+                                                                       : Napi::Object::New(env);
+
+    FrameReplayer::options opts;
+    opts.speed    = 1.0;
+    opts.loops    = 1;
+    opts.max_rate = options.Get("maxRate").ToBoolean().Value();
+    opts.loop_gap = -1;
+
+    Napi::Value speed = options.Get("speed");
+    if (speed.IsNumber())
+    {
+      opts.speed = speed.As<Napi::Number>().DoubleValue();
+      CHECK_CONDITION(opts.speed > 0, "Speed must be positive");
+    }
+
+    Napi::Value loop = options.Get("loop");
+    if (loop.IsBoolean())
+      opts.loops = loop.As<Napi::Boolean>().Value() ? 0 : 1;
+    else if (loop.IsNumber())
+      opts.loops = loop.As<Napi::Number>().Uint32Value();
+
+    Napi::Value loopGap = options.Get("loopGap");
+    if (loopGap.IsNumber())
+    {
+      double gap = loopGap.As<Napi::Number>().DoubleValue();
+      CHECK_CONDITION(gap >= 0, "Loop gap must not be negative");
+      opts.loop_gap = (int64_t)(gap * 1e6);
+    }
+
+    Napi::Value remap = options.Get("remap");
+    if (remap.IsObject())
+    {
+      Napi::Object table = remap.As<Napi::Object>();
+      Napi::Array keys = table.GetPropertyNames();
+
+      for (uint32_t i = 0; i < keys.Length(); i++)
+      {
+        std::string key = keys.Get(i).ToString().Utf8Value();
+        Napi::Value to  = table.Get(key);
+
+        CHECK_CONDITION(to.IsNumber(), "Remap targets must be numbers");
+
+        // Keys may be written in hex ("0x123") as well
+        char *end;
+        errno = 0;
+        unsigned long long from = strtoull(key.c_str(), &end, 0);
+
+        CHECK_CONDITION(!key.empty() && *end == '\0' && errno == 0 && key[0] != '-', "Remap key " + key + " is not a number");
+
+        bool ext = from & CAN_EFF_FLAG;
+        CHECK_CONDITION(from <= (ext ? (CAN_EFF_FLAG | CAN_EFF_MASK) : CAN_SFF_MASK),
+                        "Remap key " + key + " is not an 11 bit identifier or a 29 bit one with 0x80000000 set");
+
+        opts.remap.push_back(std::make_pair(IdKeyOf(from, ext), to.As<Napi::Number>().Uint32Value()));
+      }
+
+      std::sort(opts.remap.begin(), opts.remap.end());
+    }
+
+    uv_loop_t* uvloop;
+    napi_get_uv_event_loop(env, &uvloop);
+
+    uv_async_t *done = new uv_async_t;
+    uv_async_init(uvloop, done, async_replay_done_cb);
+    done->data = this;
+
+    FrameReplayer *replayer = new FrameReplayer(m_SocketFd, m_Stats, opts, done);
+
+    int err = replayer->Start(info[0].As<Napi::String>().Utf8Value());
+    if (err)
+    {
+      delete replayer;
+      uv_close((uv_handle_t *)done, [](uv_handle_t *handle) { delete (uv_async_t *)handle; });
+
+      Napi::Error::New(env, std::string("Error starting replay: ") + strerror(err)).ThrowAsJavaScriptException();
+      return env.Undefined();
+    }
+
+    m_Replayer = replayer;
+
+    // Keep the channel alive until onReplayDone was delivered
+    Ref();
+
+    return info.This();
+  }
+
+  /**
+   * Stop the replay early, onReplayDone follows
+   * @method stopReplay
+   */
+  Napi::Value StopReplay(const Napi::CallbackInfo& info)
+  {
+    CHECK_CONDITION(m_Replayer, "Replay not active");
+    m_Replayer->Stop();
+    return info.This();
+  }
+
+  /**
+   * Get the progress of the active replay
+   * @method getReplayStats
+   * @return {Object} sent, errors, loops, stopped, duration (ms) and unless maxRate timingError, the delay
+   *                  of the transmissions against their target time in ns { count, mean, p50, p99, p999, max }
+   */
+  Napi::Value GetReplayStats(const Napi::CallbackInfo& info)
+  {
+    CHECK_CONDITION(m_Replayer, "Replay not active");
+    return m_Replayer->StatsOf(info.Env());
+  }
+
+  static void async_replay_done_cb(uv_async_t* handle)
+  {
+    assert(handle && handle->data);
+    reinterpret_cast<RawChannel*>(handle->data)->async_replay_done();
+  }
+
+  void async_replay_done()
+  {
+    Napi::Env env(m_napi_env);
+    Napi::HandleScope scope(env);
+
+    FrameReplayer *replayer = m_Replayer;
+    m_Replayer = nullptr;
+
+    replayer->Join();
+
+    Napi::Object stats = replayer->StatsOf(env);
+
+    uv_close((uv_handle_t *)replayer->DoneHandle(), [](uv_handle_t *handle) { delete (uv_async_t *)handle; });
+    delete replayer;
+
+    CallListeners(env, m_OnReplayDoneListeners, stats);
+
+    Unref();
+  }
+
+  // Called by the receiving thread with freshly received slots
+  void Record(const struct rx_slot *slots, size_t count)
+  {
+    pthread_mutex_lock(&m_RecorderMtx);
+
+    FrameRecorder *recorder = m_Recorder.load(std::memory_order_relaxed);
+    if (recorder)
+      recorder->Append(slots, count);
+
+    pthread_mutex_unlock(&m_RecorderMtx);
+  }
+
+  /**
+   * Record the latency of a frame up to the start of its dispatch at dispatch_ns
+   */
+  void RecordDispatchLatency(const struct rx_slot &slot, uint64_t dispatch_ns)
+  {
+    // Frames fetched before measuring was enabled carry no read time
+    if (!slot.read_ns)
+      return;
+
+    // Hardware timestamps come from the controller clock and cannot be compared
+    if (m_TimestampMode == TIMESTAMPS_SOFTWARE && slot.ts_ns && slot.read_ns >= slot.ts_ns)
+      m_Latency[LATENCY_KERNEL_TO_THREAD].Record(slot.read_ns - slot.ts_ns);
+
+    if (dispatch_ns >= slot.read_ns)
+      m_Latency[LATENCY_THREAD_TO_DISPATCH].Record(dispatch_ns - slot.read_ns);
+  }
+
+  /**
+   * Record the time from dispatch_ns until now for count frames
+   */
+  void RecordReturnLatency(uint64_t dispatch_ns, uint64_t count)
+  {
+    uint64_t now = RealtimeNs();
+
+    if (now >= dispatch_ns)
+      m_Latency[LATENCY_DISPATCH_TO_RETURN].Record(now - dispatch_ns, count);
+  }
+
+  void CountStat(ChannelStat stat, uint64_t n = 1)
+  {
+    m_Stats[stat].fetch_add(n, std::memory_order_relaxed);
+  }
+
+  void CountSendResult(int result)
+  {
+    if (result >= 0)
+      CountStat(STAT_TX_FRAMES);
+    else if (errno == EAGAIN || errno == EWOULDBLOCK)
+      CountStat(STAT_TX_EAGAIN);
+    else if (errno == ENOBUFS)
+      CountStat(STAT_TX_ENOBUFS);
+    else
+      CountStat(STAT_TX_ERRORS);
+  }
+
+  /**
+   * Disable loopback of channel. By default it is activated
+   * @method disableLoopback
+   */
+  Napi::Value DisableLoopback(const Napi::CallbackInfo& info)
+  {
+    CHECK_CONDITION(IsValid(), "Channel not ready");
+    const int loopback = 0;
+    setsockopt(m_SocketFd, SOL_CAN_RAW, CAN_RAW_LOOPBACK, &loopback, sizeof(loopback));
+    return info.This();
+  }
+
+  void stopThread()
+  {
+    if (m_Thread)
+    {
+      pthread_mutex_lock(&m_RxRingFullMtx);
+      m_ThreadStopRequested = true;
+      pthread_cond_signal(&m_RxRingFullCond);
+      pthread_mutex_unlock(&m_RxRingFullMtx);
+
+      pthread_join(m_Thread, NULL);
+      m_Thread = 0;
+    }
+  }
+
+  uv_async_t m_AsyncReceiverReady;
+  uv_async_t m_AsyncChannelStopped;
+
+  ListenerList m_OnMessageListeners;
+  ListenerList m_OnBatchListeners;
+  ListenerList m_OnChannelStoppedListeners;
+  ListenerList m_OnReplayDoneListeners;
+  ListenerList m_OnDrainListeners;
+
+  // addIdListener() subscriptions, a list is removed once its last listener is
+  IdTable<ListenerList> m_IdListeners;
+  std::vector<ListenerList *> m_IdRetired;  // removed while invoked, freed after the dispatch
+
+  pthread_t m_Thread;
+
+  RxMode    m_RxMode;
+  uv_poll_t m_RxPoll;   // RX_MODE_POLL only
+  bool      m_Polling;
+
+  // RX_MODE_REACTOR only
+  reactor_entry    *m_ReactorEntry;
+  std::atomic<bool> m_ReactorQueued;  // in the ready list of the reactor
+  std::string m_Name;
+
+  // Reader thread sleeps on m_RxRingFullCond while the receive ring is full
+  pthread_mutex_t m_RxRingFullMtx;
+  pthread_cond_t  m_RxRingFullCond;
+  bool            m_RxRingFull;
+
+  RxRing *m_RxRing;
+  size_t  m_RxBatched;   // frames at the head of m_RxRing already handed to onBatch listeners
+
+  // Slabs backing the payload Buffers if rx_pooled was requested, shared with the Buffers handed out
+  std::shared_ptr<RxSlabPool> m_RxPool;
+
+  // Encoded frames of the last sendBatch() call, kept to avoid reallocation
+  std::vector<struct tx_frame> m_TxFrames;
+
+  // Frame encoded by sendRaw()
+  struct tx_frame m_TxRawFrame;
+
+  // recvmmsg() scratch space, only touched by the reader thread
+  struct mmsghdr m_RxMsgs[RX_BATCH_SIZE];
+  struct iovec   m_RxIov[RX_BATCH_SIZE];
+  char           m_RxCtrl[RX_BATCH_SIZE][RX_CTRL_SIZE];
+
+  // Receive path latency, written by the main thread only
+  std::atomic<bool> m_LatencyEnabled;
+  LatencyHistogram  m_Latency[LATENCY_STAGE_COUNT];
+
+  // getStats() counters and the values they had at the last resetStats()
+  std::atomic<uint64_t> m_Stats[STAT_COUNT];
+  uint64_t              m_StatsBase[STAT_COUNT];
+
+  int m_SocketFd;
+  struct sockaddr_can m_SocketAddr;
+
+  bool m_ThreadStopRequested;
+
+  // Active startRecording(), swapped under m_RecorderMtx which the receiving thread holds while appending
+  std::atomic<FrameRecorder *> m_Recorder;
+  pthread_mutex_t              m_RecorderMtx;
+
+  // Active startReplay(), only touched by the main thread
+  FrameReplayer *m_Replayer;
+
+  // Active attachSharedRing(), swapped under m_SharedRingMtx which the receiving thread holds while publishing
+  std::atomic<SharedFrameRing *>    m_SharedRing;
+  pthread_mutex_t                   m_SharedRingMtx;
+  Napi::Reference<Napi::Int32Array> m_SharedRingView;      // keeps the SharedArrayBuffer alive
+  Napi::FunctionReference           m_AtomicsNotify;
+  uint64_t                          m_SharedRingNotified;  // write index at the last Atomics.notify()
+
+  TimestampMode m_TimestampMode;
+  struct hwtstamp_config m_HwTstampSaved;     // device config found by start() with hardware timestamps
+  bool                   m_HwTstampRestore;   // m_HwTstampSaved has to be written back on stop
+  bool m_NonBlockingSend;
+
+  // Frames waiting for room in the socket if tx_queue_size was requested, main thread only
+  TxQueue    *m_TxQueue;
+  TxOverflow  m_TxOverflow;
+  int         m_TxPollFd;     // dup() of the socket watched by m_TxPoll
+  uv_poll_t  *m_TxPoll;       // created with the first queued frame, like m_TxTimer
+  uv_timer_t *m_TxTimer;
+  bool        m_TxArmed;      // frames queued, waiting for m_TxPoll or m_TxTimer, channel Ref()ed
+  bool        m_TxNeedDrain;  // a send returned false, onDrain is due once the queue is empty
+
+  // Stored for use in uv_async callbacks (always invoked on the main thread)
+  napi_env m_napi_env;
+  napi_async_context m_async_ctx;
+
+  static void * c_thread_entry(void *_this) { assert(_this); reinterpret_cast<RawChannel *>(_this)->ThreadEntry(); return NULL; }
+
+  void ThreadEntry()
+  {
+    struct pollfd pfd;
+
+    pfd.fd     = m_SocketFd;
+    pfd.events = POLLIN|POLLHUP|POLLERR;
+
+    while (!m_ThreadStopRequested)
+    {
+      pfd.revents = 0;
+
+      // Stop pulling from the socket while the main thread catches up, the kernel
+      // queue keeps buffering in the meantime.
+      pthread_mutex_lock(&m_RxRingFullMtx);
+
+      while (unlikely(m_RxRing->Full() && !m_ThreadStopRequested))
+      {
+        if (!m_RxRingFull)
+          CountStat(STAT_RX_RING_FULL);
+        m_RxRingFull = true;
+        pthread_cond_wait(&m_RxRingFullCond, &m_RxRingFullMtx);
+      }
+
+      m_RxRingFull = false;
+
+      pthread_mutex_unlock(&m_RxRingFullMtx);
+
+      if (likely(poll(&pfd, 1, 100) >= 0))
+      {
+        if (likely(pfd.revents & POLLIN))
+        {
+          if (ReceiveIntoRing() > 0)
+            uv_async_send(&m_AsyncReceiverReady);
+        }
+
+        if (pfd.revents & (POLLHUP|POLLERR))
+        {
+          uv_async_send(&m_AsyncChannelStopped);
+          break;
+        }
+      }
+      else
+      {
+        break;
+      }
+    }
+  }
+
+  /**
+   * Drain the socket into the receive ring using recvmmsg() until either the socket
+   * has no more frames or the ring is full. Runs on the reader thread.
+   * @return number of frames added to the ring
+   */
+  size_t ReceiveIntoRing()
+  {
+    size_t total = 0;
+
+    for (;;)
+    {
+      struct rx_slot *slots;
+      size_t n = m_RxRing->WritableSlots(&slots);
+
+      if (n == 0)
+        break;
+
+      if (n > RX_BATCH_SIZE)
+        n = RX_BATCH_SIZE;
+
+      for (size_t i = 0; i < n; i++)
+      {
+        m_RxIov[i].iov_base = &slots[i].frame;
+        m_RxIov[i].iov_len  = sizeof(struct canfd_frame);
+
+        memset(&m_RxMsgs[i].msg_hdr, 0, sizeof(m_RxMsgs[i].msg_hdr));
+        m_RxMsgs[i].msg_hdr.msg_iov        = &m_RxIov[i];
+        m_RxMsgs[i].msg_hdr.msg_iovlen     = 1;
+        m_RxMsgs[i].msg_hdr.msg_control    = m_RxCtrl[i];
+        m_RxMsgs[i].msg_hdr.msg_controllen = sizeof(m_RxCtrl[i]);
+      }
+
+      int received = recvmmsg(m_SocketFd, m_RxMsgs, n, MSG_DONTWAIT, NULL);
+
+      if (received <= 0)
+        break;
+
+      uint64_t bytes   = 0;
+      uint64_t read_ns = m_LatencyEnabled.load(std::memory_order_relaxed) ? RealtimeNs() : 0;
+
+      for (int i = 0; i < received; i++)
+      {
+        struct rx_slot &slot = slots[i];
+        struct msghdr  &hdr  = m_RxMsgs[i].msg_hdr;
+
+        slot.mtu     = m_RxMsgs[i].msg_len;
+        slot.ts_ns   = 0;
+        slot.read_ns = read_ns;
+
+        // Classic frames leave the CAN FD flags byte undefined
+        if (slot.mtu != CANFD_MTU)
+          slot.frame.flags = 0;
+
+        for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&hdr); cmsg; cmsg = CMSG_NXTHDR(&hdr, cmsg))
+        {
+          if (cmsg->cmsg_level != SOL_SOCKET)
+            continue;
+
+          if (cmsg->cmsg_type == SO_RXQ_OVFL)
+          {
+            // Number of frames the kernel dropped on this socket so far
+            uint32_t dropped;
+            memcpy(&dropped, CMSG_DATA(cmsg), sizeof(dropped));
+            m_Stats[STAT_RX_DROPPED].store(dropped, std::memory_order_relaxed);
+            continue;
+          }
+
+          uint64_t ts_ns = TimestampOf(cmsg);
+          if (ts_ns)
+            slot.ts_ns = ts_ns;
+        }
+
+        bytes += slot.frame.len & 0x7f;
+      }
+
+      CountStat(STAT_RX_FRAMES, received);
+      CountStat(STAT_RX_BYTES, bytes);
+
+      if (m_Recorder.load(std::memory_order_acquire))
+        Record(slots, received);
+
+      if (m_SharedRing.load(std::memory_order_acquire))
+        Publish(slots, received);
+
+      m_RxRing->Commit(received);
+      total += received;
+
+      if ((size_t)received < n)
+        break;
+    }
+
+    return total;
+  }
+
+  /**
+   * Request receive timestamps according to m_TimestampMode. Hardware timestamping has to be
+   * switched on at the device too, see EnableHwTimestamps(); without it the kernel delivers
+   * software timestamps via the same control message.
+   */
+  void EnableTimestamps(struct ifreq *ifr)
+  {
+    const int timestamp_on = 1;
+
+    if (m_TimestampMode == TIMESTAMPS_HARDWARE)
+    {
+      const int flags = SOF_TIMESTAMPING_RX_HARDWARE | SOF_TIMESTAMPING_RAW_HARDWARE |
+                        SOF_TIMESTAMPING_RX_SOFTWARE | SOF_TIMESTAMPING_SOFTWARE;
+
+      if (setsockopt(m_SocketFd, SOL_SOCKET, SO_TIMESTAMPING, &flags, sizeof(flags)) == 0)
+        return;
+
+      m_TimestampMode = TIMESTAMPS_SOFTWARE;
+    }
+
+    if (setsockopt(m_SocketFd, SOL_SOCKET, SO_TIMESTAMPNS, &timestamp_on, sizeof(timestamp_on)) != 0)
+      setsockopt(m_SocketFd, SOL_SOCKET, SO_TIMESTAMP, &timestamp_on, sizeof(timestamp_on));
+  }
+
+  /**
+   * Switch on hardware timestamping at the device, which needs CAP_NET_ADMIN and driver support.
+   * The setting applies to every socket of the device, so the previous one is saved and put
+   * back by RestoreHwTimestamps() when the channel stops.
+   */
+  void EnableHwTimestamps()
+  {
+    struct ifreq ifr;
+    memset(&ifr, 0, sizeof(ifr));
+    strncpy(ifr.ifr_name, m_Name.c_str(), IFNAMSIZ - 1);
+
+    // Without a readable config there is nothing to restore, leave the device alone
+    memset(&m_HwTstampSaved, 0, sizeof(m_HwTstampSaved));
+    ifr.ifr_data = (char *)&m_HwTstampSaved;
+    if (ioctl(m_SocketFd, SIOCGHWTSTAMP, &ifr) != 0)
+      return;
+
+    if (m_HwTstampSaved.rx_filter == HWTSTAMP_FILTER_ALL)
+      return;
+
+    struct hwtstamp_config config = m_HwTstampSaved;
+    config.rx_filter = HWTSTAMP_FILTER_ALL;
+
+    ifr.ifr_data = (char *)&config;
+    m_HwTstampRestore = ioctl(m_SocketFd, SIOCSHWTSTAMP, &ifr) == 0;
+  }
+
+  void RestoreHwTimestamps()
+  {
+    if (!m_HwTstampRestore)
+      return;
+
+    struct ifreq ifr;
+    memset(&ifr, 0, sizeof(ifr));
+    strncpy(ifr.ifr_name, m_Name.c_str(), IFNAMSIZ - 1);
+    ifr.ifr_data = (char *)&m_HwTstampSaved;
+
+    ioctl(m_SocketFd, SIOCSHWTSTAMP, &ifr);
+    m_HwTstampRestore = false;
+  }
+
+  /**
+   * Receive timestamp in ns carried by a SOL_SOCKET control message, 0 if it carries none
+   */
+  static uint64_t TimestampOf(struct cmsghdr *cmsg)
+  {
+    switch (cmsg->cmsg_type)
+    {
+      case SCM_TIMESTAMPING:
+      {
+        // ts[0] software, ts[2] raw hardware timestamp, unused entries are zero
+        struct scm_timestamping stamps;
+        memcpy(&stamps, CMSG_DATA(cmsg), sizeof(stamps));
+
+        const struct timespec &ts = (stamps.ts[2].tv_sec || stamps.ts[2].tv_nsec) ? stamps.ts[2] : stamps.ts[0];
+        return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+      }
+
+      case SCM_TIMESTAMPNS:
+      {
+        struct timespec ts;
+        memcpy(&ts, CMSG_DATA(cmsg), sizeof(ts));
+        return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+      }
+
+      case SCM_TIMESTAMP:
+      {
+        struct timeval tv;
+        memcpy(&tv, CMSG_DATA(cmsg), sizeof(tv));
+        return (uint64_t)tv.tv_sec * 1000000000ULL + (uint64_t)tv.tv_usec * 1000ULL;
+      }
+
+      default:
+        return 0;
+    }
+  }
+
+  bool IsValid() { return m_SocketFd >= 0; }
+
+  static bool ObjectToFilter(Napi::Object object, struct can_filter *rfilter)
+  {
+    Napi::Value id   = object.Get("id");
+    Napi::Value mask = object.Get("mask");
+
+    if (!id.IsNumber() || !mask.IsNumber())
+      return false;
+
+    rfilter->can_id   = id.As<Napi::Number>().Uint32Value();
+    rfilter->can_mask = mask.As<Napi::Number>().Uint32Value();
+
+    if (object.Get("invert").ToBoolean().Value())
+      rfilter->can_id |= CAN_INV_FILTER;
+
+    rfilter->can_mask &= ~CAN_ERR_FLAG;
+
+    return true;
+  }
+
+  static void async_receiver_ready_cb(uv_async_t* handle)
+  {
+    assert(handle && handle->data);
+    reinterpret_cast<RawChannel*>(handle->data)->async_receiver_ready();
+  }
+
+  static void rx_poll_cb(uv_poll_t* handle, int status, int events)
+  {
+    assert(handle && handle->data);
+    reinterpret_cast<RawChannel*>(handle->data)->rx_poll_ready(status, events);
+  }
+
+  /**
+   * RX_MODE_POLL: the socket became readable, receive and dispatch right away on the loop thread
+   */
+  void rx_poll_ready(int status, int events)
+  {
+    if (status < 0 || (events & UV_DISCONNECT))
+    {
+      async_channel_stopped();
+      return;
+    }
+
+    // Frames still in the ring (the previous round was truncated) keep their order, new ones
+    // are appended behind them.
+    ReceiveIntoRing();
+    async_receiver_ready();
+  }
+
+  static void async_channel_stopped_cb(uv_async_t* handle)
+  {
+    assert(handle && handle->data);
+    reinterpret_cast<RawChannel*>(handle->data)->async_channel_stopped();
+  }
+
+  void async_channel_stopped()
+  {
+    Napi::Env env(m_napi_env);
+    Napi::HandleScope scope(env);
+
+    CallListeners(env, m_OnChannelStoppedListeners, nullptr);
+
+    if (m_Polling)
+    {
+      uv_poll_stop(&m_RxPoll);
+      uv_close((uv_handle_t *)&m_RxPoll, NULL);
+      m_Polling = false;
+      uv_close((uv_handle_t *)&m_AsyncReceiverReady, NULL);
+      uv_close((uv_handle_t *)&m_AsyncChannelStopped, NULL);
+    }
+
+    if (m_ReactorEntry)
+    {
+      RxReactor::Get(m_napi_env)->Remove(m_ReactorEntry, m_SocketFd);
+      m_ReactorEntry = nullptr;
+      uv_close((uv_handle_t *)&m_AsyncReceiverReady, NULL);
+      uv_close((uv_handle_t *)&m_AsyncChannelStopped, NULL);
+    }
+
+    if (m_Thread)
+    {
+      stopThread();
+      uv_close((uv_handle_t *)&m_AsyncReceiverReady, NULL);
+      uv_close((uv_handle_t *)&m_AsyncChannelStopped, NULL);
+    }
+
+    if (m_async_ctx) {
+      napi_async_destroy(m_napi_env, m_async_ctx);
+      m_async_ctx = nullptr;
+    }
+
+    // Nothing is received anymore, finish the files
+    delete DetachRecorder();
+
+    RestoreHwTimestamps();
+
+    Unref();
+  }
+
+  /**
+   * Invoke every listener in the list with arg, exceptions are counted as callback errors
+   * @return false if a callback threw (the exception has been forwarded to Node.js)
+   */
+  bool CallListeners(Napi::Env env, ListenerList &listeners, napi_value arg)
+  {
+    if (listeners.Call(env, m_async_ctx, arg))
+      return true;
+
+    CountStat(STAT_CALLBACK_ERRORS);
+    return false;
+  }
+
+  /**
+   * Hand the frames first..end of the ring to the onBatch listeners as one columnar batch.
+   * The frames stay in the ring.
+   */
+  bool DispatchBatch(Napi::Env env, size_t first, size_t end)
+  {
+    size_t count = end - first;
+    size_t stride = CAN_MAX_DLEN;
+    for (size_t i = first; i < end; i++)
+    {
+      if (m_RxRing->At(i).mtu == CANFD_MTU)
+      {
+        stride = CANFD_MAX_DLEN;
+        break;
+      }
+    }
+
+    struct frame_batch batch;
+    Napi::Object obj = NewFrameBatch(env, count, stride, &batch);
+
+    for (size_t i = 0; i < count; i++)
+    {
+      const struct rx_slot &slot = m_RxRing->At(first + i);
+      uint8_t len = slot.frame.len & 0x7f;
+
+      if (len > stride)
+        len = stride;
+
+      batch.ts_ns[i] = slot.ts_ns;
+      batch.ids[i]   = FrameIdOf(slot.frame);
+      batch.flags[i] = FrameFlagsOf(slot.frame, slot.mtu == CANFD_MTU);
+      batch.lens[i]  = len;
+
+      memcpy(batch.data + i * stride, slot.frame.data, len);
+      memset(batch.data + i * stride + len, 0, stride - len);
+    }
+
+    return CallListeners(env, m_OnBatchListeners, obj);
+  }
+
+  /**
+   * Listeners subscribed to the identifier of frame, nullptr if there are none
+   */
+  ListenerList *IdListenersOf(const struct canfd_frame &frame) const
+  {
+    if (frame.can_id & CAN_ERR_FLAG)
+      return nullptr;
+
+    ListenerList *list = m_IdListeners.Find(IdKeyOf(frame.can_id, frame.can_id & CAN_EFF_FLAG));
+    return (list && !list->Empty()) ? list : nullptr;
+  }
+
+  /**
+   * Payload Buffer of a received frame: a copy, or with pooled receive buffers a view into the
+   * slab shared by the frames of this wakeup
+   */
+  Napi::Value PayloadOf(Napi::Env env, const struct canfd_frame &frame, struct rx_slab_cursor *cursor)
+  {
+    size_t len = frame.len & 0x7f;
+
+    if (!m_RxPool)
+      return Napi::Buffer<char>::Copy(env, (char *)frame.data, len);
+
+    if (!cursor->slab || cursor->used + len > RX_SLAB_SIZE)
+    {
+      cursor->buffer = m_RxPool->Acquire(env, &cursor->slab);
+      cursor->used   = 0;
+    }
+
+    memcpy(cursor->slab->data + cursor->used, frame.data, len);
+
+    napi_value view;
+    if (node_api_create_buffer_from_arraybuffer(env, cursor->buffer, cursor->used, len, &view) != napi_ok)
+      return Napi::Buffer<char>::Copy(env, (char *)frame.data, len);
+
+    cursor->used += len;
+    return Napi::Value(env, view);
+  }
+
+  /**
+   * Hand the oldest frame of the ring to the onMessage and id listeners as one JS object.
+   * Frames without any interested listener are released without creating an object.
+   * dispatch_ns is the start of the round with latency measuring on, 0 otherwise.
+   */
+  bool DispatchMessage(Napi::Env env, struct rx_slab_cursor *cursor, uint64_t dispatch_ns)
+  {
+    const struct rx_slot &slot = m_RxRing->At(0);
+    const struct canfd_frame &frame = slot.frame;
+
+    if (m_OnMessageListeners.Empty() && !IdListenersOf(frame))
+    {
+      m_RxRing->Release(1);
+
+      if (dispatch_ns)
+        RecordReturnLatency(dispatch_ns, 1);
+      return true;
+    }
+
+    canid_t key = IdKeyOf(frame.can_id, frame.can_id & CAN_EFF_FLAG);
+    bool isIdDispatched = !(frame.can_id & CAN_ERR_FLAG);
+
+    Napi::Object obj = Napi::Object::New(env);
+
+    bool isEff    = frame.can_id & CAN_EFF_FLAG;
+    bool isRtr    = frame.can_id & CAN_RTR_FLAG;
+    bool isErr    = frame.can_id & CAN_ERR_FLAG;
+
+    if (m_TimestampMode != TIMESTAMPS_NONE && slot.ts_ns)
+    {
+      obj.Set("ts_sec",  Napi::Number::New(env, (double)(slot.ts_ns / 1000000000ULL)));
+      obj.Set("ts_usec", Napi::Number::New(env, (double)(slot.ts_ns % 1000000000ULL / 1000)));
+      obj.Set("ts_ns",   Napi::BigInt::New(env, slot.ts_ns));
+    }
+
+    obj.Set("id", Napi::Number::New(env, FrameIdOf(frame)));
+
+    if (isEff) obj.Set("ext", Napi::Boolean::New(env, isEff));
+    if (isRtr) obj.Set("rtr", Napi::Boolean::New(env, isRtr));
+    if (isErr) obj.Set("err", Napi::Boolean::New(env, isErr));
+
+    obj.Set("data", PayloadOf(env, frame, cursor));
+
+    // The frame has been copied into JS land, let the reader thread reuse the slot
+    m_RxRing->Release(1);
+
+    bool ok = CallListeners(env, m_OnMessageListeners, obj);
+
+    if (ok)
+    {
+      // Looked up again as onMessage callbacks may have changed the subscriptions
+      ListenerList *idListeners = isIdDispatched ? m_IdListeners.Find(key) : nullptr;
+
+      ok = !idListeners || CallListeners(env, *idListeners, obj);
+    }
+
+    if (dispatch_ns)
+      RecordReturnLatency(dispatch_ns, 1);
+
+    return ok;
+  }
+
+  void FreeRetiredIdListeners()
+  {
+    for (ListenerList *list : m_IdRetired)
+      delete list;
+    m_IdRetired.clear();
+  }
+
+  void async_receiver_ready()
+  {
+    if (!m_async_ctx) return;
+
+    Napi::Env env(m_napi_env);
+    Napi::HandleScope scope(env);
+
+    // Bound the work done per wakeup so a busy bus cannot starve the event loop,
+    // anything left over is picked up by the next iteration.
+    size_t framesAvailable = m_RxRing->Readable();
+    if (framesAvailable > MAX_FRAMES_PER_ASYNC_EVENT)
+    {
+      framesAvailable = MAX_FRAMES_PER_ASYNC_EVENT;
+      CountStat(STAT_WAKEUPS_TRUNCATED);
+    }
+
+    NotifySharedRing(env);
+
+    CountStat(STAT_WAKEUPS);
+    CountStat(STAT_WAKEUP_FRAMES, framesAvailable);
+    if (framesAvailable > m_Stats[STAT_WAKEUP_FRAMES_MAX].load(std::memory_order_relaxed))
+      m_Stats[STAT_WAKEUP_FRAMES_MAX].store(framesAvailable, std::memory_order_relaxed);
+
+    // Each frame counts once in the latencies, whether it goes to onBatch, onMessage or both.
+    // Frames left in the ring by an interrupted previous round were recorded and batched already.
+    bool latency = m_LatencyEnabled.load(std::memory_order_relaxed);
+    uint64_t dispatch_ns = latency ? RealtimeNs() : 0;
+
+    if (latency)
+    {
+      for (size_t i = m_RxBatched; i < framesAvailable; i++)
+        RecordDispatchLatency(m_RxRing->At(i), dispatch_ns);
+    }
+
+    if (framesAvailable > m_RxBatched && !m_OnBatchListeners.Empty())
+      DispatchBatch(env, m_RxBatched, framesAvailable);
+
+    if (framesAvailable > m_RxBatched)
+      m_RxBatched = framesAvailable;
+
+    struct rx_slab_cursor cursor = { Napi::ArrayBuffer(), nullptr, 0 };
+    size_t consumed = 0;
+
+    if (m_OnMessageListeners.Empty() && m_IdListeners.Empty())
+    {
+      m_RxRing->Release(framesAvailable);
+      consumed = framesAvailable;
+
+      if (latency)
+        RecordReturnLatency(dispatch_ns, consumed);
+    }
+    else
+    {
+      // A callback may have stopped the channel or thrown, leave the rest for the next wakeup.
+      // Every call releases its frame, whether the listeners succeeded or not.
+      while (consumed < framesAvailable && m_async_ctx)
+      {
+        consumed++;
+        if (!DispatchMessage(env, &cursor, dispatch_ns))
+          break;
+      }
+    }
+
+    m_RxBatched -= consumed;
+
+    FreeRetiredIdListeners();
+
+    if (m_ReactorEntry)
+    {
+      RxReactor::Get(m_napi_env)->Resume(m_ReactorEntry, m_SocketFd);
+    }
+    else
+    {
+      pthread_mutex_lock(&m_RxRingFullMtx);
+      if (m_RxRingFull)
+        pthread_cond_signal(&m_RxRingFullCond);
+      pthread_mutex_unlock(&m_RxRingFullMtx);
+    }
+
+    if (m_async_ctx && m_RxRing->Readable() > 0)
+      uv_async_send(&m_AsyncReceiverReady);
+  }
+};
+
+//-----------------------------------------------------------------------------------------
+
+RxReactor::RxReactor(napi_env env)
+  : m_Env(env), m_EpollFd(-1), m_StopFd(-1), m_WorkerCount(1)
+{
+  pthread_mutex_init(&m_ReadyMtx, NULL);
+}
+
+/**
+ * Reactor of the given environment, created on first use. nullptr if it cannot be set up.
+ */
+RxReactor *RxReactor::Get(napi_env env)
+{
+  void *data = nullptr;
+  napi_get_instance_data(env, &data);
+
+  if (data)
+    return static_cast<RxReactor *>(data);
+
+  RxReactor *reactor = new RxReactor(env);
+
+  reactor->m_EpollFd = epoll_create1(EPOLL_CLOEXEC);
+  reactor->m_StopFd  = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+
+  if (reactor->m_EpollFd < 0 || reactor->m_StopFd < 0)
+    goto on_error;
+
+  {
+    // Level triggered and never read, so every worker sees it once written
+    struct epoll_event ev;
+    ev.events   = EPOLLIN;
+    ev.data.ptr = nullptr;
+
+    if (epoll_ctl(reactor->m_EpollFd, EPOLL_CTL_ADD, reactor->m_StopFd, &ev) != 0)
+      goto on_error;
+  }
+
+  {
+    uv_loop_t *loop;
+    napi_get_uv_event_loop(env, &loop);
+
+    uv_async_init(loop, &reactor->m_AsyncReady, async_ready_cb);
+    reactor->m_AsyncReady.data = reactor;
+
+    // Must not keep the loop alive, started channels hold their own references
+    uv_unref((uv_handle_t *)&reactor->m_AsyncReady);
+  }
+
+  napi_set_instance_data(env, reactor, NULL, NULL);
+  napi_add_env_cleanup_hook(env, cleanup_hook, reactor);
+
+  return reactor;
+
+  on_error:
+  if (reactor->m_EpollFd >= 0) close(reactor->m_EpollFd);
+  if (reactor->m_StopFd >= 0) close(reactor->m_StopFd);
+  delete reactor;
+  return nullptr;
+}
+
+/**
+ * Set the number of workers, started ones are kept. Workers run once a channel was added.
+ */
+bool RxReactor::SetWorkers(unsigned workers)
+{
+  if (m_Workers.empty() || workers > m_WorkerCount)
+    m_WorkerCount = workers;
+
+  return m_Workers.empty() || StartWorkers();
+}
+
+bool RxReactor::StartWorkers()
+{
+  while (m_Workers.size() < m_WorkerCount)
+  {
+    reactor_worker *worker = new reactor_worker;
+    worker->reactor = this;
+    worker->rounds  = 0;
+
+    if (pthread_create(&worker->thread, NULL, c_worker_entry, worker) != 0)
+    {
+      delete worker;
+      return false;
+    }
+
+    m_Workers.push_back(worker);
+  }
+
+  return true;
+}
+
+void RxReactor::FreeEntry(reactor_entry *entry)
+{
+  pthread_mutex_destroy(&entry->mtx);
+  delete entry;
+}
+
+void RxReactor::FreeRetiredEntries()
+{
+  size_t kept = 0;
+
+  for (retired_entry &retired : m_Retired)
+  {
+    bool referenced = false;
+
+    for (size_t i = 0; i < retired.rounds.size() && !referenced; i++)
+      referenced = m_Workers[i]->rounds.load(std::memory_order_acquire) <= retired.rounds[i];
+
+    if (referenced)
+      m_Retired[kept++] = std::move(retired);
+    else
+      FreeEntry(retired.entry);
+  }
+
+  m_Retired.resize(kept);
+}
+
+void RxReactor::Arm(reactor_entry *entry, int fd, int op)
+{
+  struct epoll_event ev;
+  ev.events   = EPOLLIN | EPOLLONESHOT;
+  ev.data.ptr = entry;
+
+  epoll_ctl(m_EpollFd, op, fd, &ev);
+}
+
+reactor_entry *RxReactor::Add(RawChannel *channel, int fd)
+{
+  // Fewer workers than requested still receive
+  if (!StartWorkers() && m_Workers.empty())
+    return nullptr;
+
+  reactor_entry *entry = new reactor_entry;
+
+  pthread_mutex_init(&entry->mtx, NULL);
+  entry->channel = channel;
+  entry->stalled = false;
+
+  struct epoll_event ev;
+  ev.events   = EPOLLIN | EPOLLONESHOT;
+  ev.data.ptr = entry;
+
+  if (epoll_ctl(m_EpollFd, EPOLL_CTL_ADD, fd, &ev) != 0)
+  {
+    FreeEntry(entry);
+    return nullptr;
+  }
+
+  m_Entries.push_back(entry);
+  return entry;
+}
+
+void RxReactor::Remove(reactor_entry *entry, int fd)
+{
+  // Waits for a worker currently receiving for this channel
+  pthread_mutex_lock(&entry->mtx);
+  epoll_ctl(m_EpollFd, EPOLL_CTL_DEL, fd, NULL);
+  RawChannel *channel = entry->channel;
+  entry->channel = nullptr;
+  pthread_mutex_unlock(&entry->mtx);
+
+  pthread_mutex_lock(&m_ReadyMtx);
+  for (RawChannel *&ready : m_Ready)
+    if (ready == channel)
+      ready = nullptr;
+  pthread_mutex_unlock(&m_ReadyMtx);
+
+  for (RawChannel *&ready : m_Dispatching)
+    if (ready == channel)
+      ready = nullptr;
+
+  m_Entries.erase(std::find(m_Entries.begin(), m_Entries.end(), entry));
+
+  retired_entry retired;
+  retired.entry = entry;
+  for (reactor_worker *worker : m_Workers)
+    retired.rounds.push_back(worker->rounds.load(std::memory_order_acquire));
+
+  m_Retired.push_back(std::move(retired));
+  FreeRetiredEntries();
+}
+
+/**
+ * Called by the main thread after draining a channel, polls it again if a worker stopped
+ * because its ring was full
+ */
+void RxReactor::Resume(reactor_entry *entry, int fd)
+{
+  pthread_mutex_lock(&entry->mtx);
+
+  if (entry->stalled && entry->channel && !entry->channel->m_RxRing->Full())
+  {
+    entry->stalled = false;
+    Arm(entry, fd, EPOLL_CTL_MOD);
+  }
+
+  pthread_mutex_unlock(&entry->mtx);
+}
+
+void RxReactor::WorkerEntry(reactor_worker *worker)
+{
+  struct epoll_event events[16];
+
+  for (;;)
+  {
+    int n = epoll_wait(m_EpollFd, events, 16, -1);
+
+    if (n < 0)
+    {
+      if (errno == EINTR)
+        continue;
+      return;
+    }
+
+    bool wakeup = false;
+    bool stop = false;
+
+    for (int i = 0; i < n; i++)
+    {
+      reactor_entry *entry = static_cast<reactor_entry *>(events[i].data.ptr);
+
+      // Handle the other events of this round first, their sockets are not armed again
+      if (!entry)
+      {
+        stop = true;
+        continue;
+      }
+
+      pthread_mutex_lock(&entry->mtx);
+
+      RawChannel *channel = entry->channel;
+
+      if (channel)
+      {
+        if (events[i].events & (EPOLLHUP | EPOLLERR))
+        {
+          // Not re-armed, the channel is being stopped
+          uv_async_send(&channel->m_AsyncChannelStopped);
+        }
+        else
+        {
+          if (channel->ReceiveIntoRing() > 0 && !channel->m_ReactorQueued.exchange(true))
+          {
+            pthread_mutex_lock(&m_ReadyMtx);
+            m_Ready.push_back(channel);
+            pthread_mutex_unlock(&m_ReadyMtx);
+            wakeup = true;
+          }
+
+          if (channel->m_RxRing->Full())
+          {
+            if (!entry->stalled)
+              channel->CountStat(STAT_RX_RING_FULL);
+            entry->stalled = true;
+          }
+          else
+          {
+            Arm(entry, channel->m_SocketFd, EPOLL_CTL_MOD);
+          }
+        }
+      }
+
+      pthread_mutex_unlock(&entry->mtx);
+    }
+
+    // One wakeup of the event loop for everything received in this round
+    if (wakeup)
+      uv_async_send(&m_AsyncReady);
+
+    // Entries of this round are no longer referenced
+    worker->rounds.fetch_add(1, std::memory_order_release);
+
+    if (stop)
+      return;
+  }
+}
+
+void RxReactor::async_ready_cb(uv_async_t *handle)
+{
+  assert(handle && handle->data);
+  reinterpret_cast<RxReactor *>(handle->data)->async_ready();
+}
+
+void RxReactor::async_ready()
+{
+  pthread_mutex_lock(&m_ReadyMtx);
+  m_Dispatching.swap(m_Ready);
+  pthread_mutex_unlock(&m_ReadyMtx);
+
+  // Entries are cleared by Remove() if a callback stops one of the channels
+  for (size_t i = 0; i < m_Dispatching.size(); i++)
+  {
+    RawChannel *channel = m_Dispatching[i];
+
+    if (channel)
+    {
+      channel->m_ReactorQueued = false;
+      channel->async_receiver_ready();
+    }
+  }
+
+  m_Dispatching.clear();
+
+  FreeRetiredEntries();
+}
+
+void RxReactor::cleanup_hook(void *arg)
+{
+  static_cast<RxReactor *>(arg)->Shutdown();
+}
+
+void RxReactor::Shutdown()
+{
+  uint64_t one = 1;
+  ssize_t written = write(m_StopFd, &one, sizeof(one));
+  (void)written;
+
+  for (reactor_worker *worker : m_Workers)
+  {
+    pthread_join(worker->thread, NULL);
+    delete worker;
+  }
+  m_Workers.clear();
+
+  close(m_EpollFd);
+  close(m_StopFd);
+
+  for (reactor_entry *entry : m_Entries)
+    FreeEntry(entry);
+  m_Entries.clear();
+
+  for (retired_entry &retired : m_Retired)
+    FreeEntry(retired.entry);
+  m_Retired.clear();
+
+  napi_set_instance_data(m_Env, NULL, NULL, NULL);
+
+  uv_close((uv_handle_t *)&m_AsyncReady, [](uv_handle_t *handle) {
+    delete static_cast<RxReactor *>(handle->data);
+  });
+}
+
+//-----------------------------------------------------------------------------------------
+/**
+ * Access to the kernel broadcast manager (CAN_BCM) of a CAN interface. The kernel transmits
+ * cyclic messages on its own timers, so their timing does not depend on the event loop, and
+ * filters received messages for content changes and missing cycles.
+ * @class BcmChannel
+ */
+class BcmChannel : public Napi::ObjectWrap<BcmChannel>
+{
+public:
+  static Napi::Object Init(Napi::Env env, Napi::Object exports)
+  {
+    Napi::Function func = DefineClass(env, "BcmChannel", {
+      InstanceMethod("setupCyclic",  &BcmChannel::SetupCyclic),
+      InstanceMethod("updateCyclic", &BcmChannel::UpdateCyclic),
+      InstanceMethod("stopCyclic",   &BcmChannel::StopCyclic),
+      InstanceMethod("addListener",  &BcmChannel::AddListener),
+      InstanceMethod("setupRx",      &BcmChannel::SetupRx),
+      InstanceMethod("removeRx",     &BcmChannel::RemoveRx),
+      InstanceMethod("close",        &BcmChannel::Close),
+    });
+
+    exports.Set("BcmChannel", func);
+    return exports;
+  }
+
+  /**
+   * Create a new broadcast manager channel
+   * @constructor BcmChannel
+   * @param interface {string} interface name to create channel on (e.g. can0)
+   * @return new BcmChannel object
+   */
+  explicit BcmChannel(const Napi::CallbackInfo& info)
+    : Napi::ObjectWrap<BcmChannel>(info), m_SocketFd(-1), m_Polling(false), m_async_ctx(nullptr)
+  {
+    Napi::Env env = info.Env();
+
+    if (!info.IsConstructCall()) {
+      Napi::Error::New(env, "Must be called with new").ThrowAsJavaScriptException();
+      return;
+    }
+    if (info.Length() < 1 || !info[0].IsString()) {
+      Napi::Error::New(env, "First argument must be a string").ThrowAsJavaScriptException();
+      return;
+    }
+
+    std::string name = info[0].As<Napi::String>().Utf8Value();
+
+    m_SocketFd = socket(PF_CAN, SOCK_DGRAM, CAN_BCM);
+
+    if (m_SocketFd >= 0)
+    {
+      struct ifreq ifr;
+      struct sockaddr_can addr;
+
+      memset(&ifr, 0, sizeof(ifr));
+      strncpy(ifr.ifr_name, name.c_str(), IFNAMSIZ - 1);
+
+      memset(&addr, 0, sizeof(addr));
+      addr.can_family = PF_CAN;
+
+      if (ioctl(m_SocketFd, SIOCGIFINDEX, &ifr) == 0)
+      {
+        addr.can_ifindex = ifr.ifr_ifindex;
+
+        if (connect(m_SocketFd, (struct sockaddr *)&addr, sizeof(addr)) == 0)
+          return;
+      }
+
+      close(m_SocketFd);
+      m_SocketFd = -1;
+    }
+
+    Napi::Error::New(env, "Error while creating BCM channel").ThrowAsJavaScriptException();
+  }
+
+  ~BcmChannel()
+  {
+    if (m_SocketFd >= 0)
+      close(m_SocketFd);
+  }
+
+private:
+  /**
+   * One BCM request carrying a single frame. bcm_msg_head ends in a flexible array, so the
+   * frame is placed behind it in raw storage.
+   */
+  struct bcm_request
+  {
+    alignas(struct bcm_msg_head) uint8_t raw[sizeof(struct bcm_msg_head) + sizeof(struct canfd_frame)];
+
+    struct bcm_msg_head &head() { return *reinterpret_cast<struct bcm_msg_head *>(raw); }
+    struct canfd_frame &frame() { return *reinterpret_cast<struct canfd_frame *>(raw + sizeof(struct bcm_msg_head)); }
+  };
+
+  /**
+   * Set up (or replace) a kernel TX job sending the message cyclically
+   * @method setupCyclic
+   * @param message {Object} CAN message as used with RawChannel.send(), set fd: true for CAN FD
+   * @param interval {integer} cycle time in ms
+   * @param count {integer} Optional, number of frames sent with count_interval before switching to interval (default 0)
+   * @param count_interval {integer} Optional, cycle time in ms of the first count frames
+   */
+  Napi::Value SetupCyclic(const Napi::CallbackInfo& info)
+  {
+    CHECK_CONDITION(IsValid(), "Channel closed");
+    CHECK_CONDITION(info.Length() >= 2, "Too few arguments");
+    CHECK_CONDITION(info[0].IsObject(), "First argument must be an Object");
+    CHECK_CONDITION(info[1].IsNumber(), "Interval must be a number");
+
+    struct bcm_request req;
+    memset(&req, 0, sizeof(req));
+
+    CHECK_CONDITION(FrameFromObject(info[0].As<Napi::Object>(), &req), "Invalid message");
+
+    double interval       = info[1].As<Napi::Number>().DoubleValue();
+    uint32_t count        = (info.Length() >= 3 && info[2].IsNumber()) ? info[2].As<Napi::Number>().Uint32Value() : 0;
+    double count_interval = (info.Length() >= 4 && info[3].IsNumber()) ? info[3].As<Napi::Number>().DoubleValue() : 0;
+
+    CHECK_CONDITION(interval > 0 || count > 0, "Interval must be positive");
+
+    req.head().opcode = TX_SETUP;
+    req.head().flags |= SETTIMER | STARTTIMER;
+    req.head().count  = count;
+    req.head().ival1  = MsToTimeval(count_interval);
+    req.head().ival2  = MsToTimeval(interval);
+
+    CHECK_CONDITION(Write(&req), "Error setting up BCM TX job");
+
+    return info.This();
+  }
+
+  /**
+   * Replace the content of a running TX job, its timing stays untouched
+   * @method updateCyclic
+   * @param message {Object} CAN message with the id of a job set up with setupCyclic()
+   */
+  Napi::Value UpdateCyclic(const Napi::CallbackInfo& info)
+  {
+    CHECK_CONDITION(IsValid(), "Channel closed");
+    CHECK_CONDITION(info.Length() >= 1 && info[0].IsObject(), "First argument must be an Object");
+
+    struct bcm_request req;
+    memset(&req, 0, sizeof(req));
+
+    CHECK_CONDITION(FrameFromObject(info[0].As<Napi::Object>(), &req), "Invalid message");
+
+    // Without SETTIMER the kernel only copies the new frame content into the job
+    req.head().opcode = TX_SETUP;
+
+    CHECK_CONDITION(Write(&req), "Error updating BCM TX job");
+
+    return info.This();
+  }
+
+  /**
+   * Remove a TX job
+   * @method stopCyclic
+   * @param id {integer} CAN identifier of the job
+   * @param ext {bool} Optional, true for a 29 bit identifier
+   * @param fd {bool} Optional, true if the job sends CAN FD frames
+   */
+  Napi::Value StopCyclic(const Napi::CallbackInfo& info)
+  {
+    CHECK_CONDITION(IsValid(), "Channel closed");
+    CHECK_CONDITION(info.Length() >= 1 && info[0].IsNumber(), "First argument must be a number");
+
+    struct bcm_request req;
+    memset(&req, 0, sizeof(req));
+
+    req.head().opcode = TX_DELETE;
+    req.head().can_id = info[0].As<Napi::Number>().Uint32Value();
+
+    if (info.Length() >= 2 && info[1].ToBoolean().Value())
+      req.head().can_id |= CAN_EFF_FLAG;
+
+    if (info.Length() >= 3 && info[2].ToBoolean().Value())
+      req.head().flags |= CAN_FD_FRAME;
+
+    CHECK_CONDITION(write(m_SocketFd, req.raw, sizeof(struct bcm_msg_head)) == sizeof(struct bcm_msg_head), "Error deleting BCM TX job");
+
+    return info.This();
+  }
+
+  /**
+   * Add listener to receive events of the RX jobs set up with setupRx()
+   * @method addListener
+   * @param event {string} onMessage for frames passing a filter, onTimeout for messages that
+   *                      stopped arriving within their timeout (called with {id, ext})
+   * @param callback {any} JS callback object
+   * @param instance {any} Optional instance pointer to call callback
+   */
+  Napi::Value AddListener(const Napi::CallbackInfo& info)
+  {
+    Napi::Env env = info.Env();
+    CHECK_CONDITION(info.Length() >= 2, "Too few arguments");
+    CHECK_CONDITION(info[0].IsString(), "First argument must be a string");
+    CHECK_CONDITION(info[1].IsFunction(), "Second argument must be a function");
+
+    std::string event = info[0].As<Napi::String>().Utf8Value();
+    ListenerList *list = nullptr;
+
+    if (event == "onMessage")
+      list = &m_OnMessageListeners;
+    else if (event == "onTimeout")
+      list = &m_OnTimeoutListeners;
+
+    CHECK_CONDITION(list, "Event not supported");
+
+    list->Add(info[1].As<Napi::Function>(), info.Length() >= 3 ? info[2] : env.Undefined());
+
+    return info.This();
+  }
+
+  /**
+   * Set up (or replace) a kernel RX job for an identifier. Without mask every frame of the
+   * identifier is passed on (RX_FILTER_ID), with mask only frames whose masked payload or
+   * length differ from the previous one (RX_CHANGED).
+   * @method setupRx
+   * @param id {integer} CAN identifier
+   * @param options {Object} Optional, ext {bool}, fd {bool}, mask {Buffer} payload bits to watch,
+   *                timeout {integer} ms without frame until onTimeout, throttle {integer} minimum
+   *                ms between two reported changes
+   */
+  Napi::Value SetupRx(const Napi::CallbackInfo& info)
+  {
+    CHECK_CONDITION(IsValid(), "Channel closed");
+    CHECK_CONDITION(info.Length() >= 1 && info[0].IsNumber(), "First argument must be a number");
+
+    Napi::Object options = (info.Length() >= 2 && info[1].IsObject()) ? info[1].As<Napi::Object>()
+                                                                       : Napi::Object::New(info.Env());
+    bool fd = options.Get("fd").ToBoolean().Value();
+
+    struct bcm_request req;
+    memset(&req, 0, sizeof(req));
+
+    req.head().opcode = RX_SETUP;
+    req.head().can_id = info[0].As<Napi::Number>().Uint32Value();
+
+    if (options.Get("ext").ToBoolean().Value())
+      req.head().can_id |= CAN_EFF_FLAG;
+
+    if (fd)
+      req.head().flags |= CAN_FD_FRAME;
+
+    Napi::Value mask = options.Get("mask");
+    if (mask.IsBuffer())
+    {
+      Napi::Buffer<uint8_t> buf = mask.As<Napi::Buffer<uint8_t>>();
+      CHECK_CONDITION(buf.ByteLength() <= (fd ? CANFD_MAX_DLEN : CAN_MAX_DLEN), "Mask too long");
+
+      req.head().nframes = 1;
+      req.head().flags  |= RX_CHECK_DLC;
+      req.frame().can_id = req.head().can_id;
+      req.frame().len    = buf.ByteLength();
+      memcpy(req.frame().data, buf.Data(), buf.ByteLength());
+    }
+    else
+    {
+      CHECK_CONDITION(mask.IsUndefined() || mask.IsNull(), "Mask must be a Buffer");
+      req.head().flags |= RX_FILTER_ID;
+    }
+
+    Napi::Value timeout  = options.Get("timeout");
+    Napi::Value throttle = options.Get("throttle");
+
+    if (timeout.IsNumber() || throttle.IsNumber())
+    {
+      req.head().flags |= SETTIMER;
+      req.head().ival1  = MsToTimeval(timeout.IsNumber() ? timeout.As<Napi::Number>().DoubleValue() : 0);
+      req.head().ival2  = MsToTimeval(throttle.IsNumber() ? throttle.As<Napi::Number>().DoubleValue() : 0);
+
+      // Report a message coming back after a timeout even if its content is unchanged
+      if (timeout.IsNumber())
+        req.head().flags |= STARTTIMER | RX_ANNOUNCE_RESUME;
+    }
+
+    CHECK_CONDITION(StartPolling(info), "Error registering socket with event loop");
+
+    size_t len = sizeof(struct bcm_msg_head);
+    if (req.head().nframes)
+      len += fd ? CANFD_MTU : CAN_MTU;
+
+    CHECK_CONDITION(write(m_SocketFd, req.raw, len) == (ssize_t)len, "Error setting up BCM RX job");
+
+    return info.This();
+  }
+
+  /**
+   * Remove an RX job
+   * @method removeRx
+   * @param id {integer} CAN identifier of the job
+   * @param ext {bool} Optional, true for a 29 bit identifier
+   * @param fd {bool} Optional, true if the job was set up for CAN FD frames
+   */
+  Napi::Value RemoveRx(const Napi::CallbackInfo& info)
+  {
+    CHECK_CONDITION(IsValid(), "Channel closed");
+    CHECK_CONDITION(info.Length() >= 1 && info[0].IsNumber(), "First argument must be a number");
+
+    struct bcm_request req;
+    memset(&req, 0, sizeof(req));
+
+    req.head().opcode = RX_DELETE;
+    req.head().can_id = info[0].As<Napi::Number>().Uint32Value();
+
+    if (info.Length() >= 2 && info[1].ToBoolean().Value())
+      req.head().can_id |= CAN_EFF_FLAG;
+
+    if (info.Length() >= 3 && info[2].ToBoolean().Value())
+      req.head().flags |= CAN_FD_FRAME;
+
+    CHECK_CONDITION(write(m_SocketFd, req.raw, sizeof(struct bcm_msg_head)) == sizeof(struct bcm_msg_head), "Error deleting BCM RX job");
+
+    return info.This();
+  }
+
+  /**
+   * Close the channel, the kernel removes all jobs of this channel
+   * @method close
+   */
+  Napi::Value Close(const Napi::CallbackInfo& info)
+  {
+    if (m_Polling)
+    {
+      uv_poll_stop(&m_Poll);
+      uv_close((uv_handle_t *)&m_Poll, NULL);
+      m_Polling = false;
+
+      napi_async_destroy(m_napi_env, m_async_ctx);
+      m_async_ctx = nullptr;
+
+      Unref();
+    }
+
+    if (m_SocketFd >= 0)
+    {
+      close(m_SocketFd);
+      m_SocketFd = -1;
+    }
+
+    return info.This();
+  }
+
+  /**
+   * Watch the socket for kernel notifications on the event loop, once the first RX job exists.
+   * The channel is kept alive until close().
+   */
+  bool StartPolling(const Napi::CallbackInfo& info)
+  {
+    if (m_Polling)
+      return true;
+
+    Napi::Env env = info.Env();
+    uv_loop_t* loop;
+    napi_get_uv_event_loop(env, &loop);
+
+    if (uv_poll_init(loop, &m_Poll, m_SocketFd) != 0)
+      return false;
+
+    m_Poll.data = this;
+    uv_poll_start(&m_Poll, UV_READABLE, poll_cb);
+
+    napi_value resource_name;
+    napi_create_string_utf8(env, "socketcan:BcmChannel", NAPI_AUTO_LENGTH, &resource_name);
+    napi_async_init(env, (napi_value)info.This(), resource_name, &m_async_ctx);
+
+    m_napi_env = env;
+    m_Polling = true;
+    Ref();
+
+    return true;
+  }
+
+  static void poll_cb(uv_poll_t* handle, int status, int events)
+  {
+    assert(handle && handle->data);
+    reinterpret_cast<BcmChannel*>(handle->data)->poll_ready(status);
+  }
+
+  /**
+   * Read the pending kernel notifications and hand them to the listeners. Level triggered, a
+   * burst beyond the per round limit is continued on the next loop iteration.
+   */
+  void poll_ready(int status)
+  {
+    if (status < 0)
+      return;
+
+    Napi::Env env(m_napi_env);
+    Napi::HandleScope scope(env);
+
+    for (int n = 0; n < 64 && m_Polling; n++)
+    {
+      struct bcm_request req;
+
+      ssize_t nbytes = recv(m_SocketFd, req.raw, sizeof(req.raw), MSG_DONTWAIT);
+      if (nbytes < (ssize_t)sizeof(struct bcm_msg_head))
+        break;
+
+      const struct bcm_msg_head &head = req.head();
+      const struct canfd_frame &frame = req.frame();
+
+      Napi::Object obj = Napi::Object::New(env);
+
+      bool isEff = head.can_id & CAN_EFF_FLAG;
+
+      obj.Set("id", Napi::Number::New(env, head.can_id & (isEff ? CAN_EFF_MASK : CAN_SFF_MASK)));
+
+      if (isEff)
+        obj.Set("ext", Napi::Boolean::New(env, isEff));
+
+      if (head.opcode == RX_TIMEOUT)
+      {
+        if (!m_OnTimeoutListeners.Call(env, m_async_ctx, obj))
+          break;
+        continue;
+      }
+
+      if (head.opcode != RX_CHANGED || head.nframes < 1 ||
+          nbytes < (ssize_t)(sizeof(struct bcm_msg_head) + CAN_MTU))
+        continue;
+
+      if (frame.can_id & CAN_RTR_FLAG)
+        obj.Set("rtr", Napi::Boolean::New(env, true));
+
+      if (head.flags & CAN_FD_FRAME)
+        obj.Set("fd", Napi::Boolean::New(env, true));
+
+      obj.Set("data", Napi::Buffer<char>::Copy(env, (char *)frame.data, frame.len & 0x7f));
+
+      if (!m_OnMessageListeners.Call(env, m_async_ctx, obj))
+        break;
+    }
+  }
+
+  /**
+   * Fill the frame of req (and the CAN_FD_FRAME flag) from a message object
+   */
+  static bool FrameFromObject(Napi::Object obj, struct bcm_request *req)
+  {
+    Napi::Value id   = obj.Get("id");
+    Napi::Value data = obj.Get("data");
+
+    if (!id.IsNumber() || !data.IsBuffer())
+      return false;
+
+    bool fd = obj.Get("fd").ToBoolean().Value();
+    Napi::Buffer<uint8_t> buf = data.As<Napi::Buffer<uint8_t>>();
+
+    if (buf.ByteLength() > (fd ? CANFD_MAX_DLEN : CAN_MAX_DLEN))
+      return false;
+
+    struct canfd_frame &frame = req->frame();
+
+    frame.can_id = id.As<Napi::Number>().Uint32Value();
+
+    if (obj.Get("ext").ToBoolean().Value())
+      frame.can_id |= CAN_EFF_FLAG;
+
+    if (fd)
+    {
+      if (obj.Get("fd_brs").ToBoolean().Value())
+        frame.flags |= CANFD_BRS;
+    }
+    else if (obj.Get("rtr").ToBoolean().Value())
+    {
+      frame.can_id |= CAN_RTR_FLAG;
+    }
+
+    memcpy(frame.data, buf.Data(), buf.ByteLength());
+    frame.len = fd ? CanFdLen(buf.ByteLength()) : buf.ByteLength();
+
+    req->head().can_id  = frame.can_id & (CAN_EFF_FLAG | CAN_EFF_MASK);
+    req->head().nframes = 1;
+
+    if (fd)
+      req->head().flags |= CAN_FD_FRAME;
+
+    return true;
+  }
+
+  static struct bcm_timeval MsToTimeval(double ms)
+  {
+    struct bcm_timeval tv;
+    long long us = (long long)(ms * 1000.0);
+
+    tv.tv_sec  = us / 1000000;
+    tv.tv_usec = us % 1000000;
+    return tv;
+  }
+
+  // Classic frames are transferred as struct can_frame, which is a prefix of canfd_frame
+  bool Write(struct bcm_request *req)
+  {
+    size_t len = sizeof(struct bcm_msg_head) + ((req->head().flags & CAN_FD_FRAME) ? CANFD_MTU : CAN_MTU);
+    return write(m_SocketFd, req->raw, len) == (ssize_t)len;
+  }
+
+  bool IsValid() { return m_SocketFd >= 0; }
+
+  int m_SocketFd;
+
+  ListenerList m_OnMessageListeners;
+  ListenerList m_OnTimeoutListeners;
+
+  // Notifications of RX jobs are received on the event loop thread
+  uv_poll_t m_Poll;
+  bool      m_Polling;
+
+  napi_env           m_napi_env;
+  napi_async_context m_async_ctx;
+};
+
+//-----------------------------------------------------------------------------------------
+/**
+ * Kinds of the events ThreadedChannel hands from its threads to the event loop
+ */
+enum ChannelEventKind
+{
+  EVENT_RECEIVED,   // data holds a received payload
+  EVENT_SENT,       // payload seq was sent, err is 0 or the errno of the transfer
+  EVENT_ERROR,      // receive error err
+};
+
+/**
+ * Base of the channels (IsoTpChannel, J1939Channel) whose socket transfers whole payloads in
+ * blocking calls. A receive thread and a send thread of T (RxLoop(), TxLoop()) move events of
+ * type Event (kind, seq, err and data plus what T needs) to the event loop, which hands them to
+ * the onMessage and onError listeners and the callbacks of send(). Active until close().
+ */
+template <typename T, typename Event>
+class ThreadedChannel : public Napi::ObjectWrap<T>
+{
+public:
+  ThreadedChannel(const Napi::CallbackInfo& info, const char *protocol)
+    : Napi::ObjectWrap<T>(info), m_SocketFd(-1), m_StopFd(-1), m_Async(nullptr), m_Threads(0),
+      m_Stopping(false), m_Protocol(protocol), m_TxSeq(0), m_napi_env(nullptr), m_async_ctx(nullptr)
+  {
+    pthread_mutex_init(&m_Mutex, NULL);
+    pthread_cond_init(&m_TxCond, NULL);
+  }
+
+  ~ThreadedChannel()
+  {
+    Shutdown();
+
+    pthread_cond_destroy(&m_TxCond);
+    pthread_mutex_destroy(&m_Mutex);
+  }
+
+protected:
+  /**
+   * Add listener to receive events
+   * @method addListener
+   * @param event {string} onMessage for received payloads, onError for receive errors
+   * @param callback {any} JS callback object
+   * @param instance {any} Optional instance pointer to call callback
+   */
+  Napi::Value AddListener(const Napi::CallbackInfo& info)
+  {
+    Napi::Env env = info.Env();
+    CHECK_CONDITION(info.Length() >= 2, "Too few arguments");
+    CHECK_CONDITION(info[0].IsString(), "First argument must be a string");
+    CHECK_CONDITION(info[1].IsFunction(), "Second argument must be a function");
+
+    std::string event = info[0].As<Napi::String>().Utf8Value();
+    ListenerList *list = nullptr;
+
+    if (event == "onMessage")
+      list = &m_OnMessageListeners;
+    else if (event == "onError")
+      list = &m_OnErrorListeners;
+
+    CHECK_CONDITION(list, "Event not supported");
+
+    list->Add(info[1].As<Napi::Function>(), info.Length() >= 3 ? info[2] : env.Undefined());
+
+    return info.This();
+  }
+
+  /**
+   * Close the channel, returns without waiting for a transfer in progress; that one is still
+   * finished by the kernel, payloads still queued are dropped without callback.
+   * @method close
+   */
+  Napi::Value Close(const Napi::CallbackInfo& info)
+  {
+    if (IsValid())
+    {
+      Stop();
+
+      napi_async_destroy(m_napi_env, m_async_ctx);
+      m_async_ctx = nullptr;
+
+      m_TxCallbacks.clear();
+
+      // The kernel can't abort a transfer in progress, so the threads are joined on the
+      // thread pool; the channel stays referenced until they are gone
+      uv_loop_t* loop;
+      napi_get_uv_event_loop(m_napi_env, &loop);
+
+      m_CloseReq.data = this;
+      uv_queue_work(loop, &m_CloseReq, c_join_threads, c_threads_joined);
+    }
+
+    return info.This();
+  }
+
+  // Started and not closed
+  bool IsValid() const { return m_async_ctx != nullptr; }
+
+  /**
+   * Queue ev for the send thread, callback (if a function) is called once it was sent
+   */
+  void QueueTx(Event &&ev, Napi::Value callback)
+  {
+    ev.kind = EVENT_SENT;
+    ev.seq  = ++m_TxSeq;
+    ev.err  = 0;
+
+    if (callback.IsFunction())
+      m_TxCallbacks.push_back(std::make_pair(ev.seq, Napi::Persistent(callback.As<Napi::Function>())));
+
+    pthread_mutex_lock(&m_Mutex);
+    m_TxQueue.push_back(std::move(ev));
+    pthread_cond_signal(&m_TxCond);
+    pthread_mutex_unlock(&m_Mutex);
+  }
+
+  /**
+   * Start the receive and send threads, the channel is kept alive until close()
+   */
+  bool Start(const Napi::CallbackInfo& info, const char *resource)
+  {
+    Napi::Env env = info.Env();
+
+    m_StopFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (m_StopFd < 0)
+      return false;
+
+    uv_loop_t* loop;
+    napi_get_uv_event_loop(env, &loop);
+
+    m_Async = new uv_async_t;
+    uv_async_init(loop, m_Async, async_events_cb);
+    m_Async->data = this;
+
+    if (pthread_create(&m_RxThread, NULL, c_rx_entry, this) == 0)
+    {
+      m_Threads++;
+
+      if (pthread_create(&m_TxThread, NULL, c_tx_entry, this) == 0)
+      {
+        m_Threads++;
+
+        napi_value resource_name;
+        napi_create_string_utf8(env, resource, NAPI_AUTO_LENGTH, &resource_name);
+        napi_async_init(env, (napi_value)info.This(), resource_name, &m_async_ctx);
+
+        m_napi_env = env;
+        this->Ref();
+        return true;
+      }
+    }
+
+    int err = errno;
+    Shutdown();
+    errno = err;
+    return false;
+  }
+
+  /**
+   * Stop and join the threads and release the socket, no events are delivered afterwards
+   */
+  void Shutdown()
+  {
+    Stop();
+    Join();
+
+    if (m_Async)
+    {
+      uv_close((uv_handle_t *)m_Async, [](uv_handle_t *handle) { delete (uv_async_t *)handle; });
+      m_Async = nullptr;
+    }
+
+    if (m_StopFd >= 0)
+    {
+      close(m_StopFd);
+      m_StopFd = -1;
+    }
+
+    if (m_SocketFd >= 0)
+    {
+      close(m_SocketFd);
+      m_SocketFd = -1;
+    }
+  }
+
+  // Ask both threads to return
+  void Stop()
+  {
+    pthread_mutex_lock(&m_Mutex);
+    m_Stopping = true;
+    pthread_cond_signal(&m_TxCond);
+    pthread_mutex_unlock(&m_Mutex);
+
+    if (m_StopFd >= 0)
+    {
+      uint64_t one = 1;
+      if (write(m_StopFd, &one, sizeof(one)) < 0) {}
+    }
+  }
+
+  // Wait for the threads asked to return by Stop()
+  void Join()
+  {
+    if (m_Threads > 0)
+      pthread_join(m_RxThread, NULL);
+    if (m_Threads > 1)
+      pthread_join(m_TxThread, NULL);
+    m_Threads = 0;
+  }
+
+  /**
+   * Receive thread: wait until the socket is readable
+   * @return false once the channel is shut down
+   */
+  bool WaitReadable()
+  {
+    struct pollfd fds[2];
+    fds[0].fd     = m_SocketFd;
+    fds[0].events = POLLIN;
+    fds[1].fd     = m_StopFd;
+    fds[1].events = POLLIN;
+
+    for (;;)
+    {
+      if (poll(fds, 2, -1) < 0)
+      {
+        if (errno == EINTR)
+          continue;
+        return false;
+      }
+
+      if (fds[1].revents)
+        return false;
+
+      if (fds[0].revents & (POLLIN | POLLERR))
+        return true;
+    }
+  }
+
+  /**
+   * Send thread: hold off for ms milliseconds
+   * @return false if the channel was shut down meanwhile
+   */
+  bool Pause(int ms)
+  {
+    struct pollfd fd;
+    fd.fd     = m_StopFd;
+    fd.events = POLLIN;
+
+    int ret;
+    do {
+      ret = poll(&fd, 1, ms);
+    } while (ret < 0 && errno == EINTR);
+
+    return ret == 0;
+  }
+
+  /**
+   * Send thread: wait for the next payload queued by send()
+   * @return false once the channel is shut down
+   */
+  bool NextTx(Event *ev)
+  {
+    pthread_mutex_lock(&m_Mutex);
+
+    while (m_TxQueue.empty() && !m_Stopping)
+      pthread_cond_wait(&m_TxCond, &m_Mutex);
+
+    bool ok = !m_Stopping;
+
+    if (ok)
+    {
+      *ev = std::move(m_TxQueue.front());
+      m_TxQueue.pop_front();
+    }
+
+    pthread_mutex_unlock(&m_Mutex);
+    return ok;
+  }
+
+  // Hand an event to the event loop, called by both threads
+  void Post(Event &&ev)
+  {
+    pthread_mutex_lock(&m_Mutex);
+    m_Events.push_back(std::move(ev));
+    pthread_mutex_unlock(&m_Mutex);
+
+    uv_async_send(m_Async);
+  }
+
+  int m_SocketFd;
+
+private:
+  static void *c_rx_entry(void *_this) { static_cast<T *>(static_cast<ThreadedChannel *>(_this))->RxLoop(); return NULL; }
+
+  static void c_join_threads(uv_work_t *req) { reinterpret_cast<ThreadedChannel *>(req->data)->Join(); }
+
+  static void c_threads_joined(uv_work_t *req, int status)
+  {
+    ThreadedChannel *channel = reinterpret_cast<ThreadedChannel *>(req->data);
+
+    channel->Shutdown();
+    channel->Unref();
+  }
+  static void *c_tx_entry(void *_this) { static_cast<T *>(static_cast<ThreadedChannel *>(_this))->TxLoop(); return NULL; }
+
+  static void async_events_cb(uv_async_t* handle)
+  {
+    assert(handle && handle->data);
+    reinterpret_cast<ThreadedChannel*>(handle->data)->async_events();
+  }
+
+  void async_events()
+  {
+    Napi::Env env(m_napi_env);
+    Napi::HandleScope scope(env);
+
+    std::vector<Event> events;
+
+    pthread_mutex_lock(&m_Mutex);
+    events.swap(m_Events);
+    pthread_mutex_unlock(&m_Mutex);
+
+    for (size_t i = 0; i < events.size() && m_async_ctx; i++)
+    {
+      if (DeliverEvent(env, events[i]))
+        continue;
+
+      // A callback threw: the rest goes out in the next round, ahead of what was posted since
+      if (m_async_ctx && i + 1 < events.size())
+      {
+        pthread_mutex_lock(&m_Mutex);
+        m_Events.insert(m_Events.begin(), std::make_move_iterator(events.begin() + i + 1),
+                        std::make_move_iterator(events.end()));
+        pthread_mutex_unlock(&m_Mutex);
+
+        uv_async_send(m_Async);
+      }
+      break;
+    }
+  }
+
+  // Hand ev to its listeners or send() callback, false if the callback threw
+  bool DeliverEvent(Napi::Env env, Event &ev)
+  {
+    if (ev.kind == EVENT_RECEIVED)
+      return m_OnMessageListeners.Call(env, m_async_ctx, static_cast<T *>(this)->MessageOf(env, ev));
+
+    if (ev.kind == EVENT_ERROR)
+    {
+      napi_value arg = Napi::Error::New(env, std::string(m_Protocol) + " receive error: " + strerror(ev.err)).Value();
+      return m_OnErrorListeners.Call(env, m_async_ctx, arg);
+    }
+
+    // Completions arrive in send() order, older entries have no completion coming
+    while (!m_TxCallbacks.empty() && m_TxCallbacks.front().first < ev.seq)
+      m_TxCallbacks.pop_front();
+
+    if (m_TxCallbacks.empty() || m_TxCallbacks.front().first != ev.seq)
+      return true;
+
+    Napi::FunctionReference callback = std::move(m_TxCallbacks.front().second);
+    m_TxCallbacks.pop_front();
+
+    napi_value arg = ev.err ? (napi_value)Napi::Error::New(env, std::string(m_Protocol) + " send error: " + strerror(ev.err)).Value()
+                            : (napi_value)env.Null();
+    napi_value result;
+    napi_make_callback(env, m_async_ctx, (napi_value)env.Global(), (napi_value)callback.Value(), 1, &arg, &result);
+
+    return ListenerList::ForwardException(env);
+  }
+
+  int m_StopFd;
+
+  uv_async_t *m_Async;
+  uv_work_t   m_CloseReq;   // joins the threads after close()
+  pthread_t   m_RxThread;
+  pthread_t   m_TxThread;
+  int         m_Threads;
+
+  pthread_mutex_t    m_Mutex;
+  pthread_cond_t     m_TxCond;
+  bool               m_Stopping;
+  std::deque<Event>  m_TxQueue;
+  std::vector<Event> m_Events;
+
+  const char *m_Protocol;   // prefix of error messages
+
+  // Callbacks of send(), main thread only
+  uint64_t m_TxSeq;
+  std::deque<std::pair<uint64_t, Napi::FunctionReference>> m_TxCallbacks;
+
+  ListenerList m_OnMessageListeners;
+  ListenerList m_OnErrorListeners;
+
+  napi_env           m_napi_env;
+  napi_async_context m_async_ctx;
+};
+
+//-----------------------------------------------------------------------------------------
+#define ISOTP_MAX_PDU (64 * 1024) // receive buffer, larger PDUs are reported as truncated
+
+/**
+ * Work handed between the threads of an IsoTpChannel and the event loop
+ */
+struct isotp_event
+{
+  ChannelEventKind     kind;
+  uint64_t             seq;
+  int                  err;
+  std::vector<uint8_t> data;
+};
+
+/**
+ * ISO 15765-2 transport channel on a CAN_ISOTP socket. Segmentation, flow control and
+ * timing are done by the kernel; a receive thread and a send thread move whole PDUs so the
+ * event loop only sees complete messages and completions.
+ * @class IsoTpChannel
+ */
+class IsoTpChannel : public ThreadedChannel<IsoTpChannel, struct isotp_event>
+{
+  friend class ThreadedChannel<IsoTpChannel, struct isotp_event>;
+
+public:
+  static Napi::Object Init(Napi::Env env, Napi::Object exports)
+  {
+    Napi::Function func = DefineClass(env, "IsoTpChannel", {
+      InstanceMethod("send",        &IsoTpChannel::Send),
+      InstanceMethod("addListener", &IsoTpChannel::AddListener),
+      InstanceMethod("close",       &IsoTpChannel::Close),
+    });
+
+    exports.Set("IsoTpChannel", func);
+    return exports;
+  }
+
+  /**
+   * Create a new ISO-TP channel, it is active until close()
+   * @constructor IsoTpChannel
+   * @param interface {string} interface name to create channel on (e.g. can0)
+   * @param options {Object} txId {integer}, rxId {integer}, ext {bool} 29 bit identifiers,
+   *                blockSize {integer} and stMin {integer} (us) sent in flow control frames,
+   *                padding {integer|bool} pad frames with this byte (true: 0xCC),
+   *                extAddress {integer} / rxExtAddress {integer} extended addressing,
+   *                listenOnly {bool}, wftMax {integer}, fd {bool} CAN FD with txDataLength {integer}
+   *                (default 64) and fd_brs {bool}
+   * @return new IsoTpChannel object
+   */
+  explicit IsoTpChannel(const Napi::CallbackInfo& info)
+    : ThreadedChannel(info, "ISO-TP")
+  {
+    Napi::Env env = info.Env();
+
+    if (!info.IsConstructCall()) {
+      Napi::Error::New(env, "Must be called with new").ThrowAsJavaScriptException();
+      return;
+    }
+    if (info.Length() < 2 || !info[0].IsString() || !info[1].IsObject()) {
+      Napi::Error::New(env, "Expected interface name and options").ThrowAsJavaScriptException();
+      return;
+    }
+
+    std::string name = info[0].As<Napi::String>().Utf8Value();
+    Napi::Object options = info[1].As<Napi::Object>();
+
+    Napi::Value txId = options.Get("txId");
+    Napi::Value rxId = options.Get("rxId");
+
+    if (!txId.IsNumber() || !rxId.IsNumber()) {
+      Napi::Error::New(env, "txId and rxId are required").ThrowAsJavaScriptException();
+      return;
+    }
+
+    bool ext = options.Get("ext").ToBoolean().Value();
+
+    struct sockaddr_can addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.can_family = PF_CAN;
+    addr.can_addr.tp.tx_id = IdKeyOf(txId.As<Napi::Number>().Uint32Value(), ext);
+    addr.can_addr.tp.rx_id = IdKeyOf(rxId.As<Napi::Number>().Uint32Value(), ext);
 
-    return Napi::Number::New(env, i);
+    struct can_isotp_options opts;
+    struct can_isotp_fc_options fc;
+    struct can_isotp_ll_options ll;
+
+    memset(&opts, 0, sizeof(opts));
+    memset(&fc, 0, sizeof(fc));
+    memset(&ll, 0, sizeof(ll));
+
+    // Completion of a send is reported once the last frame left, including flow control errors
+    opts.flags         = CAN_ISOTP_WAIT_TX_DONE;
+    opts.frame_txtime  = CAN_ISOTP_DEFAULT_FRAME_TXTIME;
+    opts.txpad_content = CAN_ISOTP_DEFAULT_PAD_CONTENT;
+    opts.rxpad_content = CAN_ISOTP_DEFAULT_PAD_CONTENT;
+
+    Napi::Value padding = options.Get("padding");
+    if (padding.IsNumber() || (padding.IsBoolean() && padding.As<Napi::Boolean>().Value()))
+    {
+      opts.flags |= CAN_ISOTP_TX_PADDING | CAN_ISOTP_RX_PADDING;
+
+      if (padding.IsNumber())
+        opts.txpad_content = opts.rxpad_content = padding.As<Napi::Number>().Uint32Value() & 0xff;
+    }
+
+    Napi::Value extAddress   = options.Get("extAddress");
+    Napi::Value rxExtAddress = options.Get("rxExtAddress");
+
+    if (extAddress.IsNumber())
+    {
+      opts.flags      |= CAN_ISOTP_EXTEND_ADDR;
+      opts.ext_address = extAddress.As<Napi::Number>().Uint32Value() & 0xff;
+
+      if (rxExtAddress.IsNumber())
+      {
+        opts.flags         |= CAN_ISOTP_RX_EXT_ADDR;
+        opts.rx_ext_address = rxExtAddress.As<Napi::Number>().Uint32Value() & 0xff;
+      }
+    }
+
+    if (options.Get("listenOnly").ToBoolean().Value())
+      opts.flags |= CAN_ISOTP_LISTEN_MODE;
+
+    Napi::Value blockSize = options.Get("blockSize");
+    Napi::Value stMin     = options.Get("stMin");
+    Napi::Value wftMax    = options.Get("wftMax");
+
+    fc.bs     = blockSize.IsNumber() ? blockSize.As<Napi::Number>().Uint32Value() & 0xff : CAN_ISOTP_DEFAULT_RECV_BS;
+    fc.stmin  = stMin.IsNumber() ? StMinOf(stMin.As<Napi::Number>().DoubleValue()) : CAN_ISOTP_DEFAULT_RECV_STMIN;
+    fc.wftmax = wftMax.IsNumber() ? wftMax.As<Napi::Number>().Uint32Value() & 0xff : CAN_ISOTP_DEFAULT_RECV_WFTMAX;
+
+    ll.mtu      = CAN_ISOTP_DEFAULT_LL_MTU;
+    ll.tx_dl    = CAN_ISOTP_DEFAULT_LL_TX_DL;
+    ll.tx_flags = CAN_ISOTP_DEFAULT_LL_TX_FLAGS;
+
+    if (options.Get("fd").ToBoolean().Value())
+    {
+      Napi::Value txDl = options.Get("txDataLength");
+
+      ll.mtu   = CANFD_MTU;
+      ll.tx_dl = txDl.IsNumber() ? txDl.As<Napi::Number>().Uint32Value() : CANFD_MAX_DLEN;
+
+      if (options.Get("fd_brs").ToBoolean().Value())
+        ll.tx_flags |= CANFD_BRS;
+    }
+
+    m_SocketFd = socket(PF_CAN, SOCK_DGRAM | SOCK_CLOEXEC, CAN_ISOTP);
+
+    if (m_SocketFd >= 0)
+    {
+      struct ifreq ifr;
+
+      memset(&ifr, 0, sizeof(ifr));
+      strncpy(ifr.ifr_name, name.c_str(), IFNAMSIZ - 1);
+
+      if (setsockopt(m_SocketFd, SOL_CAN_ISOTP, CAN_ISOTP_OPTS, &opts, sizeof(opts)) == 0 &&
+          setsockopt(m_SocketFd, SOL_CAN_ISOTP, CAN_ISOTP_RECV_FC, &fc, sizeof(fc)) == 0 &&
+          (ll.mtu == CAN_MTU || setsockopt(m_SocketFd, SOL_CAN_ISOTP, CAN_ISOTP_LL_OPTS, &ll, sizeof(ll)) == 0) &&
+          ioctl(m_SocketFd, SIOCGIFINDEX, &ifr) == 0)
+      {
+        addr.can_ifindex = ifr.ifr_ifindex;
+
+        if (bind(m_SocketFd, (struct sockaddr *)&addr, sizeof(addr)) == 0 && Start(info, "socketcan:IsoTpChannel"))
+          return;
+      }
+
+      int err = errno;
+      Shutdown();
+      errno = err;
+    }
+
+    Napi::Error::New(env, std::string("Error while creating ISO-TP channel: ") + strerror(errno)).ThrowAsJavaScriptException();
   }
 
+  // The threads run in this class, join them before it is torn down
+  ~IsoTpChannel() { Shutdown(); }
+
+private:
   /**
-   * Send a CAN FD message immediately.
-   *
-   * PLEASE NOTE: By default, this function may block if the Tx buffer is not available. Please use
-   * createRawChannelWithOptions({non_block_send: false}) to get non-blocking sending activated.
-   *
-   * PLEASE NOTE: Might fail if underlying device doesnt support CAN FD. Structure is not yet validated.
-   *
-   * @method sendFD
-   * @param message {Object} JSON object describing the CAN message, keys are id, length, data {Buffer}, ext
+   * Queue a PDU for transmission
+   * @method send
+   * @param data {Buffer} payload of the PDU
+   * @param callback {Function} Optional, called with null or an Error once the PDU was sent
    */
-  Napi::Value SendFD(const Napi::CallbackInfo& info)
+  Napi::Value Send(const Napi::CallbackInfo& info)
+  {
+    CHECK_CONDITION(IsValid(), "Channel closed");
+    CHECK_CONDITION(info.Length() >= 1 && info[0].IsBuffer(), "First argument must be a Buffer");
+
+    Napi::Buffer<uint8_t> buf = info[0].As<Napi::Buffer<uint8_t>>();
+    CHECK_CONDITION(buf.ByteLength() > 0, "Empty PDU");
+
+    struct isotp_event ev;
+    ev.data.assign(buf.Data(), buf.Data() + buf.ByteLength());
+
+    QueueTx(std::move(ev), info.Length() >= 2 ? info[1] : info.Env().Undefined());
+
+    return info.This();
+  }
+
+  // One recv() returns one complete PDU
+  void RxLoop()
+  {
+    std::vector<uint8_t> buf(ISOTP_MAX_PDU);
+
+    while (WaitReadable())
+    {
+      struct isotp_event ev;
+      ev.kind = EVENT_RECEIVED;
+      ev.seq  = 0;
+      ev.err  = 0;
+
+      ssize_t nbytes = recv(m_SocketFd, buf.data(), buf.size(), MSG_DONTWAIT | MSG_TRUNC);
+
+      if (nbytes < 0)
+      {
+        if (errno == EAGAIN || errno == EINTR)
+          continue;
+
+        ev.kind = EVENT_ERROR;
+        ev.err  = errno;
+      }
+      else if ((size_t)nbytes > buf.size())
+      {
+        ev.kind = EVENT_ERROR;
+        ev.err  = EMSGSIZE;
+      }
+      else
+      {
+        ev.data.assign(buf.data(), buf.data() + nbytes);
+      }
+
+      Post(std::move(ev));
+    }
+  }
+
+  // write() blocks until the PDU was sent (CAN_ISOTP_WAIT_TX_DONE)
+  void TxLoop()
+  {
+    struct isotp_event ev;
+
+    while (NextTx(&ev))
+    {
+      ssize_t nbytes;
+      do {
+        nbytes = write(m_SocketFd, ev.data.data(), ev.data.size());
+      } while (nbytes < 0 && errno == EINTR);
+
+      ev.err = nbytes < 0 ? errno : 0;
+      ev.data.clear();
+
+      Post(std::move(ev));
+    }
+  }
+
+  // A received PDU as passed to onMessage listeners
+  napi_value MessageOf(Napi::Env env, struct isotp_event &ev)
+  {
+    return Napi::Buffer<uint8_t>::Copy(env, ev.data.data(), ev.data.size());
+  }
+
+  // STmin byte of a flow control frame: 0..127 ms, 0xF1..0xF9 for 100..900 us
+  static uint8_t StMinOf(double us)
+  {
+    if (us <= 0)
+      return 0;
+    if (us < 1000)
+      return 0xF0 + std::max(1, (int)(us / 100));
+
+    return (uint8_t)std::min(127.0, us / 1000);
+  }
+};
+
+//-----------------------------------------------------------------------------------------
+#define J1939_MAX_RX_PDU (64 * 1024) // receive buffer, larger (ETP) payloads are reported as truncated
+
+/**
+ * Work handed between the threads of a J1939Channel and the event loop. For sends dest/dest_name
+ * address the receiver and prio is -1 for the channel's default.
+ */
+struct j1939_event
+{
+  ChannelEventKind     kind;
+  uint64_t             seq;
+  int                  err;
+  uint32_t             pgn;
+  uint64_t             src_name;
+  uint64_t             dest_name;
+  uint8_t              src;
+  uint8_t              dest;
+  int                  prio;
+  bool                 claim;   // the channel's own address claim, queued ahead of any send()
+  std::vector<uint8_t> data;
+};
+
+/**
+ * SAE J1939 channel on a CAN_J1939 socket. The kernel handles the transport protocols
+ * (BAM/CMDT/ETP) and address claim bookkeeping; a receive thread and a send thread move whole
+ * parameter groups so the event loop only sees complete payloads and their addressing.
+ * @class J1939Channel
+ */
+class J1939Channel : public ThreadedChannel<J1939Channel, struct j1939_event>
+{
+  friend class ThreadedChannel<J1939Channel, struct j1939_event>;
+
+public:
+  static Napi::Object Init(Napi::Env env, Napi::Object exports)
+  {
+    Napi::Function func = DefineClass(env, "J1939Channel", {
+      InstanceMethod("send",        &J1939Channel::Send),
+      InstanceMethod("addListener", &J1939Channel::AddListener),
+      InstanceMethod("close",       &J1939Channel::Close),
+    });
+
+    exports.Set("J1939Channel", func);
+    return exports;
+  }
+
+  /**
+   * Create a new J1939 channel, it is active until close()
+   * @constructor J1939Channel
+   * @param interface {string} interface name to create channel on (e.g. can0)
+   * @param options {Object} Optional, name {BigInt|Buffer} own NAME (Buffer: 8 bytes little endian),
+   *                addr {integer} own source address, pgn {integer} only receive this PGN,
+   *                promisc {bool} receive all traffic, broadcast {bool} allow sending to the
+   *                global address, priority {integer} default priority 0..7. With both name and
+   *                addr the address is claimed (PGN 0xEE00) before the first send; per J1939-81
+   *                sends from addresses 128..247 follow 250 ms after the claim.
+   * @return new J1939Channel object
+   */
+  explicit J1939Channel(const Napi::CallbackInfo& info)
+    : ThreadedChannel(info, "J1939"), m_Priority(-1), m_Broadcast(false)
   {
     Napi::Env env = info.Env();
-    CHECK_CONDITION(info.Length() >= 1, "Invalid arguments");
-    CHECK_CONDITION(info[0].IsObject(), "First argument must be an Object");
-    CHECK_CONDITION(IsValid(), "Invalid channel!");
 
-    struct canfd_frame frameFD;
-    frameFD.flags = 0;
+    if (!info.IsConstructCall()) {
+      Napi::Error::New(env, "Must be called with new").ThrowAsJavaScriptException();
+      return;
+    }
+    if (info.Length() < 1 || !info[0].IsString()) {
+      Napi::Error::New(env, "First argument must be a string").ThrowAsJavaScriptException();
+      return;
+    }
 
-    Napi::Object obj = info[0].As<Napi::Object>();
+    std::string name = info[0].As<Napi::String>().Utf8Value();
+    Napi::Object options = (info.Length() >= 2 && info[1].IsObject()) ? info[1].As<Napi::Object>()
+                                                                       : Napi::Object::New(env);
 
-    frameFD.can_id = obj.Get("id").As<Napi::Number>().Uint32Value();
+    struct sockaddr_can addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.can_family          = PF_CAN;
+    addr.can_addr.j1939.pgn  = J1939_NO_PGN;
+    addr.can_addr.j1939.addr = J1939_NO_ADDR;
 
-    if (obj.Get("ext").ToBoolean().Value())
-      frameFD.can_id |= CAN_EFF_FLAG;
+    uint64_t own_name = J1939_NO_NAME;
 
-    if (obj.Get("fd_brs").ToBoolean().Value())
-      frameFD.flags |= CANFD_BRS;
+    if (!NameOf(options.Get("name"), &own_name)) {
+      Napi::Error::New(env, "name must be a BigInt or an 8 byte Buffer").ThrowAsJavaScriptException();
+      return;
+    }
 
-    Napi::Value dataArg = obj.Get("data");
-    CHECK_CONDITION(dataArg.IsBuffer(), "Data field must be a Buffer");
+    addr.can_addr.j1939.name = own_name;
 
-    Napi::Buffer<uint8_t> dataBuf = dataArg.As<Napi::Buffer<uint8_t>>();
-    CHECK_CONDITION(dataBuf.ByteLength() <= sizeof(frameFD.data), "Data field too long for a CAN FD frame (max 64 bytes)");
-    frameFD.len = dataBuf.ByteLength();
-    memset(frameFD.data, 0, sizeof(frameFD.data));
-    memcpy(frameFD.data, dataBuf.Data(), frameFD.len);
+    Napi::Value sa   = options.Get("addr");
+    Napi::Value pgn  = options.Get("pgn");
+    Napi::Value prio = options.Get("priority");
+
+    if (sa.IsNumber())
+      addr.can_addr.j1939.addr = sa.As<Napi::Number>().Uint32Value() & 0xff;
 
+    if (pgn.IsNumber())
+      addr.can_addr.j1939.pgn = pgn.As<Napi::Number>().Uint32Value() & J1939_PGN_MAX;
+
+    if (prio.IsNumber())
+      m_Priority = prio.As<Napi::Number>().Uint32Value() & 0x7;
+
+    int promisc   = options.Get("promisc").ToBoolean().Value();
+    int broadcast = options.Get("broadcast").ToBoolean().Value();
+
+    m_SocketFd = socket(PF_CAN, SOCK_DGRAM | SOCK_CLOEXEC, CAN_J1939);
+
+    if (m_SocketFd >= 0)
     {
-      struct timeval now;
-      if (gettimeofday(&now, 0) == 0) {
-        obj.Set("ts_sec",  Napi::Number::New(env, (int32_t)now.tv_sec));
-        obj.Set("ts_usec", Napi::Number::New(env, (int32_t)now.tv_usec));
+      struct ifreq ifr;
+
+      memset(&ifr, 0, sizeof(ifr));
+      strncpy(ifr.ifr_name, name.c_str(), IFNAMSIZ - 1);
+
+      if (setsockopt(m_SocketFd, SOL_CAN_J1939, SO_J1939_PROMISC, &promisc, sizeof(promisc)) == 0 &&
+          setsockopt(m_SocketFd, SOL_SOCKET, SO_BROADCAST, &broadcast, sizeof(broadcast)) == 0 &&
+          (m_Priority < 0 || setsockopt(m_SocketFd, SOL_CAN_J1939, SO_J1939_SEND_PRIO, &m_Priority, sizeof(m_Priority)) == 0) &&
+          ioctl(m_SocketFd, SIOCGIFINDEX, &ifr) == 0)
+      {
+        addr.can_ifindex = ifr.ifr_ifindex;
+
+        m_Broadcast = broadcast;
+
+        if (bind(m_SocketFd, (struct sockaddr *)&addr, sizeof(addr)) == 0)
+        {
+          // The kernel refuses sends of a NAME bound socket (EADDRNOTAVAIL) until its address is claimed
+          if (own_name != J1939_NO_NAME && addr.can_addr.j1939.addr != J1939_NO_ADDR)
+            QueueClaim(env, own_name, addr.can_addr.j1939.addr);
+
+          if (Start(info, "socketcan:J1939Channel"))
+            return;
+        }
+      }
+
+      int err = errno;
+      Shutdown();
+      errno = err;
+    }
+
+    Napi::Error::New(env, std::string("Error while creating J1939 channel: ") + strerror(errno)).ThrowAsJavaScriptException();
+  }
+
+  // The threads run in this class, join them before it is torn down
+  ~J1939Channel() { Shutdown(); }
+
+private:
+  /**
+   * Queue a parameter group for transmission, payloads beyond 8 bytes are sent by the
+   * kernel's transport protocol
+   * @method send
+   * @param message {Object} pgn {integer}, data {Buffer}, dest {integer} Optional destination
+   *                address (default global), destName {BigInt|Buffer} Optional destination NAME,
+   *                priority {integer} Optional 0..7
+   * @param callback {Function} Optional, called with null or an Error once the kernel accepted it
+   */
+  Napi::Value Send(const Napi::CallbackInfo& info)
+  {
+    CHECK_CONDITION(IsValid(), "Channel closed");
+    CHECK_CONDITION(info.Length() >= 1 && info[0].IsObject(), "First argument must be an Object");
+
+    Napi::Object obj  = info[0].As<Napi::Object>();
+    Napi::Value pgn   = obj.Get("pgn");
+    Napi::Value data  = obj.Get("data");
+    Napi::Value dest  = obj.Get("dest");
+    Napi::Value prio  = obj.Get("priority");
+
+    CHECK_CONDITION(pgn.IsNumber(), "pgn must be a number");
+    CHECK_CONDITION(data.IsBuffer(), "data must be a Buffer");
+
+    struct j1939_event ev;
+    ev.pgn       = pgn.As<Napi::Number>().Uint32Value() & J1939_PGN_MAX;
+    ev.src_name  = J1939_NO_NAME;
+    ev.dest_name = J1939_NO_NAME;
+    ev.src       = J1939_NO_ADDR;
+    ev.dest      = dest.IsNumber() ? dest.As<Napi::Number>().Uint32Value() & 0xff : J1939_NO_ADDR;
+    ev.prio      = prio.IsNumber() ? (int)(prio.As<Napi::Number>().Uint32Value() & 0x7) : -1;
+    ev.claim     = false;
+
+    CHECK_CONDITION(NameOf(obj.Get("destName"), &ev.dest_name), "destName must be a BigInt or an 8 byte Buffer");
+
+    Napi::Buffer<uint8_t> buf = data.As<Napi::Buffer<uint8_t>>();
+    ev.data.assign(buf.Data(), buf.Data() + buf.ByteLength());
+
+    QueueTx(std::move(ev), info.Length() >= 2 ? info[1] : info.Env().Undefined());
+
+    return info.This();
+  }
+
+  /**
+   * A NAME given as BigInt or as 8 byte little endian Buffer (kcd J1939.getName()),
+   * undefined keeps *out
+   */
+  static bool NameOf(Napi::Value value, uint64_t *out)
+  {
+    if (value.IsUndefined() || value.IsNull())
+      return true;
+
+    if (value.IsBigInt())
+    {
+      bool lossless;
+      *out = value.As<Napi::BigInt>().Uint64Value(&lossless);
+      return lossless;
+    }
+
+    if (value.IsBuffer())
+    {
+      Napi::Buffer<uint8_t> buf = value.As<Napi::Buffer<uint8_t>>();
+      if (buf.ByteLength() != 8)
+        return false;
+
+      *out = 0;
+      for (int i = 7; i >= 0; i--)
+        *out = (*out << 8) | buf.Data()[i];
+      return true;
+    }
+
+    return false;
+  }
+
+  /**
+   * Queue the address claim of name for addr: PGN 0xEE00 to the global address carrying the
+   * NAME (8 bytes little endian). A contending claim is resolved by the kernel, sends then fail.
+   */
+  void QueueClaim(Napi::Env env, uint64_t name, uint8_t addr)
+  {
+    struct j1939_event ev;
+    ev.pgn       = J1939_PGN_ADDRESS_CLAIMED;
+    ev.src_name  = J1939_NO_NAME;
+    ev.dest_name = J1939_NO_NAME;
+    ev.src       = addr;
+    ev.dest      = J1939_NO_ADDR;
+    ev.prio      = -1;
+    ev.claim     = true;
+
+    for (int i = 0; i < 8; i++)
+      ev.data.push_back((uint8_t)(name >> (8 * i)));
+
+    QueueTx(std::move(ev), env.Undefined());
+  }
+
+  // One recvmsg() returns one complete parameter group, the addressing comes with it
+  void RxLoop()
+  {
+    std::vector<uint8_t> buf(J1939_MAX_RX_PDU);
+    char ctrl[CMSG_SPACE(sizeof(uint8_t)) + CMSG_SPACE(sizeof(uint64_t)) + CMSG_SPACE(sizeof(uint8_t))];
+
+    while (WaitReadable())
+    {
+      struct sockaddr_can src;
+      struct iovec iov = { buf.data(), buf.size() };
+      struct msghdr msg;
+
+      memset(&msg, 0, sizeof(msg));
+      msg.msg_name       = &src;
+      msg.msg_namelen    = sizeof(src);
+      msg.msg_iov        = &iov;
+      msg.msg_iovlen     = 1;
+      msg.msg_control    = ctrl;
+      msg.msg_controllen = sizeof(ctrl);
+
+      struct j1939_event ev;
+      ev.kind      = EVENT_RECEIVED;
+      ev.seq       = 0;
+      ev.err       = 0;
+      ev.pgn       = J1939_NO_PGN;
+      ev.src_name  = J1939_NO_NAME;
+      ev.dest_name = J1939_NO_NAME;
+      ev.src       = J1939_NO_ADDR;
+      ev.dest      = J1939_NO_ADDR;
+      ev.prio      = -1;
+      ev.claim     = false;
+
+      ssize_t nbytes = recvmsg(m_SocketFd, &msg, MSG_DONTWAIT | MSG_TRUNC);
+
+      if (nbytes < 0)
+      {
+        if (errno == EAGAIN || errno == EINTR)
+          continue;
+
+        ev.kind = EVENT_ERROR;
+        ev.err  = errno;
+      }
+      else if ((size_t)nbytes > buf.size())
+      {
+        ev.kind = EVENT_ERROR;
+        ev.err  = EMSGSIZE;
+      }
+      else
+      {
+        ev.data.assign(buf.data(), buf.data() + nbytes);
+        ev.pgn      = src.can_addr.j1939.pgn;
+        ev.src_name = src.can_addr.j1939.name;
+        ev.src      = src.can_addr.j1939.addr;
+
+        for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg))
+        {
+          if (cmsg->cmsg_level != SOL_CAN_J1939)
+            continue;
+
+          if (cmsg->cmsg_type == SCM_J1939_DEST_ADDR)
+            ev.dest = *CMSG_DATA(cmsg);
+          else if (cmsg->cmsg_type == SCM_J1939_DEST_NAME)
+            memcpy(&ev.dest_name, CMSG_DATA(cmsg), sizeof(ev.dest_name));
+          else if (cmsg->cmsg_type == SCM_J1939_PRIO)
+            ev.prio = *CMSG_DATA(cmsg);
+        }
+      }
+
+      Post(std::move(ev));
+    }
+  }
+
+  void TxLoop()
+  {
+    struct j1939_event ev;
+
+    while (NextTx(&ev))
+    {
+      struct sockaddr_can dest;
+      memset(&dest, 0, sizeof(dest));
+      dest.can_family          = PF_CAN;
+      dest.can_addr.j1939.name = ev.dest_name;
+      dest.can_addr.j1939.pgn  = ev.pgn;
+      dest.can_addr.j1939.addr = ev.dest;
+
+      ev.err = 0;
+
+      // The priority of a send is a socket option, only touched when it changes
+      if (ev.prio >= 0 && ev.prio != m_Priority)
+      {
+        if (setsockopt(m_SocketFd, SOL_CAN_J1939, SO_J1939_SEND_PRIO, &ev.prio, sizeof(ev.prio)) == 0)
+          m_Priority = ev.prio;
+        else
+          ev.err = errno;
+      }
+
+      // The claim goes to the global address, allowed for it alone unless broadcast is set
+      int on = 1, off = 0;
+      bool claim = ev.claim && !ev.err;
+
+      if (claim && !m_Broadcast && setsockopt(m_SocketFd, SOL_SOCKET, SO_BROADCAST, &on, sizeof(on)) < 0)
+        ev.err = errno;
+
+      if (!ev.err)
+      {
+        ssize_t nbytes;
+        do {
+          nbytes = sendto(m_SocketFd, ev.data.data(), ev.data.size(), 0, (struct sockaddr *)&dest, sizeof(dest));
+        } while (nbytes < 0 && errno == EINTR);
+
+        ev.err = nbytes < 0 ? errno : 0;
       }
+
+      if (claim && !m_Broadcast)
+        setsockopt(m_SocketFd, SOL_SOCKET, SO_BROADCAST, &off, sizeof(off));
+
+      claim = claim && !ev.err;
+      uint8_t src = ev.src;
+
+      ev.data.clear();
+
+      Post(std::move(ev));
+
+      // J1939-81: self-configurable addresses (128..247) wait 250 ms for contending claims
+      if (claim && src >= 128 && src <= 247 && !Pause(250))
+        break;
     }
+  }
+
+  /**
+   * A received parameter group as passed to onMessage listeners: {pgn, data, src, srcName,
+   * dest, destName, priority}
+   */
+  napi_value MessageOf(Napi::Env env, struct j1939_event &ev)
+  {
+    Napi::Object obj = Napi::Object::New(env);
+
+    obj.Set("pgn",  Napi::Number::New(env, ev.pgn));
+    obj.Set("data", Napi::Buffer<uint8_t>::Copy(env, ev.data.data(), ev.data.size()));
+    obj.Set("src",  Napi::Number::New(env, ev.src));
+    obj.Set("dest", Napi::Number::New(env, ev.dest));
+
+    if (ev.src_name != J1939_NO_NAME)
+      obj.Set("srcName", Napi::BigInt::New(env, ev.src_name));
+    if (ev.dest_name != J1939_NO_NAME)
+      obj.Set("destName", Napi::BigInt::New(env, ev.dest_name));
+    if (ev.prio >= 0)
+      obj.Set("priority", Napi::Number::New(env, ev.prio));
+
+    return obj;
+  }
+
+  int m_Priority;   // current SO_J1939_SEND_PRIO, -1 while the kernel default applies; send thread
+  bool m_Broadcast; // SO_BROADCAST was asked for, otherwise only set around the address claim
+};
+
+//-----------------------------------------------------------------------------------------
+/*
+ * Sidecar index ("<capture>.idx") of a binary capture: a log_index_header, the
+ * log_index_block array and per identifier its key followed by a bitmap over the blocks
+ * holding frames of it.
+ */
+#define LOG_INDEX_MAGIC   "NCANIDX"
+#define LOG_INDEX_VERSION 1
+#define LOG_INDEX_SPAN    (1024 * 1024) // bytes of capture per index block
 
-    // Ensure discrete CAN FD length values 0..8, 12, 16, 20, 24, 32, 48, 64 bytes cf ISO11898-1
-    static const unsigned char len2dlc[] = {0, 1, 2, 3, 4, 5, 6, 7, 8,
-        12, 12, 12, 12,
-        16, 16, 16, 16,
-        20, 20, 20, 20,
-        24, 24, 24, 24,
-        32, 32, 32, 32, 32, 32, 32, 32,
-        48, 48, 48, 48, 48, 48, 48, 48, 48, 48, 48, 48, 48, 48, 48, 48,
-        64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64};
+struct log_index_header
+{
+  char     magic[8];    // LOG_INDEX_MAGIC, zero terminated
+  uint32_t version;     // LOG_INDEX_VERSION
+  uint32_t span;        // LOG_INDEX_SPAN the index was built with
+  uint64_t log_size;    // size and modification time of the indexed capture
+  int64_t  log_mtime_ns;
+  uint64_t end;         // offset behind the last complete record
+  uint32_t blocks;
+  uint32_t ids;
+};
 
-    if (frameFD.len > 64)
-      frameFD.len = 64;
+struct log_index_block
+{
+  uint64_t offset;      // first record
+  uint64_t min_ts;
+  uint64_t max_ts;
+  uint32_t count;       // records
+  uint32_t reserved;
+};
 
-    frameFD.len = len2dlc[frameFD.len];
+// Index key of a record, all error frames share one key
+static canid_t LogKeyOf(canid_t can_id)
+{
+  return (can_id & CAN_ERR_FLAG) ? CAN_ERR_FLAG : IdKeyOf(can_id, can_id & CAN_EFF_FLAG);
+}
 
-    int flags = m_NonBlockingSend ? MSG_DONTWAIT : 0;
-    int i = send(m_SocketFd, &frameFD, sizeof(struct canfd_frame), flags);
+/**
+ * Random access to large binary captures. The capture is memory-mapped and a sparse index
+ * of blocks (time range per block, per identifier a bitmap of blocks) limits a query to the
+ * blocks that can contain matching frames.
+ * @class LogReader
+ */
+class LogReader : public Napi::ObjectWrap<LogReader>
+{
+public:
+  static Napi::Object Init(Napi::Env env, Napi::Object exports)
+  {
+    Napi::Function func = DefineClass(env, "LogReader", {
+      InstanceMethod("info",   &LogReader::Info),
+      InstanceMethod("query",  &LogReader::Query),
+      InstanceMethod("buffer", &LogReader::Buffer),
+    });
 
-    return Napi::Number::New(env, i);
+    exports.Set("LogReader", func);
+    return exports;
   }
 
   /**
-   * Set a list of active filters to be applied for incoming messages
-   * @method setRxFilters
-   * @param filters {Object} single filter or array of filter e.g. { id: 0x1ff, mask: 0x1ff, invert: false}
+   * Open a capture written by startRecording() in the binary format
+   * @constructor LogReader
+   * @param path {string} capture file
+   * @param options {Object} Optional, indexFile {bool} load the index from and store it to path.idx (default true)
    */
-  Napi::Value SetRxFilters(const Napi::CallbackInfo& info)
+  explicit LogReader(const Napi::CallbackInfo& info)
+    : Napi::ObjectWrap<LogReader>(info), m_Log(new LogFile()), m_End(0), m_Frames(0), m_IndexLoaded(false)
   {
-    CHECK_CONDITION(info.Length() > 0, "Too few arguments");
-    CHECK_CONDITION(info[0].IsArray() || info[0].IsObject(), "Invalid argument");
-    CHECK_CONDITION(IsValid(), "Channel not ready");
+    Napi::Env env = info.Env();
 
-    struct can_filter *rfilter;
-    int numfilter = 0;
+    if (!info.IsConstructCall()) {
+      Napi::Error::New(env, "Must be called with new").ThrowAsJavaScriptException();
+      return;
+    }
+    if (info.Length() < 1 || !info[0].IsString()) {
+      Napi::Error::New(env, "First argument must be a string").ThrowAsJavaScriptException();
+      return;
+    }
 
-    if (info[0].IsArray())
-    {
-      Napi::Array list = info[0].As<Napi::Array>();
-      rfilter = (struct can_filter *)malloc(sizeof(struct can_filter) * list.Length());
-      CHECK_CONDITION(rfilter, "Couldn't allocate memory for filter list");
+    std::string path = info[0].As<Napi::String>().Utf8Value();
+    bool index_file  = true;
 
-      for (uint32_t idx = 0; idx < list.Length(); idx++)
-      {
-        if (ObjectToFilter(list.Get(idx).As<Napi::Object>(), &rfilter[numfilter]))
-          numfilter++;
-      }
-    }
-    else
+    if (info.Length() >= 2 && info[1].IsObject())
     {
-      rfilter = (struct can_filter *)malloc(sizeof(struct can_filter));
-      CHECK_CONDITION(rfilter, "Couldn't allocate memory for filter list");
+      Napi::Value value = info[1].As<Napi::Object>().Get("indexFile");
+      if (value.IsBoolean())
+        index_file = value.As<Napi::Boolean>().Value();
+    }
 
-      if (ObjectToFilter(info[0].As<Napi::Object>(), &rfilter[numfilter]))
-        numfilter++;
+    int err = m_Log->Open(path);
+    if (err) {
+      Napi::Error::New(env, std::string("Error opening capture: ") + strerror(err)).ThrowAsJavaScriptException();
+      return;
+    }
+    if (m_Log->Format() != RECORD_BINARY) {
+      Napi::Error::New(env, "Only binary captures can be indexed").ThrowAsJavaScriptException();
+      return;
     }
 
-    if (numfilter)
-      setsockopt(m_SocketFd, SOL_CAN_RAW, CAN_RAW_FILTER, rfilter, numfilter * sizeof(struct can_filter));
+    std::string index_path = path + ".idx";
+    struct stat st;
 
-    if (rfilter)
-      free(rfilter);
+    if (stat(path.c_str(), &st) == 0)
+      m_MtimeNs = (int64_t)st.st_mtim.tv_sec * 1000000000LL + st.st_mtim.tv_nsec;
 
-    return info.This();
+    if (index_file && LoadIndex(index_path))
+    {
+      m_IndexLoaded = true;
+      return;
+    }
+
+    BuildIndex();
+
+    if (index_file)
+      SaveIndex(index_path);
   }
 
+private:
+  struct id_blocks
+  {
+    canid_t               key;
+    std::vector<uint64_t> bits;   // bit b set if block b holds frames of key
+  };
+
   /**
-   * Set a list of active filters to be applied for errors
-   * @method setErrorFilters
-   * @param errorMask {Uint32} CAN error mask
+   * Describe the capture
+   * @method info
+   * @return {Object} frames, blocks, ids (distinct identifiers), start and end (BigInt ns) and
+   *                  indexLoaded (true if the index was read from the sidecar file)
    */
-  Napi::Value SetErrorFilters(const Napi::CallbackInfo& info)
+  Napi::Value Info(const Napi::CallbackInfo& info)
   {
-    CHECK_CONDITION(info.Length() > 0, "Too few arguments");
-    CHECK_CONDITION(info[0].IsNumber(), "Invalid argument");
-    CHECK_CONDITION(IsValid(), "Channel not ready");
+    Napi::Env env = info.Env();
+    Napi::Object obj = Napi::Object::New(env);
 
-    can_err_mask_t err_mask = (can_err_mask_t)info[0].As<Napi::Number>().Uint32Value();
-    setsockopt(m_SocketFd, SOL_CAN_RAW, CAN_RAW_ERR_FILTER, &err_mask, sizeof(err_mask));
+    uint64_t start = UINT64_MAX, end = 0;
+    for (size_t b = 0; b < m_Blocks.size(); b++)
+    {
+      start = std::min(start, m_Blocks[b].min_ts);
+      end   = std::max(end, m_Blocks[b].max_ts);
+    }
 
-    return info.This();
+    obj.Set("frames",      Napi::Number::New(env, (double)m_Frames));
+    obj.Set("blocks",      Napi::Number::New(env, (double)m_Blocks.size()));
+    obj.Set("ids",         Napi::Number::New(env, (double)m_Ids.size()));
+    obj.Set("start",       Napi::BigInt::New(env, m_Blocks.empty() ? (uint64_t)0 : start));
+    obj.Set("end",         Napi::BigInt::New(env, end));
+    obj.Set("indexLoaded", Napi::Boolean::New(env, m_IndexLoaded));
+
+    return obj;
   }
 
   /**
-   * Disable loopback of channel. By default it is activated
-   * @method disableLoopback
+   * Collect the frames of a time range and/or of some identifiers. Only index blocks that can
+   * contain matching frames are read.
+   * @method query
+   * @param options {Object} Optional, start and end {BigInt|number} timestamps in ns (inclusive),
+   *                ids {integer[]} identifiers, ext {bool} true if ids are 29 bit identifiers,
+   *                limit {integer} maximum number of frames
+   * @return {Object} frame batch in the onBatch layout plus offsets {Float64Array}, the byte offset of
+   *                  every frame's payload in buffer()
    */
-  Napi::Value DisableLoopback(const Napi::CallbackInfo& info)
+  Napi::Value Query(const Napi::CallbackInfo& info)
   {
-    CHECK_CONDITION(IsValid(), "Channel not ready");
-    const int loopback = 0;
-    setsockopt(m_SocketFd, SOL_CAN_RAW, CAN_RAW_LOOPBACK, &loopback, sizeof(loopback));
-    return info.This();
-  }
+    Napi::Env env = info.Env();
+    Napi::Object options = (info.Length() >= 1 && info[0].IsObject()) ? info[0].As<Napi::Object>()
+                                                                       : Napi::Object::New(env);
 
-  void stopThread()
-  {
-    if (m_Thread)
+    uint64_t start = 0, end = UINT64_MAX;
+    CHECK_CONDITION(TimeOf(options.Get("start"), &start), "Invalid start time");
+    CHECK_CONDITION(TimeOf(options.Get("end"), &end), "Invalid end time");
+
+    size_t limit = SIZE_MAX;
+    Napi::Value value = options.Get("limit");
+    if (value.IsNumber())
+      limit = value.As<Napi::Number>().Int64Value();
+
+    bool ext = options.Get("ext").ToBoolean().Value();
+
+    // Bitmaps of the requested identifiers, an identifier never seen matches no block
+    std::vector<canid_t> keys;
+    std::vector<const id_blocks *> bitmaps;
+    bool by_id = false;
+
+    value = options.Get("ids");
+    if (!value.IsUndefined())
     {
-      pthread_mutex_lock(&m_ReadPendingMtx);
-      m_ReadPending         = false;
-      m_ThreadStopRequested = true;
-      pthread_cond_signal(&m_ReadPendingCond);
-      pthread_mutex_unlock(&m_ReadPendingMtx);
+      CHECK_CONDITION(value.IsArray(), "ids must be an Array");
 
-      pthread_join(m_Thread, NULL);
-      m_Thread = 0;
+      Napi::Array ids = value.As<Napi::Array>();
+      by_id = true;
+
+      for (uint32_t i = 0; i < ids.Length(); i++)
+      {
+        Napi::Value id = ids.Get(i);
+        CHECK_CONDITION(id.IsNumber(), "ids must be numbers");
+
+        canid_t key = IdKeyOf(id.As<Napi::Number>().Uint32Value(), ext);
+        id_blocks *entry = m_IdIndex.Find(key);
+
+        if (entry)
+        {
+          keys.push_back(key);
+          bitmaps.push_back(entry);
+        }
+      }
     }
-  }
 
-  uv_async_t m_AsyncReceiverReady;
-  uv_async_t m_AsyncChannelStopped;
+    std::vector<size_t> offsets;
+    bool fd = false;
 
-  struct listener {
-    Napi::FunctionReference callback;
-    Napi::ObjectReference   handle;
-  };
+    for (size_t b = 0; b < m_Blocks.size() && offsets.size() < limit; b++)
+    {
+      const struct log_index_block &block = m_Blocks[b];
 
-  std::vector<struct listener *> m_OnMessageListeners;
-  std::vector<struct listener *> m_OnChannelStoppedListeners;
+      if (block.max_ts < start || block.min_ts > end)
+        continue;
 
-  pthread_t m_Thread;
-  std::string m_Name;
+      if (by_id && !AnyBlockBit(bitmaps, b))
+        continue;
 
-  pthread_mutex_t m_ReadPendingMtx;
-  pthread_cond_t  m_ReadPendingCond;
-  bool            m_ReadPending;
+      size_t block_end = (b + 1 < m_Blocks.size()) ? m_Blocks[b + 1].offset : m_End;
 
-  int m_SocketFd;
-  struct sockaddr_can m_SocketAddr;
+      for (size_t off = block.offset; off < block_end && offsets.size() < limit;)
+      {
+        const struct log_record *rec = m_Log->RecordAt(off);
+        if (!rec)
+          break;
 
-  bool m_ThreadStopRequested;
-  bool m_TimestampsSupported;
-  bool m_NonBlockingSend;
+        if (rec->ts_ns >= start && rec->ts_ns <= end &&
+            (!by_id || std::find(keys.begin(), keys.end(), LogKeyOf(rec->can_id)) != keys.end()))
+        {
+          offsets.push_back(off);
+          fd |= (rec->flags & LOG_FLAG_FD) != 0;
+        }
 
-  // Stored for use in uv_async callbacks (always invoked on the main thread)
-  napi_env m_napi_env;
-  napi_async_context m_async_ctx;
+        off += LogRecordSize(rec->len);
+      }
+    }
 
-  static void * c_thread_entry(void *_this) { assert(_this); reinterpret_cast<RawChannel *>(_this)->ThreadEntry(); return NULL; }
+    size_t count  = offsets.size();
+    size_t stride = fd ? CANFD_MAX_DLEN : CAN_MAX_DLEN;
 
-  void ThreadEntry()
-  {
-    struct pollfd pfd;
+    struct frame_batch batch;
+    Napi::Object obj = NewFrameBatch(env, count, stride, &batch);
 
-    pfd.fd     = m_SocketFd;
-    pfd.events = POLLIN|POLLHUP|POLLERR;
+    Napi::Float64Array payload = Napi::Float64Array::New(env, count, napi_float64_array);
 
-    while (!m_ThreadStopRequested)
+    for (size_t i = 0; i < count; i++)
     {
-      pfd.revents = 0;
+      const struct log_record *rec = m_Log->RecordAt(offsets[i]);
+      struct canfd_frame frame;
 
-      pthread_mutex_lock(&m_ReadPendingMtx);
+      frame.can_id = rec->can_id;
+      frame.flags  = 0;
+      if (rec->flags & LOG_FLAG_BRS) frame.flags |= CANFD_BRS;
+      if (rec->flags & LOG_FLAG_ESI) frame.flags |= CANFD_ESI;
 
-      while (unlikely(m_ReadPending && !m_ThreadStopRequested))
-        pthread_cond_wait(&m_ReadPendingCond, &m_ReadPendingMtx);
+      uint8_t len = std::min<size_t>(rec->len, stride);
 
-      pthread_mutex_unlock(&m_ReadPendingMtx);
+      batch.ts_ns[i] = rec->ts_ns;
+      batch.ids[i]   = FrameIdOf(frame);
+      batch.flags[i] = FrameFlagsOf(frame, rec->flags & LOG_FLAG_FD);
+      batch.lens[i]  = len;
 
-      if (likely(poll(&pfd, 1, 100) >= 0))
-      {
-        if (likely(pfd.revents & POLLIN))
-        {
-          pthread_mutex_lock(&m_ReadPendingMtx);
-          uv_async_send(&m_AsyncReceiverReady);
-          m_ReadPending = true;
-          pthread_mutex_unlock(&m_ReadPendingMtx);
-        }
+      memcpy(batch.data + i * stride, rec + 1, len);
+      memset(batch.data + i * stride + len, 0, stride - len);
 
-        if (pfd.revents & (POLLHUP|POLLERR))
-        {
-          uv_async_send(&m_AsyncChannelStopped);
-          break;
-        }
-      }
-      else
-      {
-        break;
-      }
+      payload[i] = (double)(offsets[i] + sizeof(struct log_record));
     }
-  }
 
-  bool IsValid() { return m_SocketFd >= 0; }
+    obj.Set("offsets", payload);
 
-  static bool ObjectToFilter(Napi::Object object, struct can_filter *rfilter)
+    return obj;
+  }
+
+  /**
+   * The mapped capture as ArrayBuffer, for zero-copy access to payloads via the offsets
+   * returned by query(). It keeps the mapping alive on its own. The mapping is private, writes
+   * never reach the file but are seen by later queries of this reader.
+   * @method buffer
+   */
+  Napi::Value Buffer(const Napi::CallbackInfo& info)
   {
-    Napi::Value id   = object.Get("id");
-    Napi::Value mask = object.Get("mask");
+    Napi::Env env = info.Env();
 
-    if (!id.IsNumber() || !mask.IsNumber())
-      return false;
+    if (!m_Buffer.IsEmpty())
+      return m_Buffer.Value();
 
-    rfilter->can_id   = id.As<Napi::Number>().Uint32Value();
-    rfilter->can_mask = mask.As<Napi::Number>().Uint32Value();
+    if (!m_Log->Size())
+      return Napi::ArrayBuffer::New(env, 0);
 
-    if (object.Get("invert").ToBoolean().Value())
-      rfilter->can_id |= CAN_INV_FILTER;
+    // Writes through the ArrayBuffer would fault on the read-only mapping
+    int err = m_Log->MakeWritable();
+    CHECK_CONDITION(err == 0, std::string("Error while mapping capture: ") + strerror(err));
 
-    rfilter->can_mask &= ~CAN_ERR_FLAG;
+    std::shared_ptr<LogFile> *owner = new std::shared_ptr<LogFile>(m_Log);
 
-    return true;
+    Napi::ArrayBuffer buffer = Napi::ArrayBuffer::New(env, (void *)m_Log->Data(), m_Log->Size(),
+                                                      ReleaseBuffer, owner);
+
+    // Held strongly, a second external ArrayBuffer over the same memory must not be created
+    m_Buffer.Reset(buffer, 1);
+    return buffer;
   }
 
-  static void async_receiver_ready_cb(uv_async_t* handle)
+  static void ReleaseBuffer(Napi::Env env, void *data, std::shared_ptr<LogFile> *owner)
   {
-    assert(handle && handle->data);
-    reinterpret_cast<RawChannel*>(handle->data)->async_receiver_ready();
+    delete owner;
   }
 
-  static void async_channel_stopped_cb(uv_async_t* handle)
+  // Timestamp argument, BigInt for full precision or number, undefined keeps *out
+  static bool TimeOf(Napi::Value value, uint64_t *out)
   {
-    assert(handle && handle->data);
-    reinterpret_cast<RawChannel*>(handle->data)->async_channel_stopped();
+    if (value.IsUndefined())
+      return true;
+
+    if (value.IsBigInt())
+    {
+      bool lossless;
+      *out = value.As<Napi::BigInt>().Uint64Value(&lossless);
+      return lossless;
+    }
+
+    if (value.IsNumber())
+    {
+      double v = value.As<Napi::Number>().DoubleValue();
+      *out = v <= 0 ? 0 : (uint64_t)v;
+      return true;
+    }
+
+    return false;
   }
 
-  void async_channel_stopped()
+  static bool AnyBlockBit(const std::vector<const id_blocks *> &bitmaps, size_t block)
   {
-    Napi::Env env(m_napi_env);
-    Napi::HandleScope scope(env);
+    for (size_t i = 0; i < bitmaps.size(); i++)
+    {
+      const std::vector<uint64_t> &bits = bitmaps[i]->bits;
+      if (block / 64 < bits.size() && (bits[block / 64] & (1ULL << (block % 64))))
+        return true;
+    }
+
+    return false;
+  }
+
+  id_blocks *IdEntry(canid_t key)
+  {
+    id_blocks *entry = m_IdIndex.Find(key);
 
-    for (size_t i = 0; i < m_OnChannelStoppedListeners.size(); i++)
+    if (!entry)
     {
-      struct listener *l = m_OnChannelStoppedListeners.at(i);
-      Napi::Function fn = l->callback.Value();
+      m_Ids.emplace_back(new id_blocks());
+      entry = m_Ids.back().get();
+      entry->key = key;
+      m_IdIndex.Insert(key, entry);
+    }
 
-      if (l->handle.IsEmpty())
-        fn.Call(env.Global(), {});
-      else
-        fn.Call(l->handle.Value(), {});
+    return entry;
+  }
 
-      if (env.IsExceptionPending()) {
-        napi_value exception;
-        napi_get_and_clear_last_exception(env, &exception);
-        napi_fatal_exception(env, exception);
-        break;
+  // Scan the whole capture once
+  void BuildIndex()
+  {
+    struct log_index_block block = { m_Log->First(), UINT64_MAX, 0, 0, 0 };
+    size_t off = m_Log->First();
+
+    for (const struct log_record *rec; (rec = m_Log->RecordAt(off)); off += LogRecordSize(rec->len))
+    {
+      if (block.count && off - block.offset >= LOG_INDEX_SPAN)
+      {
+        m_Blocks.push_back(block);
+        block = { off, UINT64_MAX, 0, 0, 0 };
       }
+
+      block.min_ts = std::min(block.min_ts, rec->ts_ns);
+      block.max_ts = std::max(block.max_ts, rec->ts_ns);
+      block.count++;
+
+      size_t b = m_Blocks.size();
+      std::vector<uint64_t> &bits = IdEntry(LogKeyOf(rec->can_id))->bits;
+
+      if (bits.size() <= b / 64)
+        bits.resize(b / 64 + 1, 0);
+      bits[b / 64] |= 1ULL << (b % 64);
+
+      m_Frames++;
     }
 
-    if (m_Thread)
+    if (block.count)
+      m_Blocks.push_back(block);
+
+    m_End = off;
+  }
+
+  // Written to a temporary file first so that readers never see a partial index
+  void SaveIndex(const std::string &path)
+  {
+    size_t words = (m_Blocks.size() + 63) / 64;
+
+    struct log_index_header header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, LOG_INDEX_MAGIC, sizeof(LOG_INDEX_MAGIC));
+    header.version      = LOG_INDEX_VERSION;
+    header.span         = LOG_INDEX_SPAN;
+    header.log_size     = m_Log->Size();
+    header.log_mtime_ns = m_MtimeNs;
+    header.end          = m_End;
+    header.blocks       = m_Blocks.size();
+    header.ids          = m_Ids.size();
+
+    std::vector<char> out;
+    Append(&out, &header, sizeof(header));
+    Append(&out, m_Blocks.data(), m_Blocks.size() * sizeof(struct log_index_block));
+
+    for (size_t i = 0; i < m_Ids.size(); i++)
     {
-      stopThread();
-      uv_close((uv_handle_t *)&m_AsyncReceiverReady, NULL);
-      uv_close((uv_handle_t *)&m_AsyncChannelStopped, NULL);
-    }
+      uint32_t key[2] = { m_Ids[i]->key, 0 };
+      m_Ids[i]->bits.resize(words, 0);
 
-    if (m_async_ctx) {
-      napi_async_destroy(m_napi_env, m_async_ctx);
-      m_async_ctx = nullptr;
+      Append(&out, key, sizeof(key));
+      Append(&out, m_Ids[i]->bits.data(), words * sizeof(uint64_t));
     }
 
-    Unref();
+    std::string tmp = path + ".tmp";
+    int fd = open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0)
+      return;
+
+    bool ok = write(fd, out.data(), out.size()) == (ssize_t)out.size();
+    close(fd);
+
+    if (!ok || rename(tmp.c_str(), path.c_str()) != 0)
+      unlink(tmp.c_str());
   }
 
-  void async_receiver_ready()
+  static void Append(std::vector<char> *out, const void *data, size_t len)
   {
-    if (!m_async_ctx) return;
+    out->insert(out->end(), (const char *)data, (const char *)data + len);
+  }
 
-    Napi::Env env(m_napi_env);
-    Napi::HandleScope scope(env);
+  // false if there is no index matching the capture
+  bool LoadIndex(const std::string &path)
+  {
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+      return false;
 
-    struct canfd_frame frame;
-    unsigned int framesProcessed = 0;
+    std::vector<char> in;
+    char chunk[65536];
 
-    while (recv(m_SocketFd, &frame, sizeof(struct canfd_frame), MSG_DONTWAIT) > 0)
-    {
-      Napi::Object obj = Napi::Object::New(env);
+    for (ssize_t n; (n = read(fd, chunk, sizeof(chunk))) > 0;)
+      in.insert(in.end(), chunk, chunk + n);
 
-      canid_t id    = frame.can_id;
-      bool isEff    = frame.can_id & CAN_EFF_FLAG;
-      bool isRtr    = frame.can_id & CAN_RTR_FLAG;
-      bool isErr    = frame.can_id & CAN_ERR_FLAG;
+    close(fd);
 
-      id = isEff ? frame.can_id & CAN_EFF_MASK : frame.can_id & CAN_SFF_MASK;
+    struct log_index_header header;
+    if (in.size() < sizeof(header))
+      return false;
 
-      if (m_TimestampsSupported)
-      {
-        struct timeval tv;
-        if (likely(ioctl(m_SocketFd, SIOCGSTAMP, &tv) >= 0))
-        {
-          obj.Set("ts_sec",  Napi::Number::New(env, (int32_t)tv.tv_sec));
-          obj.Set("ts_usec", Napi::Number::New(env, (int32_t)tv.tv_usec));
-        }
-      }
+    memcpy(&header, in.data(), sizeof(header));
 
-      obj.Set("id", Napi::Number::New(env, id));
+    if (memcmp(header.magic, LOG_INDEX_MAGIC, sizeof(LOG_INDEX_MAGIC)) != 0 ||
+        header.version != LOG_INDEX_VERSION || header.span != LOG_INDEX_SPAN ||
+        header.log_size != m_Log->Size() || header.log_mtime_ns != m_MtimeNs || header.end > m_Log->Size())
+      return false;
 
-      if (isEff) obj.Set("ext", Napi::Boolean::New(env, isEff));
-      if (isRtr) obj.Set("rtr", Napi::Boolean::New(env, isRtr));
-      if (isErr) obj.Set("err", Napi::Boolean::New(env, isErr));
+    size_t words = (header.blocks + 63) / 64;
+    size_t expect = sizeof(header) + (size_t)header.blocks * sizeof(struct log_index_block) +
+                    (size_t)header.ids * (2 * sizeof(uint32_t) + words * sizeof(uint64_t));
 
-      obj.Set("data", Napi::Buffer<char>::Copy(env, (char *)frame.data, frame.len & 0x7f));
+    if (in.size() != expect)
+      return false;
 
-      bool callback_failed = false;
-      for (size_t i = 0; i < m_OnMessageListeners.size(); i++)
-      {
-        struct listener *l = m_OnMessageListeners.at(i);
-
-        // Use napi_make_callback instead of plain fn.Call() so that
-        // Node.js runs a microtask checkpoint and fires async hooks
-        // after each invocation, matching the old NaN behaviour
-        // (Nan::Callback::Call used node::MakeCallback internally).
-        napi_value recv_val = l->handle.IsEmpty()
-            ? (napi_value)env.Global()
-            : (napi_value)l->handle.Value();
-        napi_value fn_val   = (napi_value)l->callback.Value();
-        napi_value arg      = (napi_value)obj;
-        napi_value result;
-        napi_make_callback(env, m_async_ctx, recv_val, fn_val, 1, &arg, &result);
-
-        if (env.IsExceptionPending()) {
-          napi_value exception;
-          napi_get_and_clear_last_exception(env, &exception);
-          napi_fatal_exception(env, exception);
-          callback_failed = true;
-          break;
-        }
-      }
+    const char *p = in.data() + sizeof(header);
 
-      if (callback_failed)
-        break;
+    m_Blocks.resize(header.blocks);
+    memcpy(m_Blocks.data(), p, header.blocks * sizeof(struct log_index_block));
+    p += header.blocks * sizeof(struct log_index_block);
 
-      if (++framesProcessed > MAX_FRAMES_PER_ASYNC_EVENT)
-        break;
+    for (uint32_t i = 0; i < header.ids; i++)
+    {
+      uint32_t key[2];
+      memcpy(key, p, sizeof(key));
+      p += sizeof(key);
+
+      id_blocks *entry = IdEntry(key[0]);
+      entry->bits.resize(words);
+      memcpy(entry->bits.data(), p, words * sizeof(uint64_t));
+      p += words * sizeof(uint64_t);
     }
 
-    pthread_mutex_lock(&m_ReadPendingMtx);
-    m_ReadPending = false;
-    pthread_cond_signal(&m_ReadPendingCond);
-    pthread_mutex_unlock(&m_ReadPendingMtx);
+    for (size_t b = 0; b < m_Blocks.size(); b++)
+      m_Frames += m_Blocks[b].count;
+
+    m_End = header.end;
+    return true;
   }
+
+  // Shared with the ArrayBuffers handed out by buffer()
+  std::shared_ptr<LogFile> m_Log;
+  int64_t                  m_MtimeNs = 0;
+
+  std::vector<struct log_index_block>       m_Blocks;
+  std::vector<std::unique_ptr<id_blocks>>   m_Ids;
+  IdTable<id_blocks>                        m_IdIndex;
+
+  size_t   m_End;      // offset behind the last complete record
+  uint64_t m_Frames;
+  bool     m_IndexLoaded;
+
+  Napi::Reference<Napi::ArrayBuffer> m_Buffer;
 };
 
 //-----------------------------------------------------------------------------------------
+/**
+ * Set the number of worker threads of the receive reactor used by channels with rx_mode "reactor".
+ * Applies to the reactor of the calling environment (main or worker thread) only. Once its
+ * channels receive, workers are only ever added.
+ * @method setReactorWorkers
+ * @param workers {integer} number of threads (default 1)
+ */
+static Napi::Value SetReactorWorkers(const Napi::CallbackInfo& info)
+{
+  CHECK_CONDITION(info.Length() >= 1 && info[0].IsNumber(), "Invalid argument");
+
+  unsigned workers = info[0].As<Napi::Number>().Uint32Value();
+  CHECK_CONDITION(workers >= 1 && workers <= 64, "Worker count must be between 1 and 64");
+
+  // The count belongs to the reactor of this environment, worker threads have their own
+  RxReactor *reactor = RxReactor::Get(info.Env());
+  CHECK_CONDITION(reactor, "Error starting receive reactor");
+  CHECK_CONDITION(reactor->SetWorkers(workers), "Error starting reactor workers");
+
+  return info.Env().Undefined();
+}
 
 static Napi::Object ModuleInit(Napi::Env env, Napi::Object exports)
 {
+  exports.Set("setReactorWorkers", Napi::Function::New(env, SetReactorWorkers));
+  BcmChannel::Init(env, exports);
+  IsoTpChannel::Init(env, exports);
+  J1939Channel::Init(env, exports);
+  LogReader::Init(env, exports);
   return RawChannel::Init(env, exports);
 }
 
@@ -15,12 +15,10 @@
  */
 #include <napi.h>
 
-#include <endian.h>   // le64toh/be64toh/htole64/htobe64 (not pulled in transitively on all arches)
+#include "signals_core.h"
 
-#include <algorithm>
-#include <bit>
-#include <cstdint>
-#include <cstring>
+#include <unordered_map>
+#include <vector>
 
 #define CHECK_CONDITION(expr, str) \
   if (!(expr)) { \
@@ -28,20 +26,6 @@
     return env.Undefined(); \
   }
 
-enum class ENDIANESS
-{
-    MOTOROLA = 0,
-    INTEL
-};
-
-enum class SIGNAL_TYPE
-{
-    UNSIGNED = 0,
-    SIGNED   = 1,
-    FLOAT32  = 2,
-    FLOAT64  = 3
-};
-
 static SIGNAL_TYPE _parse_signal_type(Napi::Env env, const Napi::Value& v)
 {
     if (v.IsBoolean())
@@ -54,57 +38,9 @@ static SIGNAL_TYPE _parse_signal_type(Napi::Env env, const Napi::Value& v)
     return static_cast<SIGNAL_TYPE>(n);
 }
 
-// Returns the fixed IEEE-754 bit width for float signal types; 0 for integer types.
-static uint32_t signal_type_bit_width(SIGNAL_TYPE t)
-{
-    switch (t) {
-        case SIGNAL_TYPE::FLOAT32: return 32;
-        case SIGNAL_TYPE::FLOAT64: return 64;
-        default:                   return 0;
-    }
-}
-
 //-----------------------------------------------------------------------------------------
 // _signals.* methods
 
-[[nodiscard]] static uint64_t _getvalue(const uint8_t* data,
-                                        uint32_t offset,
-                                        uint32_t length,
-                                        ENDIANESS byteOrder)
-{
-    uint64_t d_raw;
-    std::memcpy(&d_raw, data, sizeof(d_raw));
-    uint64_t d = (byteOrder == ENDIANESS::INTEL) ? le64toh(d_raw) : be64toh(d_raw);
-
-    uint64_t m = (length == 64) ? UINT64_MAX : (UINT64_C(1) << length) - 1;
-    size_t shift = (byteOrder == ENDIANESS::INTEL) ? offset : (64 - offset - length);
-
-    uint64_t o = (d >> shift) & m;
-
-#ifdef KAYAK_DATA_CHECK
-    size_t i;
-    int bitNr;
-    uint64_t val = 0;
-    if (byteOrder == ENDIANESS::INTEL) {
-        for (i = 0; i < length; i++) {
-            bitNr = i + offset;
-            val |= ((data[bitNr >> 3] >> (bitNr & 0x07)) & 1) << i;
-        }
-    } else {
-        for (i = 0; i < length; i++) {
-            bitNr = offset + length - i -1;
-            val |= ((data[bitNr >> 3] >> (7-(bitNr & 0x07))) & 1) << i;
-        }
-    }
-
-    if (val != o) {
-        fprintf(stderr, "getvalue: got %lu, expected %lu\n", val, o);
-    }
-#endif
-
-    return o;
-}
-
 // Decode signal according description
 // arg[0] - Data array
 // arg[1] - offset zero indexed
@@ -173,43 +109,6 @@ Napi::Value DecodeSignal(const Napi::CallbackInfo& info)
     return raw_values;
 }
 
-static void _setvalue(uint32_t offset, uint32_t bitLength, ENDIANESS endianess,
-                      uint8_t* data, uint64_t raw_value)
-{
-    uint64_t o_raw;
-    std::memcpy(&o_raw, data, sizeof(o_raw));
-    uint64_t o = (endianess == ENDIANESS::INTEL) ? le64toh(o_raw) : be64toh(o_raw);
-
-    uint64_t m = (bitLength == 64) ? UINT64_MAX : (UINT64_C(1) << bitLength) - 1;
-    size_t shift = (endianess == ENDIANESS::INTEL) ? offset : (64 - offset - bitLength);
-
-    o &= ~(m << shift);
-    o |= (raw_value & m) << shift;
-
-    o = (endianess == ENDIANESS::INTEL) ? htole64(o) : htobe64(o);
-    std::memcpy(data, &o, sizeof(o));
-
-#ifdef KAYAK_DATA_CHECK
-    size_t i;
-    int bitNr;
-    uint64_t val = 0;
-    if (endianess == ENDIANESS::INTEL) {
-        for (i = 0; i < bitLength; i++) {
-            bitNr = i + offset;
-            val |= ((data[bitNr >> 3] >> (bitNr & 0x07)) & 1) << i;
-        }
-    } else {
-        for (i = 0; i < bitLength; i++) {
-            bitNr = offset + bitLength - i -1;
-            val |= ((data[bitNr >> 3] >> (7-(bitNr & 0x07))) & 1) << i;
-        }
-    }
-    if(val != ( raw_value & m)) {
-        fprintf(stderr, "setvalue: got %lu, expected %lu\n", val, raw_value & m);
-    }
-#endif
-}
-
 // Encode signal according description
 // arg[0] - Data array
 // arg[1] - bitOffset
@@ -265,12 +164,561 @@ Napi::Value EncodeSignal(const Napi::CallbackInfo& info)
     return env.Undefined();
 }
 
+//-----------------------------------------------------------------------------------------
+// Compiled message layouts
+
+// Fill sl from a signal description as accepted by MessageLayout
+// ({ bitOffset, bitLength, littleEndian, type, slope, intercept })
+// Returns false (with an exception pending) if the description is invalid.
+static bool _parse_signal_layout(Napi::Env env, const Napi::Value& item, SignalLayout& sl)
+{
+    if (!item.IsObject()) {
+        Napi::TypeError::New(env, "Invalid signal description").ThrowAsJavaScriptException();
+        return false;
+    }
+
+    Napi::Object desc = item.As<Napi::Object>();
+    Napi::Value bitOffset    = desc.Get("bitOffset");
+    Napi::Value bitLength    = desc.Get("bitLength");
+    Napi::Value littleEndian = desc.Get("littleEndian");
+    Napi::Value type         = desc.Get("type");
+    Napi::Value slope        = desc.Get("slope");
+    Napi::Value intercept    = desc.Get("intercept");
+
+    if (!bitOffset.IsNumber() || !bitLength.IsNumber() || !littleEndian.IsBoolean() ||
+        !(type.IsNumber() || type.IsBoolean())) {
+        Napi::TypeError::New(env, "Invalid signal description").ThrowAsJavaScriptException();
+        return false;
+    }
+
+    sl.offset    = bitOffset.As<Napi::Number>().Uint32Value();
+    sl.bitLength = bitLength.As<Napi::Number>().Uint32Value();
+    sl.endianess = littleEndian.As<Napi::Boolean>().Value() ? ENDIANESS::INTEL : ENDIANESS::MOTOROLA;
+    sl.type      = _parse_signal_type(env, type);
+    if (env.IsExceptionPending()) return false;
+    sl.slope     = slope.IsNumber() ? slope.As<Napi::Number>().DoubleValue() : 1.0;
+    sl.intercept = intercept.IsNumber() ? intercept.As<Napi::Number>().DoubleValue() : 0.0;
+    sl.deadbandAbs = 0.0;
+    sl.deadbandRel = 0.0;
+
+    uint32_t width = signal_type_bit_width(sl.type);
+    if (width > 0)
+        sl.bitLength = width;
+
+    return true;
+}
+
+// Decode one signal from every frame of a batch
+// arg[0] - Uint8Array holding count frames, frame i starts at i * stride
+// arg[1] - stride in bytes
+// arg[2] - count of frames
+// arg[3] - offset zero indexed
+// arg[4] - bitLength one indexed
+// arg[5] - endianess (bool: true=Intel/LE, false=Motorola/BE)
+// arg[6] - signal type as for decodeSignal
+// arg[7] - Float64Array receiving count values
+// arg[8] - (optional) slope
+// arg[9] - (optional) intercept
+Napi::Value DecodeSignalColumn(const Napi::CallbackInfo& info)
+{
+    Napi::Env env = info.Env();
+
+    CHECK_CONDITION(info.Length() >= 8, "Too few arguments");
+    CHECK_CONDITION(info[0].IsTypedArray(), "Invalid argument");
+    CHECK_CONDITION(info[1].IsNumber() && info[2].IsNumber(), "Invalid batch size");
+    CHECK_CONDITION(info[3].IsNumber(), "Invalid offset");
+    CHECK_CONDITION(info[4].IsNumber(), "Invalid bit length");
+    CHECK_CONDITION(info[5].IsBoolean(), "Invalid endianess");
+    CHECK_CONDITION(info[6].IsNumber() || info[6].IsBoolean(), "Invalid type");
+    CHECK_CONDITION(info[7].IsTypedArray(), "Invalid values array");
+
+    Napi::Uint8Array   jsData = info[0].As<Napi::Uint8Array>();
+    Napi::Float64Array values = info[7].As<Napi::Float64Array>();
+    uint32_t stride = info[1].As<Napi::Number>().Uint32Value();
+    uint32_t count  = info[2].As<Napi::Number>().Uint32Value();
+
+    SignalLayout sl;
+    sl.offset    = info[3].As<Napi::Number>().Uint32Value();
+    sl.bitLength = info[4].As<Napi::Number>().Uint32Value();
+    sl.endianess = info[5].As<Napi::Boolean>().Value() ? ENDIANESS::INTEL : ENDIANESS::MOTOROLA;
+    sl.type      = _parse_signal_type(env, info[6]);
+    if (env.IsExceptionPending()) return env.Undefined();
+    sl.slope     = (info.Length() > 8 && info[8].IsNumber()) ? info[8].As<Napi::Number>().DoubleValue() : 1.0;
+    sl.intercept = (info.Length() > 9 && info[9].IsNumber()) ? info[9].As<Napi::Number>().DoubleValue() : 0.0;
+
+    uint32_t width = signal_type_bit_width(sl.type);
+    if (width > 0)
+        sl.bitLength = width;
+
+    CHECK_CONDITION(_signal_decodable(sl), "Invalid bit length");
+    CHECK_CONDITION(jsData.TypedArrayType() == napi_uint8_array &&
+                    (uint64_t)stride * count <= jsData.ByteLength(), "Invalid argument");
+    CHECK_CONDITION(values.TypedArrayType() == napi_float64_array &&
+                    values.ElementLength() >= count, "Invalid values array");
+
+    _decode_column(jsData.Data(), stride, count, sl, values.Data());
+
+    return env.Undefined();
+}
+
+// Decode several signals from every frame of a batch, in blocks that stay in the cache
+// arg[0] - Uint8Array holding count frames, frame i starts at i * stride
+// arg[1] - stride in bytes
+// arg[2] - count of frames
+// arg[3] - Array of signal descriptions as for MessageLayout (muxGroup is ignored)
+// arg[4] - Array of Float64Arrays receiving count values each, one per signal
+Napi::Value DecodeSignalColumns(const Napi::CallbackInfo& info)
+{
+    Napi::Env env = info.Env();
+    const size_t block = 1024;
+
+    CHECK_CONDITION(info.Length() >= 5, "Too few arguments");
+    CHECK_CONDITION(info[0].IsTypedArray(), "Invalid argument");
+    CHECK_CONDITION(info[1].IsNumber() && info[2].IsNumber(), "Invalid batch size");
+    CHECK_CONDITION(info[3].IsArray(), "Invalid signal descriptions");
+    CHECK_CONDITION(info[4].IsArray(), "Invalid values arrays");
+
+    Napi::Uint8Array jsData = info[0].As<Napi::Uint8Array>();
+    Napi::Array      descs  = info[3].As<Napi::Array>();
+    Napi::Array      outs   = info[4].As<Napi::Array>();
+    uint32_t stride = info[1].As<Napi::Number>().Uint32Value();
+    uint32_t count  = info[2].As<Napi::Number>().Uint32Value();
+
+    CHECK_CONDITION(jsData.TypedArrayType() == napi_uint8_array &&
+                    (uint64_t)stride * count <= jsData.ByteLength(), "Invalid argument");
+    CHECK_CONDITION(outs.Length() >= descs.Length(), "Invalid values arrays");
+
+    std::vector<SignalLayout> signals(descs.Length());
+    std::vector<double*>      out(descs.Length());
+
+    for (uint32_t s = 0; s < descs.Length(); s++) {
+        if (!_parse_signal_layout(env, descs.Get(s), signals[s]))
+            return env.Undefined();
+
+        CHECK_CONDITION(_signal_decodable(signals[s]), "Invalid bit length");
+
+        Napi::Value v = outs.Get(s);
+        CHECK_CONDITION(v.IsTypedArray(), "Invalid values array");
+
+        Napi::Float64Array values = v.As<Napi::Float64Array>();
+        CHECK_CONDITION(values.TypedArrayType() == napi_float64_array &&
+                        values.ElementLength() >= count, "Invalid values array");
+
+        out[s] = values.Data();
+    }
+
+    const uint8_t* frames = jsData.Data();
+
+    for (size_t first = 0; first < count; first += block) {
+        size_t n = std::min<size_t>(block, count - first);
+
+        for (size_t s = 0; s < signals.size(); s++)
+            _decode_column(frames + first * stride, stride, n, signals[s], out[s] + first);
+    }
+
+    return env.Undefined();
+}
+
+// A message description compiled once from the KCD definition, so that all signals of a
+// received frame can be decoded with a single call.
+class MessageLayout : public Napi::ObjectWrap<MessageLayout>
+{
+public:
+    static void Init(Napi::Env env, Napi::Object exports)
+    {
+        Napi::Function func = DefineClass(env, "MessageLayout", {
+            InstanceMethod("decode", &MessageLayout::Decode),
+            InstanceMethod("decodeColumn", &MessageLayout::DecodeColumn),
+            InstanceMethod("encode", &MessageLayout::Encode),
+            InstanceMethod("setDeadband", &MessageLayout::SetDeadband),
+            InstanceMethod("setShadow", &MessageLayout::SetShadow),
+        });
+
+        exports.Set("MessageLayout", func);
+    }
+
+    // arg[0] - Array of signal descriptions
+    //          { bitOffset, bitLength, littleEndian, type, slope, intercept, muxGroup: number[] }
+    // arg[1] - muxed (bool)
+    // arg[2] - (optional) multiplexor description { offset, length }
+    explicit MessageLayout(const Napi::CallbackInfo& info)
+        : Napi::ObjectWrap<MessageLayout>(info), m_Muxed(false), m_HasMux(false),
+          m_MuxOffset(0), m_MuxLength(0)
+    {
+        Napi::Env env = info.Env();
+
+        if (info.Length() < 2 || !info[0].IsArray() || !info[1].IsBoolean()) {
+            Napi::TypeError::New(env, "Invalid arguments").ThrowAsJavaScriptException();
+            return;
+        }
+
+        m_Muxed = info[1].As<Napi::Boolean>().Value();
+
+        if (info.Length() > 2 && info[2].IsObject()) {
+            Napi::Object mux = info[2].As<Napi::Object>();
+            Napi::Value offset = mux.Get("offset");
+            Napi::Value length = mux.Get("length");
+
+            if (!offset.IsNumber() || !length.IsNumber()) {
+                Napi::TypeError::New(env, "Invalid multiplexor").ThrowAsJavaScriptException();
+                return;
+            }
+
+            m_HasMux    = true;
+            m_MuxOffset = offset.As<Napi::Number>().Uint32Value();
+            m_MuxLength = length.As<Napi::Number>().Uint32Value();
+
+            if (m_MuxLength == 0 || m_MuxLength > 64 || m_MuxOffset + m_MuxLength > 64) {
+                Napi::TypeError::New(env, "Invalid multiplexor").ThrowAsJavaScriptException();
+                return;
+            }
+        }
+
+        Napi::Array list = info[0].As<Napi::Array>();
+
+        for (uint32_t idx = 0; idx < list.Length(); idx++) {
+            Napi::Value item = list.Get(idx);
+
+            SignalLayout sl;
+            if (!_parse_signal_layout(env, item, sl))
+                return;
+
+            uint32_t index = static_cast<uint32_t>(m_Signals.size());
+            m_Signals.push_back(sl);
+            m_Shadow.push_back(std::nan(""));
+
+            // Signals beyond the first 64 bit are kept in the index space but never decoded
+            if (!_signal_decodable(sl))
+                continue;
+
+            m_All.push_back(index);
+
+            Napi::Value muxGroup = item.As<Napi::Object>().Get("muxGroup");
+            if (muxGroup.IsArray()) {
+                Napi::Array group = muxGroup.As<Napi::Array>();
+                for (uint32_t g = 0; g < group.Length(); g++) {
+                    Napi::Value v = group.Get(g);
+                    if (v.IsNumber())
+                        m_MuxTable[v.As<Napi::Number>().Int64Value()].push_back(index);
+                }
+            }
+        }
+    }
+
+private:
+    // Decode all signals of a frame
+    // arg[0] - Data array
+    // arg[1] - Float64Array receiving the scaled value of each signal (index as in the description)
+    // arg[2] - Uint8Array, set to 1 for every signal decoded from this frame, 0 for signals not
+    //          present due to multiplexing
+    // arg[3] - (optional) Uint8Array bitmask, bit i is set if signal i differs from the value it
+    //          had when it last changed by more than its deadband (see setDeadband)
+    // Returns the multiplexor value, -1 if the message is not multiplexed.
+    Napi::Value Decode(const Napi::CallbackInfo& info)
+    {
+        Napi::Env env = info.Env();
+        uint8_t data[64];           // CANFD buffer size (supports CAN FD)
+        uint8_t *changed = nullptr;
+
+        CHECK_CONDITION(info.Length() >= 3, "Too few arguments");
+        CHECK_CONDITION(info[0].IsTypedArray(), "Invalid argument");
+        CHECK_CONDITION(info[1].IsTypedArray(), "Invalid values array");
+        CHECK_CONDITION(info[2].IsTypedArray(), "Invalid active array");
+
+        if (info.Length() > 3 && !info[3].IsUndefined()) {
+            CHECK_CONDITION(info[3].IsTypedArray(), "Invalid changed mask");
+
+            Napi::Uint8Array mask = info[3].As<Napi::Uint8Array>();
+            CHECK_CONDITION(mask.TypedArrayType() == napi_uint8_array &&
+                            mask.ElementLength() >= (m_Signals.size() + 7) / 8, "Invalid changed mask");
+
+            changed = mask.Data();
+            std::memset(changed, 0, (m_Signals.size() + 7) / 8);
+        }
+
+        Napi::Uint8Array    jsData = info[0].As<Napi::Uint8Array>();
+        Napi::Float64Array  values = info[1].As<Napi::Float64Array>();
+        Napi::Uint8Array    active = info[2].As<Napi::Uint8Array>();
+
+        CHECK_CONDITION(jsData.TypedArrayType() == napi_uint8_array, "Invalid argument");
+        CHECK_CONDITION(values.TypedArrayType() == napi_float64_array &&
+                        values.ElementLength() >= m_Signals.size(), "Invalid values array");
+        CHECK_CONDITION(active.TypedArrayType() == napi_uint8_array &&
+                        active.ElementLength() >= m_Signals.size(), "Invalid active array");
+
+        size_t maxBytes = std::min<size_t>(jsData.ByteLength(), sizeof(data));
+
+        std::memset(data, 0, sizeof(data));
+        std::memcpy(data, jsData.Data(), maxBytes);
+
+        int64_t mux = -1;
+        const std::vector<uint32_t> *decode = &m_All;
+
+        if (m_Muxed) {
+            decode = nullptr;
+
+            if (m_HasMux)
+                mux = static_cast<int64_t>(_getvalue(data, m_MuxOffset, m_MuxLength, ENDIANESS::INTEL));
+
+            auto it = m_MuxTable.find(mux);
+            if (it != m_MuxTable.end())
+                decode = &it->second;
+        }
+
+        std::memset(active.Data(), 0, m_Signals.size());
+
+        if (decode) {
+            double  *out  = values.Data();
+            uint8_t *flag = active.Data();
+
+            for (uint32_t index : *decode) {
+                const SignalLayout& sl = m_Signals[index];
+
+                double val = _rawtodouble(_getvalue(data, sl.offset, sl.bitLength, sl.endianess),
+                                          sl.bitLength, sl.type);
+
+                if (sl.slope != 0.0)
+                    val *= sl.slope;
+                if (sl.intercept != 0.0)
+                    val += sl.intercept;
+
+                out[index]  = val;
+                flag[index] = 1;
+
+                if (changed) {
+                    // Written so that NaN always counts as a change, like !== in JS
+                    double last = m_Shadow[index];
+                    double threshold = std::max(sl.deadbandAbs, sl.deadbandRel * std::fabs(last));
+
+                    if (!(std::fabs(val - last) <= threshold)) {
+                        m_Shadow[index] = val;
+                        changed[index >> 3] |= static_cast<uint8_t>(1u << (index & 7));
+                    }
+                }
+            }
+        }
+
+        return Napi::Number::New(env, static_cast<double>(mux));
+    }
+
+    // Decode one signal from every frame of a batch (as returned by LogReader.query() or
+    // delivered to onBatch listeners)
+    // arg[0] - signal index (as in the description)
+    // arg[1] - Uint8Array holding count frames, frame i starts at i * stride
+    // arg[2] - stride in bytes
+    // arg[3] - count of frames
+    // arg[4] - Float64Array receiving count values, NaN where the signal is not present due to
+    //          multiplexing
+    // Returns the number of frames the signal was decoded from.
+    Napi::Value DecodeColumn(const Napi::CallbackInfo& info)
+    {
+        Napi::Env env = info.Env();
+        uint8_t data[64];           // CANFD buffer size (supports CAN FD)
+
+        CHECK_CONDITION(info.Length() >= 5, "Too few arguments");
+        CHECK_CONDITION(info[0].IsNumber(), "Invalid signal index");
+        CHECK_CONDITION(info[1].IsTypedArray(), "Invalid argument");
+        CHECK_CONDITION(info[2].IsNumber() && info[3].IsNumber(), "Invalid batch size");
+        CHECK_CONDITION(info[4].IsTypedArray(), "Invalid values array");
+
+        uint32_t index  = info[0].As<Napi::Number>().Uint32Value();
+        uint32_t stride = info[2].As<Napi::Number>().Uint32Value();
+        uint32_t count  = info[3].As<Napi::Number>().Uint32Value();
+
+        Napi::Uint8Array   jsData = info[1].As<Napi::Uint8Array>();
+        Napi::Float64Array values = info[4].As<Napi::Float64Array>();
+
+        CHECK_CONDITION(index < m_Signals.size(), "Invalid signal index");
+        CHECK_CONDITION(jsData.TypedArrayType() == napi_uint8_array &&
+                        (uint64_t)stride * count <= jsData.ByteLength(), "Invalid argument");
+        CHECK_CONDITION(values.TypedArrayType() == napi_float64_array &&
+                        values.ElementLength() >= count, "Invalid values array");
+
+        const SignalLayout& sl = m_Signals[index];
+        double *out = values.Data();
+
+        // Signals beyond the first 64 bit are never decoded, see the constructor
+        if (std::find(m_All.begin(), m_All.end(), index) == m_All.end()) {
+            std::fill(out, out + count, std::nan(""));
+            return Napi::Number::New(env, 0);
+        }
+
+        if (!m_Muxed) {
+            _decode_column(jsData.Data(), stride, count, sl, out);
+            return Napi::Number::New(env, count);
+        }
+
+        size_t copy = std::min<size_t>(stride, sizeof(data));
+        uint32_t decoded = 0;
+
+        // Membership of the signal in the mux group of the previous frame
+        int64_t lastMux = -2;
+        bool    present = !m_Muxed;
+
+        std::memset(data, 0, sizeof(data));
+
+        for (uint32_t i = 0; i < count; i++) {
+            std::memcpy(data, jsData.Data() + (size_t)i * stride, copy);
+
+            if (m_Muxed) {
+                int64_t mux = m_HasMux ? static_cast<int64_t>(_getvalue(data, m_MuxOffset, m_MuxLength, ENDIANESS::INTEL)) : -1;
+
+                if (mux != lastMux) {
+                    auto it = m_MuxTable.find(mux);
+                    present = it != m_MuxTable.end() &&
+                              std::find(it->second.begin(), it->second.end(), index) != it->second.end();
+                    lastMux = mux;
+                }
+            }
+
+            if (!present) {
+                out[i] = std::nan("");
+                continue;
+            }
+
+            double val = _rawtodouble(_getvalue(data, sl.offset, sl.bitLength, sl.endianess),
+                                      sl.bitLength, sl.type);
+
+            if (sl.slope != 0.0)
+                val *= sl.slope;
+            if (sl.intercept != 0.0)
+                val += sl.intercept;
+
+            out[i] = val;
+            decoded++;
+        }
+
+        return Napi::Number::New(env, decoded);
+    }
+
+    // Encode all signals of a message
+    // arg[0] - Float64Array holding the physical value of each signal (index as in the
+    //          description), NaN for signals without a value
+    // arg[1] - multiplexor value, or -1 to encode every signal without setting the multiplexor
+    // arg[2] - Data array, cleared and then filled with the encoded frame
+    Napi::Value Encode(const Napi::CallbackInfo& info)
+    {
+        Napi::Env env = info.Env();
+        uint8_t data[64];           // CANFD buffer size (supports CAN FD)
+
+        CHECK_CONDITION(info.Length() >= 3, "Too few arguments");
+        CHECK_CONDITION(info[0].IsTypedArray(), "Invalid values array");
+        CHECK_CONDITION(info[1].IsNumber(), "Invalid multiplexor value");
+        CHECK_CONDITION(info[2].IsTypedArray(), "Invalid argument");
+
+        Napi::Float64Array values = info[0].As<Napi::Float64Array>();
+        Napi::Uint8Array   jsData = info[2].As<Napi::Uint8Array>();
+        int64_t            mux    = info[1].As<Napi::Number>().Int64Value();
+
+        CHECK_CONDITION(values.TypedArrayType() == napi_float64_array &&
+                        values.ElementLength() >= m_Signals.size(), "Invalid values array");
+        CHECK_CONDITION(jsData.TypedArrayType() == napi_uint8_array, "Invalid argument");
+
+        std::memset(data, 0, sizeof(data));
+
+        const std::vector<uint32_t> *encode = &m_All;
+
+        if (mux >= 0) {
+            if (m_HasMux)
+                _setvalue(m_MuxOffset, m_MuxLength, ENDIANESS::INTEL, data, static_cast<uint64_t>(mux));
+
+            auto it = m_MuxTable.find(mux);
+            encode = (it != m_MuxTable.end()) ? &it->second : nullptr;
+        }
+
+        if (encode) {
+            const double *in = values.Data();
+
+            for (uint32_t index : *encode) {
+                const SignalLayout& sl = m_Signals[index];
+                double val = in[index];
+
+                if (std::isnan(val))
+                    continue;
+
+                // Apply scaling (slope/intercept).  For float/double signals these are
+                // typically 1/0 and the division/subtraction is a no-op.
+                val -= sl.intercept;
+                val /= sl.slope;
+
+                _setvalue(sl.offset, sl.bitLength, sl.endianess, data, _doubletoraw(val, sl.type));
+            }
+        }
+
+        size_t maxBytes = std::min<size_t>(jsData.ByteLength(), sizeof(data));
+        std::memcpy(jsData.Data(), data, maxBytes);
+
+        return env.Undefined();
+    }
+
+    // Set the deadband used by change detection in decode()
+    // arg[0] - signal index (as in the description)
+    // arg[1] - minimum absolute difference
+    // arg[2] - (optional) minimum difference relative to the last reported value, e.g. 0.01 for 1%
+    // A change is reported if the difference exceeds the larger of both, 0 reports every change.
+    Napi::Value SetDeadband(const Napi::CallbackInfo& info)
+    {
+        Napi::Env env = info.Env();
+
+        CHECK_CONDITION(info.Length() >= 2, "Too few arguments");
+        CHECK_CONDITION(info[0].IsNumber(), "Invalid signal index");
+        CHECK_CONDITION(info[1].IsNumber(), "Invalid deadband");
+        CHECK_CONDITION(info.Length() < 3 || info[2].IsNumber() || info[2].IsUndefined(), "Invalid deadband");
+
+        uint32_t index = info[0].As<Napi::Number>().Uint32Value();
+        double   abs   = info[1].As<Napi::Number>().DoubleValue();
+        double   rel   = (info.Length() > 2 && info[2].IsNumber()) ? info[2].As<Napi::Number>().DoubleValue() : 0.0;
+
+        CHECK_CONDITION(index < m_Signals.size(), "Invalid signal index");
+        CHECK_CONDITION(abs >= 0.0 && rel >= 0.0, "Invalid deadband");
+
+        m_Signals[index].deadbandAbs = abs;
+        m_Signals[index].deadbandRel = rel;
+
+        return env.Undefined();
+    }
+
+    // Set the last reported value change detection in decode() compares against, e.g. after
+    // the value was set locally
+    // arg[0] - signal index (as in the description)
+    // arg[1] - value, NaN reports the next decoded value as a change
+    Napi::Value SetShadow(const Napi::CallbackInfo& info)
+    {
+        Napi::Env env = info.Env();
+
+        CHECK_CONDITION(info.Length() >= 2, "Too few arguments");
+        CHECK_CONDITION(info[0].IsNumber(), "Invalid signal index");
+        CHECK_CONDITION(info[1].IsNumber(), "Invalid value");
+
+        uint32_t index = info[0].As<Napi::Number>().Uint32Value();
+        CHECK_CONDITION(index < m_Signals.size(), "Invalid signal index");
+
+        m_Shadow[index] = info[1].As<Napi::Number>().DoubleValue();
+
+        return env.Undefined();
+    }
+
+    std::vector<SignalLayout> m_Signals;
+    std::vector<double>       m_Shadow;    // value of each signal when it last changed, NaN initially
+
+    bool     m_Muxed;
+    bool     m_HasMux;
+    uint32_t m_MuxOffset;
+    uint32_t m_MuxLength;
+
+    std::vector<uint32_t> m_All;                                       // all signals
+    std::unordered_map<int64_t, std::vector<uint32_t>> m_MuxTable;     // mux value -> signals
+};
+
 //-----------------------------------------------------------------------------------------
 
 Napi::Object InitAll(Napi::Env env, Napi::Object exports)
 {
     exports.Set("decodeSignal", Napi::Function::New(env, DecodeSignal));
     exports.Set("encodeSignal", Napi::Function::New(env, EncodeSignal));
+    exports.Set("decodeSignalColumn", Napi::Function::New(env, DecodeSignalColumn));
+    exports.Set("decodeSignalColumns", Napi::Function::New(env, DecodeSignalColumns));
+    MessageLayout::Init(env, exports);
     return exports;
 }
 
@@ -0,0 +1,406 @@
+/* Copyright Sebastian Haas <sebastian@sebastianhaas.info>. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Signal bit extraction/insertion and the column kernels, free of Node-API so that
+// they can be built into the native benchmark (bench_signals) as well.
+
+#ifndef SIGNALS_CORE_H
+#define SIGNALS_CORE_H
+
+#include <endian.h>   // le64toh/be64toh/htole64/htobe64 (not pulled in transitively on all arches)
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#ifdef KAYAK_DATA_CHECK
+#include <cstdio>
+#endif
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HAVE_X86_KERNELS 1
+#endif
+
+enum class ENDIANESS
+{
+    MOTOROLA = 0,
+    INTEL
+};
+
+enum class SIGNAL_TYPE
+{
+    UNSIGNED = 0,
+    SIGNED   = 1,
+    FLOAT32  = 2,
+    FLOAT64  = 3
+};
+
+// Returns the fixed IEEE-754 bit width for float signal types; 0 for integer types.
+static inline uint32_t signal_type_bit_width(SIGNAL_TYPE t)
+{
+    switch (t) {
+        case SIGNAL_TYPE::FLOAT32: return 32;
+        case SIGNAL_TYPE::FLOAT64: return 64;
+        default:                   return 0;
+    }
+}
+
+//-----------------------------------------------------------------------------------------
+// Bit extraction and insertion
+
+[[nodiscard]] static inline uint64_t _getvalue(const uint8_t* data,
+                                        uint32_t offset,
+                                        uint32_t length,
+                                        ENDIANESS byteOrder)
+{
+    uint64_t d_raw;
+    std::memcpy(&d_raw, data, sizeof(d_raw));
+    uint64_t d = (byteOrder == ENDIANESS::INTEL) ? le64toh(d_raw) : be64toh(d_raw);
+
+    uint64_t m = (length == 64) ? UINT64_MAX : (UINT64_C(1) << length) - 1;
+    size_t shift = (byteOrder == ENDIANESS::INTEL) ? offset : (64 - offset - length);
+
+    uint64_t o = (d >> shift) & m;
+
+#ifdef KAYAK_DATA_CHECK
+    size_t i;
+    int bitNr;
+    uint64_t val = 0;
+    if (byteOrder == ENDIANESS::INTEL) {
+        for (i = 0; i < length; i++) {
+            bitNr = i + offset;
+            val |= ((data[bitNr >> 3] >> (bitNr & 0x07)) & 1) << i;
+        }
+    } else {
+        for (i = 0; i < length; i++) {
+            bitNr = offset + length - i -1;
+            val |= ((data[bitNr >> 3] >> (7-(bitNr & 0x07))) & 1) << i;
+        }
+    }
+
+    if (val != o) {
+        fprintf(stderr, "getvalue: got %lu, expected %lu\n", val, o);
+    }
+#endif
+
+    return o;
+}
+
+static inline void _setvalue(uint32_t offset, uint32_t bitLength, ENDIANESS endianess,
+                      uint8_t* data, uint64_t raw_value)
+{
+    uint64_t o_raw;
+    std::memcpy(&o_raw, data, sizeof(o_raw));
+    uint64_t o = (endianess == ENDIANESS::INTEL) ? le64toh(o_raw) : be64toh(o_raw);
+
+    uint64_t m = (bitLength == 64) ? UINT64_MAX : (UINT64_C(1) << bitLength) - 1;
+    size_t shift = (endianess == ENDIANESS::INTEL) ? offset : (64 - offset - bitLength);
+
+    o &= ~(m << shift);
+    o |= (raw_value & m) << shift;
+
+    o = (endianess == ENDIANESS::INTEL) ? htole64(o) : htobe64(o);
+    std::memcpy(data, &o, sizeof(o));
+
+#ifdef KAYAK_DATA_CHECK
+    size_t i;
+    int bitNr;
+    uint64_t val = 0;
+    if (endianess == ENDIANESS::INTEL) {
+        for (i = 0; i < bitLength; i++) {
+            bitNr = i + offset;
+            val |= ((data[bitNr >> 3] >> (bitNr & 0x07)) & 1) << i;
+        }
+    } else {
+        for (i = 0; i < bitLength; i++) {
+            bitNr = offset + bitLength - i -1;
+            val |= ((data[bitNr >> 3] >> (7-(bitNr & 0x07))) & 1) << i;
+        }
+    }
+    if(val != ( raw_value & m)) {
+        fprintf(stderr, "setvalue: got %lu, expected %lu\n", val, raw_value & m);
+    }
+#endif
+}
+
+//-----------------------------------------------------------------------------------------
+// Conversion between raw and physical values
+
+// Convert a raw value as returned by _getvalue() into a number according to the signal type
+static inline double _rawtodouble(uint64_t val, uint32_t bitLength, SIGNAL_TYPE signalType)
+{
+    switch (signalType) {
+        case SIGNAL_TYPE::FLOAT32:
+            return static_cast<double>(std::bit_cast<float>(static_cast<uint32_t>(val)));
+        case SIGNAL_TYPE::FLOAT64:
+            return std::bit_cast<double>(val);
+        case SIGNAL_TYPE::SIGNED:
+            if (val & (UINT64_C(1) << (bitLength - 1))) {
+                uint64_t sign_mask = UINT64_C(1) << (bitLength - 1);
+                return static_cast<double>(static_cast<int64_t>((val ^ sign_mask) - sign_mask));
+            }
+            return static_cast<double>(val);
+        default:
+            return static_cast<double>(val);
+    }
+}
+
+// Convert a physical value (already unscaled) into the raw bits to be placed into the frame
+static inline uint64_t _doubletoraw(double val, SIGNAL_TYPE signalType)
+{
+    switch (signalType) {
+        case SIGNAL_TYPE::FLOAT32:
+            return static_cast<uint64_t>(std::bit_cast<uint32_t>(static_cast<float>(val)));
+        case SIGNAL_TYPE::FLOAT64:
+            return std::bit_cast<uint64_t>(val);
+        default:
+            break;
+    }
+
+    // Integer types: round half up like Math.round(), negative values in two's complement
+    val = std::floor(val + 0.5);
+
+    if (!std::isfinite(val))
+        return 0;
+    if (val >= 18446744073709551616.0)
+        return UINT64_MAX;
+    if (val >= 9223372036854775808.0)
+        return static_cast<uint64_t>(val);
+    if (val < -9223372036854775808.0)
+        return static_cast<uint64_t>(INT64_MIN);
+
+    return static_cast<uint64_t>(static_cast<int64_t>(val));
+}
+
+struct SignalLayout
+{
+    uint32_t    offset;
+    uint32_t    bitLength;      // effective length, fixed for float types
+    ENDIANESS   endianess;
+    SIGNAL_TYPE type;
+    double      slope;
+    double      intercept;
+    double      deadbandAbs;    // change detection: minimum absolute difference
+    double      deadbandRel;    // change detection: minimum difference relative to the last value
+};
+
+// _getvalue() operates on the first 64 bit of the payload only
+static inline bool _signal_decodable(const SignalLayout& sl)
+{
+    return sl.bitLength > 0 && sl.bitLength <= 64 && sl.offset + sl.bitLength <= 64;
+}
+
+//-----------------------------------------------------------------------------------------
+// Column kernels: one signal decoded from count frames, frame i starting at i * stride.
+// Slope and intercept are applied like in MessageLayout.decode() (0 meaning none), so
+// every kernel produces exactly the values decode() would.
+
+typedef void (*ColumnKernel)(const uint8_t* frames, size_t stride, size_t count,
+                             const SignalLayout& sl, double* out);
+
+static inline void _decode_column_scalar(const uint8_t* frames, size_t stride, size_t count,
+                                  const SignalLayout& sl, double* out)
+{
+    uint8_t data[8];
+
+    for (size_t i = 0; i < count; i++) {
+        const uint8_t* frame = frames + i * stride;
+
+        // Frames shorter than 64 bit are zero padded like in decode()
+        if (stride < sizeof(data)) {
+            std::memset(data, 0, sizeof(data));
+            std::memcpy(data, frame, stride);
+            frame = data;
+        }
+
+        double val = _rawtodouble(_getvalue(frame, sl.offset, sl.bitLength, sl.endianess),
+                                  sl.bitLength, sl.type);
+
+        if (sl.slope != 0.0)
+            val *= sl.slope;
+        if (sl.intercept != 0.0)
+            val += sl.intercept;
+
+        out[i] = val;
+    }
+}
+
+// The vector kernels load 64 bit per frame and convert integers through the mantissa of
+// 1.5 * 2^52, which is exact for values within +-2^51.
+static inline bool _column_vectorizable(const SignalLayout& sl, size_t stride)
+{
+    if (stride < 8)
+        return false;
+
+    switch (sl.type) {
+        case SIGNAL_TYPE::UNSIGNED: return sl.bitLength <= 51;
+        case SIGNAL_TYPE::SIGNED:   return sl.bitLength <= 52;
+        default:                    return true;
+    }
+}
+
+#ifdef HAVE_X86_KERNELS
+
+#define COLUMN_MAGIC INT64_C(0x4338000000000000)    // bits of 1.5 * 2^52
+
+__attribute__((target("avx2")))
+static inline void _decode_column_avx2(const uint8_t* frames, size_t stride, size_t count,
+                                const SignalLayout& sl, double* out)
+{
+    const bool     motorola = sl.endianess == ENDIANESS::MOTOROLA;
+    const uint32_t shift    = motorola ? 64 - sl.offset - sl.bitLength : sl.offset;
+    const uint64_t mask     = (sl.bitLength == 64) ? UINT64_MAX : (UINT64_C(1) << sl.bitLength) - 1;
+
+    const __m256i swap   = _mm256_setr_epi8(7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8,
+                                            7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8);
+    const __m256i low32  = _mm256_setr_epi32(0, 2, 4, 6, 0, 2, 4, 6);
+    const __m128i vshift = _mm_cvtsi32_si128(static_cast<int>(shift));
+    const __m256i vmask  = _mm256_set1_epi64x(static_cast<int64_t>(mask));
+    const __m256i vsign  = _mm256_set1_epi64x(static_cast<int64_t>(UINT64_C(1) << (sl.bitLength - 1)));
+    const __m256i magic  = _mm256_set1_epi64x(COLUMN_MAGIC);
+    const __m256d vslope = _mm256_set1_pd(sl.slope);
+    const __m256d vicept = _mm256_set1_pd(sl.intercept);
+
+    size_t i = 0;
+
+    for (; i + 4 <= count; i += 4) {
+        const uint8_t* p = frames + i * stride;
+        int64_t w[4];
+
+        std::memcpy(&w[0], p, 8);
+        std::memcpy(&w[1], p + stride, 8);
+        std::memcpy(&w[2], p + 2 * stride, 8);
+        std::memcpy(&w[3], p + 3 * stride, 8);
+
+        __m256i v = _mm256_setr_epi64x(w[0], w[1], w[2], w[3]);
+
+        if (motorola)
+            v = _mm256_shuffle_epi8(v, swap);
+
+        v = _mm256_and_si256(_mm256_srl_epi64(v, vshift), vmask);
+
+        __m256d x;
+
+        if (sl.type == SIGNAL_TYPE::FLOAT64) {
+            x = _mm256_castsi256_pd(v);
+        } else if (sl.type == SIGNAL_TYPE::FLOAT32) {
+            x = _mm256_cvtps_pd(_mm_castsi128_ps(_mm256_castsi256_si128(_mm256_permutevar8x32_epi32(v, low32))));
+        } else {
+            if (sl.type == SIGNAL_TYPE::SIGNED)
+                v = _mm256_sub_epi64(_mm256_xor_si256(v, vsign), vsign);
+
+            x = _mm256_sub_pd(_mm256_castsi256_pd(_mm256_add_epi64(v, magic)), _mm256_castsi256_pd(magic));
+        }
+
+        if (sl.slope != 0.0)
+            x = _mm256_mul_pd(x, vslope);
+        if (sl.intercept != 0.0)
+            x = _mm256_add_pd(x, vicept);
+
+        _mm256_storeu_pd(out + i, x);
+    }
+
+    _decode_column_scalar(frames + i * stride, stride, count - i, sl, out + i);
+}
+
+__attribute__((target("sse4.1")))
+static inline void _decode_column_sse41(const uint8_t* frames, size_t stride, size_t count,
+                                 const SignalLayout& sl, double* out)
+{
+    const bool     motorola = sl.endianess == ENDIANESS::MOTOROLA;
+    const uint32_t shift    = motorola ? 64 - sl.offset - sl.bitLength : sl.offset;
+    const uint64_t mask     = (sl.bitLength == 64) ? UINT64_MAX : (UINT64_C(1) << sl.bitLength) - 1;
+
+    const __m128i swap   = _mm_setr_epi8(7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8);
+    const __m128i vshift = _mm_cvtsi32_si128(static_cast<int>(shift));
+    const __m128i vmask  = _mm_set1_epi64x(static_cast<int64_t>(mask));
+    const __m128i vsign  = _mm_set1_epi64x(static_cast<int64_t>(UINT64_C(1) << (sl.bitLength - 1)));
+    const __m128i magic  = _mm_set1_epi64x(COLUMN_MAGIC);
+    const __m128d vslope = _mm_set1_pd(sl.slope);
+    const __m128d vicept = _mm_set1_pd(sl.intercept);
+
+    size_t i = 0;
+
+    for (; i + 2 <= count; i += 2) {
+        const uint8_t* p = frames + i * stride;
+        int64_t w[2];
+
+        std::memcpy(&w[0], p, 8);
+        std::memcpy(&w[1], p + stride, 8);
+
+        __m128i v = _mm_set_epi64x(w[1], w[0]);
+
+        if (motorola)
+            v = _mm_shuffle_epi8(v, swap);
+
+        v = _mm_and_si128(_mm_srl_epi64(v, vshift), vmask);
+
+        __m128d x;
+
+        if (sl.type == SIGNAL_TYPE::FLOAT64) {
+            x = _mm_castsi128_pd(v);
+        } else if (sl.type == SIGNAL_TYPE::FLOAT32) {
+            x = _mm_cvtps_pd(_mm_castsi128_ps(_mm_shuffle_epi32(v, _MM_SHUFFLE(2, 0, 2, 0))));
+        } else {
+            if (sl.type == SIGNAL_TYPE::SIGNED)
+                v = _mm_sub_epi64(_mm_xor_si128(v, vsign), vsign);
+
+            x = _mm_sub_pd(_mm_castsi128_pd(_mm_add_epi64(v, magic)), _mm_castsi128_pd(magic));
+        }
+
+        if (sl.slope != 0.0)
+            x = _mm_mul_pd(x, vslope);
+        if (sl.intercept != 0.0)
+            x = _mm_add_pd(x, vicept);
+
+        _mm_storeu_pd(out + i, x);
+    }
+
+    _decode_column_scalar(frames + i * stride, stride, count - i, sl, out + i);
+}
+
+#endif // HAVE_X86_KERNELS
+
+// Widest kernel the CPU supports, chosen once
+static inline ColumnKernel _select_column_kernel()
+{
+#ifdef HAVE_X86_KERNELS
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("avx2"))
+        return _decode_column_avx2;
+    if (__builtin_cpu_supports("sse4.1"))
+        return _decode_column_sse41;
+#endif
+
+    return _decode_column_scalar;
+}
+
+static inline void _decode_column(const uint8_t* frames, size_t stride, size_t count,
+                           const SignalLayout& sl, double* out)
+{
+    static const ColumnKernel kernel = _select_column_kernel();
+
+    if (_column_vectorizable(sl, stride))
+        kernel(frames, stride, count, sl, out);
+    else
+        _decode_column_scalar(frames, stride, count, sl, out);
+}
+
+#endif // SIGNALS_CORE_H
@@ -5,20 +5,195 @@ declare module "*can.node" {
 		rtr: boolean;
 		data: Buffer;
 		err?: boolean;
+		/** Receive timestamp (seconds part), set if timestamps are enabled */
+		ts_sec?: number;
+		/** Receive timestamp (microseconds part) */
+		ts_usec?: number;
+		/** Receive timestamp in nanoseconds */
+		ts_ns?: bigint;
+	}
+
+	/**
+	 * Source of receive timestamps, true equals "software"
+	 */
+	export type TimestampSource = boolean | "none" | "software" | "hardware";
+
+	/**
+	 * How a channel waits for received frames: "thread" uses a dedicated reader thread,
+	 * "poll" receives on the event loop thread via uv_poll, "reactor" on the epoll reactor
+	 * threads shared by all channels
+	 */
+	export type RxMode = "thread" | "poll" | "reactor";
+
+	export type TxOverflow = "reject" | "drop-newest" | "drop-oldest";
+
+	/**
+	 * Set the number of worker threads of the receive reactor used by channels with rx_mode "reactor".
+	 * Applies to the reactor of the calling environment (main or worker thread) only. Once its
+	 * channels receive, workers are only ever added.
+	 * @method setReactorWorkers
+	 * @param workers {integer} number of threads (default 1)
+	 */
+	export function setReactorWorkers(workers: number): void;
+
+	/**
+	 * Columnar representation of several frames as delivered to onBatch listeners.
+	 * All typed arrays are views into the same ArrayBuffer, the payload of frame i
+	 * starts at data[i * stride].
+	 */
+	export interface FrameBatch {
+		count: number;
+		stride: number;
+		buffer: ArrayBuffer;
+		tsNs: BigUint64Array;
+		ids: Uint32Array;
+		flags: Uint8Array;
+		lens: Uint8Array;
+		data: Uint8Array;
+	}
+
+	/**
+	 * Counters of a channel as returned by getStats()
+	 */
+	export interface ChannelStats {
+		/** frames received from the socket */
+		rxFrames: number;
+		/** payload bytes received */
+		rxBytes: number;
+		/** frames dropped by the kernel because the socket queue was full (SO_RXQ_OVFL) */
+		rxDropped: number;
+		/** times the reader thread had to wait for JS to drain the receive ring */
+		rxRingFull: number;
+		/** frames accepted by the kernel */
+		txFrames: number;
+		/** transmissions failed with EAGAIN (non-blocking send, queue full) */
+		txEagain: number;
+		/** transmissions failed with ENOBUFS (device queue full) */
+		txEnobufs: number;
+		/** transmissions failed for any other reason */
+		txErrors: number;
+		/** frames dropped by the overflow policy of a full transmit queue */
+		txQueueDropped: number;
+		/** main thread dispatch rounds */
+		wakeups: number;
+		/** frames handled by all dispatch rounds */
+		wakeupFrames: number;
+		/** most frames handled by a single dispatch round */
+		wakeupFramesMax: number;
+		/** dispatch rounds cut short by MAX_FRAMES_PER_ASYNC_EVENT */
+		wakeupsTruncated: number;
+		/** exceptions thrown by listeners */
+		callbackErrors: number;
+	}
+
+	/**
+	 * Percentiles of one latency histogram in nanoseconds
+	 */
+	export interface LatencyPercentiles {
+		count: number;
+		p50: number;
+		p99: number;
+		p999: number;
+		max: number;
+	}
+
+	/**
+	 * Latency of the receive path as returned by getLatencyHistograms()
+	 */
+	export interface LatencyHistograms {
+		/** kernel timestamp -> reader thread fetched the frame (software timestamps only) */
+		kernelToThread: LatencyPercentiles;
+		/** reader thread -> main thread starts dispatching the frames of a wakeup */
+		threadToDispatch: LatencyPercentiles;
+		/** dispatch start -> all listeners of the frame returned */
+		dispatchToReturn: LatencyPercentiles;
+	}
+
+	/**
+	 * Options of startRecording()
+	 */
+	export interface RecordingOptions {
+		/** "binary" NCANLOG records (default) or candump -l compatible text */
+		format?: "binary" | "candump";
+		/** Start a new file once this many bytes are written */
+		maxSize?: number;
+		/** Start a new file after this many seconds */
+		maxTime?: number;
+		/** Longest time in ms a frame stays buffered before it is written (default 1000) */
+		flushInterval?: number;
+		/** Bytes buffered for the writer thread (default 4 MiB) */
+		bufferSize?: number;
+	}
+
+	/**
+	 * Counters of a recording as returned by getRecordingStats()
+	 */
+	export interface RecordingStats {
+		written: number;
+		/** frames lost because the writer fell behind or writing failed */
+		dropped: number;
+		bytes: number;
+		files: number;
+		/** description of the first write error */
+		error?: string;
+	}
+
+	/**
+	 * Options of startReplay()
+	 */
+	export interface ReplayOptions {
+		/** Time scale, 2 replays twice as fast (default 1) */
+		speed?: number;
+		/** true repeats until stopReplay(), a number sets the passes (default 1) */
+		loop?: boolean | number;
+		/** ms of capture time between passes, scaled by speed (default the mean frame spacing) */
+		loopGap?: number;
+		/** Ignore timestamps and send as fast as the socket accepts */
+		maxRate?: boolean;
+		/**
+		 * Identifier replacements { [from]: to }, the frame format is kept. Keys are 11 bit
+		 * identifiers, 29 bit ones have CAN_EFF_FLAG (0x80000000) set.
+		 */
+		remap?: Record<number | string, number>;
+	}
+
+	/**
+	 * Progress of a replay as returned by getReplayStats() and passed to onReplayDone
+	 */
+	export interface ReplayStats {
+		sent: number;
+		errors: number;
+		/** completed passes over the capture */
+		loops: number;
+		stopped: boolean;
+		/** ms since the start */
+		duration?: number;
+		/** description of the first send error */
+		error?: string;
+		/** delay of the transmissions against their target time in ns, not with maxRate */
+		timingError?: LatencyPercentiles & { mean: number };
 	}
 
 	export class RawChannel {
 		constructor(
 			name: string,
-			timestamps?: boolean,
+			timestamps?: TimestampSource,
 			protocol?: number,
 			non_block_send?: boolean,
+			rx_ring_size?: number,
+			rx_mode?: RxMode,
+			rx_pooled?: boolean,
+			tx_queue_size?: number,
+			tx_overflow?: TxOverflow,
 		);
 
 		/**
 		 * Add listener to receive certain notifications
 		 * @method addListener
-		 * @param event {string} onMessage to register for incoming messages
+		 * @param event {string} onMessage to register for incoming messages, onBatch to receive them
+		 *                      in columnar batches, onStopped to get notified when the channel stops,
+		 *                      onReplayDone to get the final ReplayStats of startReplay(), onDrain to get notified
+		 *                      when the transmit queue emptied after a send returned false
 		 * @param callback {any} JS callback object
 		 * @param instance {any} Optional instance pointer to call callback
 		 */
@@ -28,6 +203,35 @@ declare module "*can.node" {
 			instance?: object,
 		): void;
 
+		/**
+		 * Add listener for frames with a certain identifier only. Frames nobody subscribed to
+		 * (neither via onMessage nor by identifier) are dropped without calling into JS.
+		 * @method addIdListener
+		 * @param id {integer} CAN identifier
+		 * @param ext {bool} true for a 29 bit identifier
+		 * @param callback {any} JS callback object, called with the same message object as onMessage
+		 * @param instance {any} Optional instance pointer to call callback
+		 */
+		addIdListener(
+			id: number,
+			ext: boolean,
+			callback: CallableFunction,
+			instance?: object,
+		): void;
+
+		/**
+		 * Remove listeners added with addIdListener()
+		 * @method removeIdListener
+		 * @param id {integer} CAN identifier
+		 * @param ext {bool} true for a 29 bit identifier
+		 * @param callback {any} Optional, remove only this callback instead of all listeners of the id
+		 */
+		removeIdListener(
+			id: number,
+			ext: boolean,
+			callback?: CallableFunction,
+		): void;
+
 		/**
 		 * Start operation on this CAN channel
 		 * @method start
@@ -46,10 +250,15 @@ declare module "*can.node" {
 		 * PLEASE NOTE: By default, this function may block if the Tx buffer is not available. Please use
 		 * createRawChannelWithOptions({non_block_send: true}) to get non-blocking sending activated.
 		 *
+		 * With a transmit queue (tx_queue_size) sending never blocks, frames the socket has no room for
+		 * are queued and sent once it has.
+		 *
 		 * @method send
 		 * @param message {Object} JSON object describing the CAN message, keys are id, length, data {Buffer}, ext or rtr
+		 * @return {integer|bool} result of send(), with a transmit queue false if it is full and onDrain should
+		 *                        be awaited before sending more
 		 */
-		send(message: Message): void;
+		send(message: Message): number | boolean;
 
 		/**
 		 * Send a CAN FD message immediately.
@@ -61,8 +270,53 @@ declare module "*can.node" {
 		 *
 		 * @method sendFD
 		 * @param message {Object} JSON object describing the CAN message, keys are id, length, data {Buffer}, ext
+		 * @return {integer|bool} as send()
 		 */
-		sendFD(message: Message): void;
+		sendFD(message: Message): number | boolean;
+
+		/**
+		 * Send a CAN or CAN FD frame given as plain values. Unlike send() no message object is read
+		 * or stamped with ts_sec/ts_usec, and nothing is allocated.
+		 *
+		 * PLEASE NOTE: Same blocking behaviour as send().
+		 *
+		 * @method sendRaw
+		 * @param id {integer} CAN identifier
+		 * @param flags {integer} FrameFlags bits, EXT, RTR, FD and BRS are used
+		 * @param data {Buffer} payload
+		 * @param offset {integer} Optional, start of the payload in data
+		 * @param length {integer} Optional, payload length (default up to the end of data)
+		 * @return {integer|bool} as send()
+		 */
+		sendRaw(
+			id: number,
+			flags: number,
+			data: Uint8Array,
+			offset?: number,
+			length?: number,
+		): number | boolean;
+
+		/**
+		 * Send several CAN / CAN FD messages with a single sendmmsg() call.
+		 *
+		 * Accepts either an array of message objects (as used with send(), set fd: true to send an
+		 * element like sendFD()) or a packed batch in the onBatch layout, i.e. an object providing
+		 * count, stride, ids, flags, lens and data (see FrameFlags for the flag bits).
+		 *
+		 * PLEASE NOTE: Same blocking behaviour as send(). With non_block_send the kernel may accept
+		 * only part of the batch; resend the remaining frames starting at the returned index.
+		 * With a transmit queue the frames the kernel does not accept are queued instead, fewer than
+		 * all are taken only if the queue fills up and its policy is "reject".
+		 *
+		 * @method sendBatch
+		 * @param frames {Array|Object} array of message objects or packed batch
+		 * @return {integer} number of frames accepted by the kernel (or the transmit queue)
+		 */
+		sendBatch(
+			frames:
+				| (Message & { fd?: boolean; fd_brs?: boolean })[]
+				| Omit<FrameBatch, "buffer" | "tsNs">,
+		): number;
 
 		/**
 		 * Set a list of active filters to be applied for incoming messages
@@ -83,5 +337,388 @@ declare module "*can.node" {
 		 * @method disableLoopback
 		 */
 		disableLoopback(): void;
+
+		/**
+		 * Get the counters of this channel accumulated since its creation or the last resetStats()
+		 * @method getStats
+		 */
+		getStats(): ChannelStats;
+
+		/**
+		 * Restart all counters reported by getStats() from zero
+		 * @method resetStats
+		 */
+		resetStats(): void;
+
+		/**
+		 * Measure the latency of the receive path. Disabled by default, it costs one clock read
+		 * per recvmmsg() call and two per dispatched frame while enabled.
+		 * @method enableLatencyHistograms
+		 * @param enable {bool} Optional, false to stop measuring (default true)
+		 */
+		enableLatencyHistograms(enable?: boolean): void;
+
+		/**
+		 * Get the latency histograms of the receive path, all values in nanoseconds
+		 * @method getLatencyHistograms
+		 */
+		getLatencyHistograms(): LatencyHistograms;
+
+		/**
+		 * Clear the latency histograms
+		 * @method resetLatencyHistograms
+		 */
+		resetLatencyHistograms(): void;
+
+		/**
+		 * Publish all received frames from the receiving thread into a shared ring
+		 * (createSharedRing()) that worker threads read with SharedRingReader
+		 * @method attachSharedRing
+		 */
+		attachSharedRing(ring: Int32Array): this;
+
+		/**
+		 * @method detachSharedRing
+		 */
+		detachSharedRing(): this;
+
+		/**
+		 * Write all received frames to a file from the receiving thread, without passing
+		 * them through JS. Rotated files are numbered path.0, path.1, ...
+		 * @method startRecording
+		 */
+		startRecording(path: string, options?: RecordingOptions): this;
+
+		/**
+		 * Finish the recording and close its file
+		 * @method stopRecording
+		 */
+		stopRecording(): RecordingStats;
+
+		/**
+		 * Write all buffered frames and wait until they reached the disk
+		 * @method flushRecording
+		 */
+		flushRecording(): this;
+
+		/**
+		 * @method getRecordingStats
+		 */
+		getRecordingStats(): RecordingStats;
+
+		/**
+		 * Transmit a capture (binary or candump format) paced by a native thread against
+		 * its timestamps
+		 * @method startReplay
+		 */
+		startReplay(path: string, options?: ReplayOptions): this;
+
+		/**
+		 * Stop the replay early, onReplayDone follows
+		 * @method stopReplay
+		 */
+		stopReplay(): this;
+
+		/**
+		 * @method getReplayStats
+		 */
+		getReplayStats(): ReplayStats;
+	}
+
+	/**
+	 * Options of a BCM RX job, times in ms
+	 */
+	export interface BcmRxOptions {
+		ext?: boolean;
+		fd?: boolean;
+		/** Payload bits compared against the previous frame, omit to pass every frame */
+		mask?: Buffer;
+		/** Raise onTimeout if no frame arrives within this time */
+		timeout?: number;
+		/** Minimum time between two reported changes */
+		throttle?: number;
+	}
+
+	/**
+	 * Kernel broadcast manager (CAN_BCM) of an interface, sends cyclic messages on kernel timers
+	 * and filters received messages for changes and timeouts
+	 */
+	export class BcmChannel {
+		/**
+		 * @constructor BcmChannel
+		 * @param name {string} interface name (e.g. can0)
+		 */
+		constructor(name: string);
+
+		/**
+		 * Set up or replace the TX job for the identifier of message
+		 * @method setupCyclic
+		 * @param message {Message} frame to send, fd: true selects CAN FD
+		 * @param interval {number} cycle time in ms
+		 * @param count {number} Optional, number of frames sent with count_interval first
+		 * @param count_interval {number} Optional, cycle time in ms of the first count frames
+		 */
+		setupCyclic(
+			message: Message & { fd?: boolean; fd_brs?: boolean },
+			interval: number,
+			count?: number,
+			count_interval?: number,
+		): this;
+
+		/**
+		 * Replace the content of a running TX job, its timing is kept
+		 * @method updateCyclic
+		 */
+		updateCyclic(
+			message: Message & { fd?: boolean; fd_brs?: boolean },
+		): this;
+
+		/**
+		 * Remove the TX job of an identifier
+		 * @method stopCyclic
+		 */
+		stopCyclic(id: number, ext?: boolean, fd?: boolean): this;
+
+		/**
+		 * @method addListener
+		 * @param event {string} onMessage for frames passing an RX job, onTimeout when an RX job
+		 *                       timed out (called with {id, ext})
+		 */
+		addListener(
+			event: "onMessage",
+			callback: (msg: Message & { fd?: boolean }) => void,
+			instance?: object,
+		): this;
+		addListener(
+			event: "onTimeout",
+			callback: (msg: { id: number; ext?: boolean }) => void,
+			instance?: object,
+		): this;
+
+		/**
+		 * Set up or replace the RX job for an identifier
+		 * @method setupRx
+		 */
+		setupRx(id: number, options?: BcmRxOptions): this;
+
+		/**
+		 * Remove the RX job of an identifier
+		 * @method removeRx
+		 */
+		removeRx(id: number, ext?: boolean, fd?: boolean): this;
+
+		/**
+		 * Close the channel, which removes all of its jobs
+		 * @method close
+		 */
+		close(): this;
+	}
+
+	/**
+	 * Addressing and flow control of an IsoTpChannel
+	 */
+	export interface IsoTpOptions {
+		txId: number;
+		rxId: number;
+		/** txId and rxId are 29 bit identifiers */
+		ext?: boolean;
+		/** Block size announced in flow control frames, 0 = no limit */
+		blockSize?: number;
+		/** Minimum separation time in us announced in flow control frames */
+		stMin?: number;
+		/** Maximum number of wait frames accepted */
+		wftMax?: number;
+		/** Pad frames to full length with this byte, true pads with 0xCC */
+		padding?: number | boolean;
+		/** Extended addressing: first payload byte of sent (and received) frames */
+		extAddress?: number;
+		/** Different extended address of received frames */
+		rxExtAddress?: number;
+		/** Receive only, no flow control frames are sent */
+		listenOnly?: boolean;
+		/** CAN FD frames with txDataLength bytes (default 64) */
+		fd?: boolean;
+		txDataLength?: number;
+		fd_brs?: boolean;
+	}
+
+	/**
+	 * ISO 15765-2 transport channel, segmentation and flow control are done by the kernel
+	 * (CAN_ISOTP). Active until close().
+	 */
+	export class IsoTpChannel {
+		/**
+		 * @constructor IsoTpChannel
+		 * @param name {string} interface name (e.g. can0)
+		 */
+		constructor(name: string, options: IsoTpOptions);
+
+		/**
+		 * Queue a PDU, callback is called once it was sent or failed
+		 * @method send
+		 */
+		send(data: Buffer, callback?: (err: Error | null) => void): this;
+
+		/**
+		 * @method addListener
+		 * @param event {string} onMessage for received PDUs, onError for failed receptions
+		 */
+		addListener(
+			event: "onMessage",
+			callback: (data: Buffer) => void,
+			instance?: object,
+		): this;
+		addListener(
+			event: "onError",
+			callback: (err: Error) => void,
+			instance?: object,
+		): this;
+
+		/**
+		 * @method close
+		 */
+		close(): this;
+	}
+
+	/**
+	 * Binding of a J1939Channel. NAMEs are BigInts or 8 byte little endian Buffers as
+	 * returned by J1939.getName(). With name and addr the channel claims addr before its first
+	 * send; sends from addresses 128..247 follow 250 ms after the claim (J1939-81)
+	 */
+	export interface J1939Options {
+		name?: bigint | Buffer;
+		/** Own source address */
+		addr?: number;
+		/** Only receive this PGN */
+		pgn?: number;
+		/** Receive traffic addressed to others too */
+		promisc?: boolean;
+		/** Allow sending to the global address */
+		broadcast?: boolean;
+		/** Default priority 0..7 */
+		priority?: number;
+	}
+
+	export interface J1939Message {
+		pgn: number;
+		data: Buffer;
+		/** Destination address, omit (or 0xFF) for the global address */
+		dest?: number;
+		destName?: bigint | Buffer;
+		priority?: number;
+	}
+
+	export interface J1939ReceivedMessage {
+		pgn: number;
+		data: Buffer;
+		src: number;
+		srcName?: bigint;
+		dest: number;
+		destName?: bigint;
+		priority?: number;
+	}
+
+	/**
+	 * SAE J1939 channel, transport protocols and address claim bookkeeping are done by
+	 * the kernel (CAN_J1939). Active until close().
+	 */
+	export class J1939Channel {
+		/**
+		 * @constructor J1939Channel
+		 * @param name {string} interface name (e.g. can0)
+		 */
+		constructor(name: string, options?: J1939Options);
+
+		/**
+		 * Queue a parameter group, callback is called once the kernel accepted it
+		 * @method send
+		 */
+		send(
+			message: J1939Message,
+			callback?: (err: Error | null) => void,
+		): this;
+
+		/**
+		 * @method addListener
+		 * @param event {string} onMessage for received parameter groups, onError for failed receptions
+		 */
+		addListener(
+			event: "onMessage",
+			callback: (msg: J1939ReceivedMessage) => void,
+			instance?: object,
+		): this;
+		addListener(
+			event: "onError",
+			callback: (err: Error) => void,
+			instance?: object,
+		): this;
+
+		/**
+		 * @method close
+		 */
+		close(): this;
+	}
+
+	/**
+	 * Selection of LogReader.query(), timestamps in ns (inclusive)
+	 */
+	export interface LogQuery {
+		start?: bigint | number;
+		end?: bigint | number;
+		ids?: number[];
+		/** ids are 29 bit identifiers */
+		ext?: boolean;
+		/** Maximum number of frames */
+		limit?: number;
+	}
+
+	/**
+	 * Frames selected by LogReader.query()
+	 */
+	export interface LogQueryResult extends FrameBatch {
+		/** Byte offset of each frame's payload in LogReader.buffer() */
+		offsets: Float64Array;
+	}
+
+	export interface LogInfo {
+		frames: number;
+		/** index blocks, each covering about 1 MiB of the capture */
+		blocks: number;
+		/** distinct identifiers */
+		ids: number;
+		start: bigint;
+		end: bigint;
+		/** true if the index was read from the .idx sidecar file */
+		indexLoaded: boolean;
+	}
+
+	/**
+	 * Memory-mapped, indexed access to a binary capture written by startRecording()
+	 */
+	export class LogReader {
+		/**
+		 * @constructor LogReader
+		 * @param path {string} capture file
+		 * @param options {Object} Optional, indexFile: load the index from and store it to path.idx (default true)
+		 */
+		constructor(path: string, options?: { indexFile?: boolean });
+
+		/**
+		 * @method info
+		 */
+		info(): LogInfo;
+
+		/**
+		 * Collect the frames of a time range and/or of some identifiers
+		 * @method query
+		 */
+		query(options?: LogQuery): LogQueryResult;
+
+		/**
+		 * The mapped capture, for zero-copy access to payloads via LogQueryResult.offsets.
+		 * Writes stay in this process and never reach the file.
+		 * @method buffer
+		 */
+		buffer(): ArrayBuffer;
 	}
 }
@@ -36,4 +36,104 @@ declare module "*can_signals.node" {
 		word1: number | boolean,
 		word2?: number | boolean,
 	): void;
+
+	// Decode one signal from every frame of a batch (vectorized where the CPU allows)
+	// arg[0] - count frames, frame i starts at i * stride
+	// arg[3..6] - signal as for decodeSignal
+	// arg[7] - receives count values
+	// arg[8], arg[9] - slope and intercept applied like MessageLayout.decode()
+	export function decodeSignalColumn(
+		data: Uint8Array,
+		stride: number,
+		count: number,
+		bitOffset: number,
+		bitLength: number,
+		endianess: boolean,
+		signalType: SignalType,
+		values: Float64Array,
+		slope?: number,
+		intercept?: number,
+	): void;
+
+	// Decode several signals from every frame of a batch, values[i] receives signal i
+	// (muxGroup of the descriptions is ignored)
+	export function decodeSignalColumns(
+		data: Uint8Array,
+		stride: number,
+		count: number,
+		signals: SignalLayoutDescription[],
+		values: Float64Array[],
+	): void;
+
+	export interface SignalLayoutDescription {
+		bitOffset: number;
+		bitLength: number;
+		littleEndian: boolean;
+		type: SignalType;
+		slope?: number;
+		intercept?: number;
+		muxGroup?: number[];
+	}
+
+	export interface MuxLayoutDescription {
+		offset: number;
+		length: number;
+	}
+
+	// A message description compiled once from the KCD definition, so that all signals
+	// of a received frame can be decoded with a single call.
+	export class MessageLayout {
+		constructor(
+			signals: SignalLayoutDescription[],
+			muxed: boolean,
+			mux?: MuxLayoutDescription,
+		);
+
+		// Decode all signals of a frame
+		// arg[0] - Data array
+		// arg[1] - receives the scaled value of each signal (index as in the description)
+		// arg[2] - set to 1 for every signal decoded from this frame, 0 for signals not
+		//          present due to multiplexing
+		// arg[3] - (optional) bitmask, bit i is set if signal i differs from the value it had
+		//          when it last changed by more than its deadband (see setDeadband)
+		// Returns the multiplexor value, -1 if the message is not multiplexed.
+		decode(
+			data: Uint8Array,
+			values: Float64Array,
+			active: Uint8Array,
+			changed?: Uint8Array,
+		): number;
+
+		// Decode one signal from every frame of a batch (LogReader.query(), onBatch)
+		// arg[0] - signal index (as in the description)
+		// arg[1] - count frames, frame i starts at i * stride
+		// arg[4] - receives count values, NaN where the signal is not present due to multiplexing
+		// Returns the number of frames the signal was decoded from.
+		decodeColumn(
+			index: number,
+			data: Uint8Array,
+			stride: number,
+			count: number,
+			values: Float64Array,
+		): number;
+
+		// Encode all signals of a message
+		// arg[0] - physical value of each signal (index as in the description), NaN for
+		//          signals without a value
+		// arg[1] - multiplexor value, or -1 to encode every signal without setting the multiplexor
+		// arg[2] - Data array, cleared and then filled with the encoded frame
+		encode(values: Float64Array, mux: number, data: Uint8Array): void;
+
+		// Set the deadband used by change detection in decode()
+		// arg[0] - signal index (as in the description)
+		// arg[1] - minimum absolute difference
+		// arg[2] - minimum difference relative to the last reported value, e.g. 0.01 for 1%
+		// A change is reported if the difference exceeds the larger of both, 0 reports every change.
+		setDeadband(index: number, absolute: number, relative?: number): void;
+
+		// Set the last reported value change detection in decode() compares against
+		// arg[0] - signal index (as in the description)
+		// arg[1] - value, NaN reports the next decoded value as a change
+		setShadow(index: number, value: number): void;
+	}
 }
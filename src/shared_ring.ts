@@ -0,0 +1,194 @@
+/* Copyright Sebastian Haas <sebastian@sebastianhaas.info>. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+// Broadcast ring of received frames in a SharedArrayBuffer, written by
+// RawChannel.attachSharedRing() and read from any number of worker threads.
+// This module does not load the native addon, workers can import it alone.
+// See SharedFrameRing in native/can.cc for the layout.
+
+const MAGIC = 0x5253434e;
+const VERSION = 1;
+const HEADER_SIZE = 64;
+const SLOT_SIZE = 88;
+const MAX_DLEN = 64;
+
+// Int32 index of the notify word, BigUint64 index of the write index
+const NOTIFY_INDEX = 4;
+const WRITE_INDEX = 3;
+
+/**
+ * Allocate and initialize a ring for capacity frames (rounded up to a power of two).
+ * @method createSharedRing
+ * @param capacity {integer} Optional, number of frames (default 4096)
+ * @return {SharedArrayBuffer} the ring, to be passed to workers and attachSharedRing()
+ * @for exports
+ */
+export function createSharedRing(capacity: number = 4096): SharedArrayBuffer {
+	let slots = 64;
+	while (slots < capacity) slots *= 2;
+
+	const ring = new SharedArrayBuffer(HEADER_SIZE + slots * SLOT_SIZE);
+	const header = new Uint32Array(ring, 0, 4);
+
+	header[1] = VERSION;
+	header[2] = slots;
+	header[3] = SLOT_SIZE;
+	header[0] = MAGIC;
+
+	return ring;
+}
+
+/**
+ * A frame handed to SharedRingReader.read() callbacks. The object and its data
+ * are reused for the next frame, copy what has to be kept.
+ */
+export interface SharedRingFrame {
+	id: number;
+	/** FrameFlags bits */
+	flags: number;
+	tsNs: bigint;
+	/** Payload, a view of exactly the frame's length */
+	data: Uint8Array;
+}
+
+/**
+ * Reader of a shared ring with its own cursor, one per thread.
+ * @class SharedRingReader
+ */
+export class SharedRingReader {
+	/**
+	 * Frames overwritten before this reader got to them
+	 * @attribute lost
+	 */
+	public lost = 0;
+
+	private readonly i32: Int32Array;
+	private readonly u32: Uint32Array;
+	private readonly u8: Uint8Array;
+	private readonly u64: BigUint64Array;
+	private readonly capacity: number;
+	private readonly views: Uint8Array[] = [];
+	private readonly frame: SharedRingFrame;
+	private cursor: number;
+
+	/**
+	 * @constructor SharedRingReader
+	 * @param ring {SharedArrayBuffer} ring created by createSharedRing()
+	 * @param fromStart {bool} Optional, start with the oldest frame still in the ring
+	 *                  instead of the next one published
+	 */
+	constructor(ring: SharedArrayBuffer, fromStart = false) {
+		this.i32 = new Int32Array(ring);
+		this.u32 = new Uint32Array(ring);
+		this.u8 = new Uint8Array(ring);
+		this.u64 = new BigUint64Array(ring);
+
+		if (this.u32[0] != MAGIC || this.u32[1] != VERSION || this.u32[3] != SLOT_SIZE)
+			throw new Error("Not a shared frame ring");
+
+		this.capacity = this.u32[2];
+
+		// One view per possible length, so reading allocates nothing per frame
+		const scratch = new Uint8Array(MAX_DLEN);
+		for (let len = 0; len <= MAX_DLEN; len++)
+			this.views.push(scratch.subarray(0, len));
+
+		this.frame = { id: 0, flags: 0, tsNs: 0n, data: this.views[0] };
+
+		const written = this.written();
+		this.cursor = fromStart ? Math.max(0, written - this.capacity) : written;
+	}
+
+	/**
+	 * Number of frames published but not read yet (overwritten ones included)
+	 * @method pending
+	 */
+	pending(): number {
+		return this.written() - this.cursor;
+	}
+
+	/**
+	 * Hand the published frames to onFrame without blocking.
+	 * @method read
+	 * @param onFrame {Function} called with a SharedRingFrame for each frame
+	 * @param max {integer} Optional, maximum number of frames
+	 * @return {integer} number of frames read
+	 */
+	read(onFrame: (frame: SharedRingFrame) => void, max = Infinity): number {
+		const written = this.written();
+
+		if (written - this.cursor > this.capacity) {
+			this.lost += written - this.capacity - this.cursor;
+			this.cursor = written - this.capacity;
+		}
+
+		let count = 0;
+
+		while (this.cursor < written && count < max) {
+			const seq = this.cursor++;
+			const slot = HEADER_SIZE + (seq % this.capacity) * SLOT_SIZE;
+			const version = ((Math.floor(seq / this.capacity) + 1) * 2) | 0;
+
+			if (Atomics.load(this.i32, slot >> 2) !== version) {
+				this.lost++;
+				continue;
+			}
+
+			const len = Math.min(this.u8[slot + 17], MAX_DLEN);
+			const data = this.views[len];
+
+			this.frame.id = this.u32[(slot >> 2) + 1];
+			this.frame.tsNs = this.u64[(slot >> 3) + 1];
+			this.frame.flags = this.u8[slot + 16];
+			for (let i = 0; i < len; i++) data[i] = this.u8[slot + 24 + i];
+
+			// Overwritten while copying
+			if (Atomics.load(this.i32, slot >> 2) !== version) {
+				this.lost++;
+				continue;
+			}
+
+			this.frame.data = data;
+			count++;
+			onFrame(this.frame);
+		}
+
+		return count;
+	}
+
+	/**
+	 * Block until frames are pending (Atomics.wait, so not on the main thread of a browser).
+	 * @method wait
+	 * @param timeout {number} Optional, ms
+	 * @return {bool} true if frames are pending
+	 */
+	wait(timeout?: number): boolean {
+		if (this.pending() > 0) return true;
+
+		Atomics.wait(this.i32, NOTIFY_INDEX, this.cursor | 0, timeout);
+
+		return this.pending() > 0;
+	}
+
+	private written(): number {
+		return Number(Atomics.load(this.u64, WRITE_INDEX));
+	}
+}
@@ -66,40 +66,69 @@ function signalTypeCode(type: kcd.SignalType): NativeSignalType {
 	}
 }
 
-/** Returns true for IEEE-754 float/double signal types. */
-function isFloatSignal(type: kcd.SignalType): boolean {
-	return type === "single" || type === "double";
-}
+/**
+ * Bit values of FrameBatch.flags as delivered to onBatch listeners.
+ * Mirrors the FrameFlags enum in native/can.cc.
+ */
+export const FrameFlags = {
+	EXT: 0x01,
+	RTR: 0x02,
+	ERR: 0x04,
+	FD: 0x08,
+	BRS: 0x10,
+	ESI: 0x20,
+} as const;
 
-const UINT32_MAX = 0xffffffff;
-const TWO_TO_32 = 2 ** 32;
+export type FrameBatch = can.FrameBatch;
+export type ChannelStats = can.ChannelStats;
+export type LatencyHistograms = can.LatencyHistograms;
+export type RecordingOptions = can.RecordingOptions;
+export type RecordingStats = can.RecordingStats;
+export type ReplayOptions = can.ReplayOptions;
+export type ReplayStats = can.ReplayStats;
+export type LogQuery = can.LogQuery;
+export type LogQueryResult = can.LogQueryResult;
+export type LogInfo = can.LogInfo;
+export type IsoTpOptions = can.IsoTpOptions;
+export type J1939Options = can.J1939Options;
+export type J1939Message = can.J1939Message;
+export type J1939ReceivedMessage = can.J1939ReceivedMessage;
 
 /**
  * @method createRawChannel
  * @param channel {string} Channel name (e.g. vcan0)
- * @param timestamps {bool} Whether or not timestamps shall be generated when reading a message
+ * @param timestamps {bool|string} Whether or not timestamps shall be generated when reading a message,
+ *                   "hardware" requests controller timestamps where the driver supports them
  * @param protocol {integer} optionally provide another default protocol value (default is CAN_RAW)
  * @return {RawChannel} a new channel object or exception
  * @for exports
  */
 export function createRawChannel(
 	channel: string,
-	timestamps?: boolean,
+	timestamps?: can.TimestampSource,
 	protocol?: number,
 ): can.RawChannel {
 	return new can.RawChannel(channel, timestamps, protocol, false);
 }
 
 interface ChannelOptions {
-	timestamps?: boolean;
+	timestamps?: can.TimestampSource;
 	protocol?: number;
 	non_block_send?: boolean;
+	rx_ring_size?: number;
+	rx_mode?: can.RxMode;
+	// Payloads of one wakeup are views into one pooled buffer instead of separate copies
+	rx_pooled?: boolean;
+	// Frames the socket has no room for are queued natively and sent once it has
+	tx_queue_size?: number;
+	tx_overflow?: can.TxOverflow;
 }
 
 /**
  * @method createRawChannelWithOptions
  * @param channel {string} Channel name (e.g. vcan0)
- * @param options {dict} list of options (timestamps, protocol, non_block_send)
+ * @param options {dict} list of options (timestamps, protocol, non_block_send, rx_ring_size, rx_mode, rx_pooled,
+ *                tx_queue_size, tx_overflow)
  * @return {RawChannel} a new channel object or exception
  * @for exports
  */
@@ -118,9 +147,116 @@ export function createRawChannelWithOptions(
 		options.timestamps,
 		options.protocol,
 		options.non_block_send,
+		options.rx_ring_size,
+		options.rx_mode,
+		options.rx_pooled,
+		options.tx_queue_size,
+		options.tx_overflow,
 	);
 }
 
+/**
+ * @method createBcmChannel
+ * @param channel {string} Channel name (e.g. vcan0)
+ * @return {BcmChannel} a new broadcast manager channel or exception
+ * @for exports
+ */
+export function createBcmChannel(channel: string): can.BcmChannel {
+	return new can.BcmChannel(channel);
+}
+
+/**
+ * @method createIsoTpChannel
+ * @param channel {string} Channel name (e.g. vcan0)
+ * @param options {Object} txId, rxId and flow control options
+ * @return {IsoTpChannel} a new ISO-TP channel or exception
+ * @for exports
+ */
+export function createIsoTpChannel(
+	channel: string,
+	options: can.IsoTpOptions,
+): can.IsoTpChannel {
+	return new can.IsoTpChannel(channel, options);
+}
+
+/**
+ * @method createJ1939Channel
+ * @param channel {string} Channel name (e.g. vcan0)
+ * @param options {Object} Optional, binding; with node and no name the NAME is taken from
+ *                the node's J1939 definition of the network description
+ * @return {J1939Channel} a new J1939 channel or exception
+ * @for exports
+ */
+export function createJ1939Channel(
+	channel: string,
+	options?: can.J1939Options & { node?: kcd.Node },
+): can.J1939Channel {
+	const { node, ...binding } = options ?? {};
+
+	if (node && binding.name === undefined) binding.name = node.j1939.getName();
+
+	return new can.J1939Channel(channel, binding);
+}
+
+/**
+ * @method createLogReader
+ * @param path {string} Binary capture written by startRecording()
+ * @param options {Object} Optional, indexFile {bool} keep the index in path.idx (default true)
+ * @return {LogReader} a new reader or exception
+ * @for exports
+ */
+export function createLogReader(
+	path: string,
+	options?: { indexFile?: boolean },
+): can.LogReader {
+	return new can.LogReader(path, options);
+}
+
+/**
+ * Decode one signal of a message from every matching frame of a capture.
+ * @method extractSignal
+ * @param reader {LogReader} capture
+ * @param message {Message} message of a DatabaseService
+ * @param signalName {string} signal of message
+ * @param range {Object} Optional, start, end and limit as for LogReader.query()
+ * @return {Object} tsNs {BigUint64Array} and values {Float64Array}, NaN where the
+ *                  signal is not present due to multiplexing
+ * @for exports
+ */
+export function extractSignal(
+	reader: can.LogReader,
+	message: Message,
+	signalName: string,
+	range?: Omit<can.LogQuery, "ids" | "ext">,
+): { tsNs: BigUint64Array; values: Float64Array } {
+	const signal = message.signals[signalName];
+	if (!signal) throw new Error(`Unknown signal ${signalName}`);
+
+	const batch = reader.query({ ...range, ids: [message.id], ext: message.ext });
+	const values = new Float64Array(batch.count);
+
+	message.layout.decodeColumn(
+		message.signalList.indexOf(signal),
+		batch.data,
+		batch.stride,
+		batch.count,
+		values,
+	);
+
+	return { tsNs: batch.tsNs, values: values };
+}
+
+/**
+ * Set the number of threads receiving for all channels of the calling
+ * thread created with rx_mode "reactor". Can be raised at any time, defaults to 1.
+ * @method setReactorWorkers
+ * @param workers {integer} Number of reactor threads
+ * @for exports
+ */
+export function setReactorWorkers(workers: number) {
+	can.setReactorWorkers(workers);
+}
+
 /**
  * The actual signal.
  * @class Signal
@@ -128,7 +264,11 @@ export function createRawChannelWithOptions(
 export class Signal extends kcd.Signal {
 	readonly muxGroup: number[];
 
-	public value?: number = undefined;
+	private _value?: number = undefined;
+
+	// Owning message and index into its native layout (see Message.signalList)
+	private message?: Message;
+	private index = 0;
 
 	public changeListeners: CallableFunction[] = [];
 	public updateListeners: CallableFunction[] = [];
@@ -157,6 +297,45 @@ export class Signal extends kcd.Signal {
 		this.muxGroup = [desc.mux];
 	}
 
+	/**
+	 * Current value of this signal, undefined until received or set.
+	 * @attribute value
+	 */
+	get value(): number | undefined {
+		return this._value;
+	}
+
+	set value(newValue: number | undefined) {
+		this._value = newValue;
+		if (this.message)
+			this.message.encodeValues[this.index] = newValue ?? NaN;
+	}
+
+	/**
+	 * Called internally by Message to bind this signal to its slot in the
+	 * native message layout.
+	 * @method attach
+	 * @for Signal
+	 */
+	attach(message: Message, index: number) {
+		this.message = message;
+		this.index = index;
+		message.encodeValues[index] = this._value ?? NaN;
+	}
+
+	/**
+	 * Only report changes to onChange listeners that differ from the last
+	 * reported value by more than the given deadband. The larger of both
+	 * limits applies, 0 (the default) reports every change.
+	 * @method setDeadband
+	 * @param absolute Minimum absolute difference
+	 * @param relative Minimum difference relative to the last value (e.g. 0.01 for 1%)
+	 * @for Signal
+	 */
+	setDeadband(absolute: number, relative: number = 0) {
+		this.message?.layout.setDeadband(this.index, absolute, relative);
+	}
+
 	/**
 	 * Keep track of listeners who want to be notified if this signal changes
 	 * @method onChange
@@ -169,13 +348,16 @@ export class Signal extends kcd.Signal {
 	}
 
 	/**
-	 * Keep track of listeners who want to be notified if this signal updates
+	 * Keep track of listeners who want to be notified if this signal updates.
+	 * They are called for every received frame, with a deadband the value
+	 * stays at the last reported one until it is exceeded.
 	 * @method onUpdate
 	 * @param listener JS callback to get notification
 	 * @for Signal
 	 */
 	onUpdate(listener: CallableFunction) {
 		this.updateListeners.push(listener);
+		if (this.message) this.message.signalUpdateListeners++;
 		return listener;
 	}
 
@@ -189,7 +371,10 @@ export class Signal extends kcd.Signal {
 		let idx = this.changeListeners.indexOf(listener);
 		if (idx >= 0) this.changeListeners.splice(idx, 1);
 		idx = this.updateListeners.indexOf(listener);
-		if (idx >= 0) this.updateListeners.splice(idx, 1);
+		if (idx >= 0) {
+			this.updateListeners.splice(idx, 1);
+			if (this.message) this.message.signalUpdateListeners--;
+		}
 	}
 
 	/**
@@ -201,6 +386,20 @@ export class Signal extends kcd.Signal {
 	 * @for Signal
 	 */
 	update(newValue: number) {
+		// Received values are compared against this one from now on
+		this.message?.layout.setShadow(this.index, newValue);
+		this.notify(newValue, this.value !== newValue);
+	}
+
+	/**
+	 * Called internally with the result of change detection (native deadband
+	 * for received frames) to notify listeners. Only a change sets the value,
+	 * so onUpdate listeners of a value within the deadband see the last
+	 * reported one.
+	 * @method notify
+	 * @for Signal
+	 */
+	notify(newValue: number, changed: boolean) {
 		// TODO: Move this block to a `Value.isValid(v)` function?
 		if (this.maxValue && newValue > this.maxValue) {
 			console.error(
@@ -214,8 +413,8 @@ export class Signal extends kcd.Signal {
 			);
 		}
 
-		const changed = this.value !== newValue;
-		this.value = newValue;
+		// Within the deadband the last reported value is kept
+		if (changed) this.value = newValue;
 
 		// Update all updateListeners, that the signal updated
 		this.updateListeners.forEach((listener) => {
@@ -246,9 +445,23 @@ export class Message {
 	readonly muxed: boolean;
 	readonly mux: kcd.Mux | undefined;
 	readonly signals: Record<string, Signal> = {};
+	readonly signalList: Signal[];
+	readonly layout: _signals.MessageLayout;
+	readonly decodedValues: Float64Array;
+	readonly decodedActive: Uint8Array;
+	readonly decodedChanged: Uint8Array;
+	readonly encodeValues: Float64Array;
+	readonly txFrame: can.Message;
+
+	// Broadcast manager running the kernel TX job of this message, if any
+	public cyclic: can.BcmChannel | undefined;
 
 	public updateListeners: CallableFunction[] = [];
 
+	// Number of onUpdate listeners over all signals, signals that did not
+	// change are only handed to JS while there are any.
+	public signalUpdateListeners = 0;
+
 	constructor(msgDef: kcd.Message) {
 		/**
 		 * CAN identifier
@@ -317,6 +530,59 @@ export class Message {
 				this.signals[s.name] = new Signal(s);
 			}
 		});
+
+		/**
+		 * Signals in the order used by the native decode plan
+		 *
+		 * @attribute signalList
+		 * @final
+		 */
+		this.signalList = Object.values(this.signals);
+
+		/**
+		 * Native decode plan compiled from the signal definitions, decodes all
+		 * signals of a frame in one call.
+		 *
+		 * @attribute layout
+		 * @final
+		 */
+		this.layout = new _signals.MessageLayout(
+			this.signalList.map((s) => ({
+				bitOffset: s.bitOffset,
+				bitLength: s.bitLength,
+				littleEndian: s.endianess === "little",
+				type: signalTypeCode(s.type),
+				slope: s.slope,
+				intercept: s.intercept,
+				muxGroup: s.muxGroup,
+			})),
+			this.muxed,
+			this.mux,
+		);
+
+		// Reused by every decode() call, indexed like signalList
+		this.decodedValues = new Float64Array(this.signalList.length);
+		this.decodedActive = new Uint8Array(this.signalList.length);
+		this.decodedChanged = new Uint8Array((this.signalList.length + 7) >> 3);
+
+		// Current signal values as seen by the native encoder (NaN = no value)
+		this.encodeValues = new Float64Array(this.signalList.length);
+		this.signalList.forEach((s, i) => s.attach(this, i));
+
+		/**
+		 * Frame reused by every DatabaseService.send() of this message.
+		 *
+		 * @attribute txFrame
+		 * @final
+		 */
+		this.txFrame = {
+			id: this.id,
+			ext: this.ext,
+			rtr: false,
+			// for CANFD data buffer 64 bytes
+			data:
+				this.len > 0 && this.len < 64 ? Buffer.alloc(this.len) : Buffer.alloc(64),
+		};
 	}
 
 	/**
@@ -373,13 +639,14 @@ export class DatabaseService {
 		busDef.messages.forEach((m) => {
 			const id = m.id | ((m.ext ? 1 : 0) << 31);
 
+			// Subscribe to the messages of the bus only, others never reach JS
+			if (!this.messages[id])
+				channel.addIdListener(m.id, m.ext, this.onMessage, this);
+
 			const nm = new Message(m);
 			this.messages[id] = nm;
 			this.messages[m.name] = nm;
 		});
-
-		// Subscribe to any incoming messages
-		channel.addListener("onMessage", this.onMessage, this);
 	}
 
 	// Callback for incoming messages
@@ -397,43 +664,34 @@ export class DatabaseService {
 			return;
 		}
 
-		let mux_count = -1;
-
-		if (m.muxed && m.mux) {
-			const b_mux = _signals.decodeSignal(
-				msg.data,
-				m.mux.offset,
-				m.mux.length,
-				true,
-				false,
-			);
-			mux_count = b_mux[0] + (b_mux[1] << 32);
-		}
-
-		// Let the C-Portition extract and convert the signal
-		for (const i in m.signals) {
-			const s = m.signals[i];
+		// Let the C-Portition extract and convert all signals at once and
+		// compare them against the last reported values
+		m.layout.decode(
+			msg.data,
+			m.decodedValues,
+			m.decodedActive,
+			m.decodedChanged,
+		);
 
-			// if this is a mux signal and the muxor isnt in my list...
-			if (m.muxed && s.muxGroup.indexOf(mux_count) == -1) {
-				continue;
-			}
+		const count = m.signalList.length;
 
-			const ret = _signals.decodeSignal(
-				msg.data,
-				s.bitOffset,
-				s.bitLength,
-				s.endianess === "little",
-				signalTypeCode(s.type),
-			);
+		for (let base = 0; base < count; base += 8) {
+			const bits = m.decodedChanged[base >> 3];
 
-			let val = ret[0] + (ret[1] << 32);
+			// Unchanged signals are of interest to onUpdate listeners only
+			if (!bits && !m.signalUpdateListeners) continue;
 
-			if (s.slope) val *= s.slope;
+			const end = Math.min(base + 8, count);
+			for (let i = base; i < end; i++) {
+				// if this is a mux signal and the muxor isnt in my list...
+				if (!m.decodedActive[i]) continue;
 
-			if (s.intercept) val += s.intercept;
+				const s = m.signalList[i];
+				const changed = (bits & (1 << (i - base))) !== 0;
 
-			s.update(val);
+				if (changed || s.updateListeners.length)
+					s.notify(m.decodedValues[i], changed);
+			}
 		}
 
 		// Let the message listener know that the message was received.
@@ -445,88 +703,69 @@ export class DatabaseService {
 	 * the rules. Finally send the message to the bus.
 	 * @method send
 	 * @param msg_name Name of the message to generate (indicate mux by append .MUX_VALUE in hex)
+	 * @param mux Optional multiplexor value, alternative to the .MUX_VALUE suffix
 	 * @for DatabaseService
 	 */
-	send(msg_name: string) {
-		const args = msg_name.split("."); // allow for mux'ed messages sent.
+	send(msg_name: string, mux?: number) {
+		let m = this.messages[msg_name];
 
-		const m = this.messages[args[0]];
-		const mux = args.length > 1 ? args[1] : undefined;
+		if (!m) {
+			// allow for mux'ed messages sent.
+			const args = msg_name.split(".");
+			m = this.messages[args[0]];
+			if (args.length > 1) mux = parseInt(args[1], 16);
+		}
 
 		if (!m) throw msg_name + " not defined";
 
-		const canmsg = {
-			id: m.id,
-			ext: m.ext,
-			rtr: false,
-			// for CANFD data buffer 64 bytes
-			data: m.len > 0 && m.len < 64 ? Buffer.alloc(m.len) : Buffer.alloc(64),
-		};
+		// One native call applies scaling, rounding and bit placement of all
+		// signals and clears the reused frame buffer beforehand.
+		m.layout.encode(m.encodeValues, mux ?? -1, m.txFrame.data);
 
-		canmsg.data.fill(0); // should be 0xFF for j1939 message def.
+		// A cyclic message only gets its content patched, the kernel keeps the timing
+		if (m.cyclic) m.cyclic.updateCyclic(m.txFrame);
+		else this.channel.send(m.txFrame);
+	}
 
-		if (mux && m.mux)
-			_signals.encodeSignal(
-				canmsg.data,
-				m.mux.offset,
-				m.mux.length,
-				true,
-				false,
-				parseInt(mux, 16),
-			);
+	/**
+	 * Let the kernel broadcast manager send a message cyclically with its
+	 * current signal values. Later send() calls for the message update the
+	 * content of the running job instead of sending once.
+	 * @method startCyclic
+	 * @param msg_name Name of the message
+	 * @param bcm Broadcast manager channel (see createBcmChannel) on the same interface
+	 * @param interval Optional cycle time in ms, defaults to the interval of the KCD definition
+	 * @for DatabaseService
+	 */
+	startCyclic(msg_name: string, bcm: can.BcmChannel, interval?: number) {
+		const m = this.messages[msg_name];
 
-		Object.values(m.signals).forEach((s) => {
-			if (s.value == undefined) return;
+		if (!m) throw msg_name + " not defined";
 
-			if (mux) {
-				if (s.muxGroup.indexOf(parseInt(mux, 16)) === -1) {
-					return;
-				}
-			}
+		interval = interval ?? m.interval;
+		if (!(interval > 0)) throw msg_name + " has no interval";
 
-			let val = s.value!;
+		if (m.cyclic && m.cyclic !== bcm) m.cyclic.stopCyclic(m.id, m.ext);
 
-			// Apply scaling (slope/intercept).  For float/double signals these are
-			// typically 1/0 and the division/subtraction is a no-op, but we honour
-			// them if the KCD definition carries non-default values.
-			val -= s.intercept;
-			val /= s.slope;
+		m.layout.encode(m.encodeValues, -1, m.txFrame.data);
+		bcm.setupCyclic(m.txFrame, interval);
+		m.cyclic = bcm;
+	}
 
-			if (m.len == 0) {
-				return;
-			}
+	/**
+	 * Stop the cyclic transmission started with startCyclic()
+	 * @method stopCyclic
+	 * @param msg_name Name of the message
+	 * @for DatabaseService
+	 */
+	stopCyclic(msg_name: string) {
+		const m = this.messages[msg_name];
 
-			const typeCode = signalTypeCode(s.type);
-
-			if (isFloatSignal(s.type)) {
-				// Pass the floating-point value directly; the native addon handles
-				// the IEEE-754 bit reinterpretation and byte-order placement.
-				_signals.encodeSignal(
-					canmsg.data,
-					s.bitOffset,
-					s.bitLength,
-					s.endianess === "little",
-					typeCode,
-					val,
-				);
-			} else {
-				// Integer path: round and split into two 32-bit words.
-				val = Math.round(val);
-				const word1 = val & UINT32_MAX;
-				const word2 = val > UINT32_MAX ? val / TWO_TO_32 : 0;
-				_signals.encodeSignal(
-					canmsg.data,
-					s.bitOffset,
-					s.bitLength,
-					s.endianess === "little",
-					typeCode,
-					word1,
-					word2,
-				);
-			}
-		});
+		if (!m) throw msg_name + " not defined";
+		if (!m.cyclic) return;
 
-		this.channel.send(canmsg);
+		m.cyclic.stopCyclic(m.id, m.ext);
+		m.cyclic = undefined;
 	}
 }
 
@@ -538,3 +777,4 @@ export class DatabaseService {
  */
 export const parseNetworkDescription = kcd.parseKcdFile;
 export { kcd };
+export * from "./shared_ring";
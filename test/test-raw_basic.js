@@ -11,6 +11,13 @@ describe('RawChannel', function() {
 
         assert.throws(function() { channel.stop(); });
 
+        // vcan has no hardware timestamps, the channel falls back to software ones
+        var hw = can.createRawChannelWithOptions("vcan0", { timestamps: "hardware" });
+        hw.start();
+        hw.stop();
+
+        assert.throws(function() { can.createRawChannelWithOptions("vcan0", { timestamps: "sundial" }); });
+
         done();
     });
 
@@ -97,6 +104,7 @@ describe('RawChannel', function() {
         c1.addListener("onMessage", function(msg) {
             assert.equal(msg.data[0], rx_count);
             assert.ok(msg.ts_sec !== undefined)
+            assert.equal(msg.ts_ns / 1000000000n, BigInt(msg.ts_sec));
             rx_count++;
         });
 
@@ -115,4 +123,833 @@ describe('RawChannel', function() {
             done();
         }, 100);
     });
+
+    it('should keep frame order when the receive ring wraps', function(done) {
+        var c1 = can.createRawChannelWithOptions("vcan0", { rx_ring_size: 64 });
+        var c2 = can.createRawChannelWithOptions("vcan0", { non_block_send: true });
+
+        c1.start();
+        c2.start();
+
+        var canmsg = { id: 11, data: Buffer.alloc(2) };
+
+        var rx_count = 0;
+
+        c1.addListener("onMessage", function(msg) {
+            assert.equal(msg.data.readUInt16LE(0), rx_count);
+            rx_count++;
+        });
+
+        // More frames than ring slots while the event loop is blocked by this loop
+        for (var i = 0; i < 200; i++) {
+            canmsg.data.writeUInt16LE(i, 0);
+            c2.send(canmsg);
+        }
+
+        setTimeout(function() {
+            assert.equal(rx_count, i);
+            c1.stop();
+            c2.stop();
+
+            done();
+        }, 200);
+    });
+
+    it('should deliver frames as columnar batches', function(done) {
+        var c1 = can.createRawChannelWithOptions("vcan0", { timestamps: true });
+        var c2 = can.createRawChannelWithOptions("vcan0", { non_block_send: true });
+
+        c1.start();
+        c2.start();
+
+        var rx_count = 0;
+
+        c1.addListener("onBatch", function(batch) {
+            assert.equal(batch.ids.length, batch.count);
+            assert.equal(batch.data.length, batch.count * batch.stride);
+
+            for (var i = 0; i < batch.count; i++) {
+                assert.equal(batch.ids[i], 0x1234567);
+                assert.equal(batch.flags[i] & can.FrameFlags.EXT, can.FrameFlags.EXT);
+                assert.equal(batch.lens[i], 3);
+                assert.ok(batch.tsNs[i] > 0n);
+                assert.equal(batch.data[i * batch.stride], rx_count & 0xFF);
+                rx_count++;
+            }
+        });
+
+        for (var i = 0; i < 50; i++)
+            c2.send({ id: 0x1234567, ext: true, data: Buffer.from([ i, 1, 2 ]) });
+
+        setTimeout(function() {
+            assert.equal(rx_count, i);
+            c1.stop();
+            c2.stop();
+
+            done();
+        }, 100);
+    });
+
+    it('should not hand frames to onBatch again when onMessage throws', function(done) {
+        var c1 = can.createRawChannelWithOptions("vcan0", {});
+        var c2 = can.createRawChannelWithOptions("vcan0", {});
+
+        // The exception is reported through process 'uncaughtException', keep it from mocha
+        var handlers = process.listeners('uncaughtException');
+        var errors = 0;
+
+        process.removeAllListeners('uncaughtException');
+        process.on('uncaughtException', function() { errors++; });
+
+        c1.start();
+        c2.start();
+
+        var batched = 0;
+        var messages = 0;
+
+        c1.addListener("onBatch", function(batch) { batched += batch.count; });
+        c1.addListener("onMessage", function(msg) {
+            if (messages++ == 2)
+                throw new Error("listener failure");
+        });
+
+        for (var i = 0; i < 10; i++)
+            c2.send({ id: 0x210, data: Buffer.from([ i ]) });
+
+        setTimeout(function() {
+            process.removeAllListeners('uncaughtException');
+            handlers.forEach(function(handler) { process.on('uncaughtException', handler); });
+
+            assert.equal(errors, 1);
+            assert.equal(batched, 10);
+            assert.equal(messages, 10);
+            assert.equal(c1.getStats().callbackErrors, 1);
+
+            c1.stop();
+            c2.stop();
+
+            done();
+        }, 100);
+    });
+
+    it('should send a batch of frames with sendBatch()', function(done) {
+        var c1 = can.createRawChannelWithOptions("vcan0", {});
+        var c2 = can.createRawChannelWithOptions("vcan0", {});
+
+        c1.start();
+        c2.start();
+
+        var frames = [];
+        for (var i = 0; i < 20; i++)
+            frames.push({ id: 0x300 + i, ext: i % 2 == 1, data: Buffer.from([ i, 0x55 ]) });
+
+        var received = [];
+        c1.addListener("onMessage", function(msg) { received.push(msg); });
+
+        assert.equal(c2.sendBatch(frames), frames.length);
+
+        // Same frames again, this time in the packed onBatch layout
+        var packed = {
+            count: frames.length,
+            stride: 8,
+            ids: new Uint32Array(frames.length),
+            flags: new Uint8Array(frames.length),
+            lens: new Uint8Array(frames.length),
+            data: new Uint8Array(frames.length * 8)
+        };
+        frames.forEach(function(f, i) {
+            packed.ids[i] = f.id;
+            packed.flags[i] = f.ext ? can.FrameFlags.EXT : 0;
+            packed.lens[i] = f.data.length;
+            packed.data.set(f.data, i * 8);
+        });
+
+        assert.equal(c2.sendBatch(packed), frames.length);
+
+        setTimeout(function() {
+            assert.equal(received.length, 2 * frames.length);
+            for (var i = 0; i < frames.length; i++) {
+                assert.equal(received[i].id, frames[i].id);
+                assert.equal(!!received[frames.length + i].ext, frames[i].ext);
+                assert.deepEqual(received[frames.length + i].data, frames[i].data);
+            }
+
+            assert.throws(function() { c2.sendBatch([ { id: 1, data: Buffer.alloc(9) } ]); });
+
+            c1.stop();
+            c2.stop();
+
+            done();
+        }, 100);
+    });
+
+    it('should send frames given as plain values with sendRaw()', function(done) {
+        var c1 = can.createRawChannel("vcan0");
+        var c2 = can.createRawChannel("vcan0");
+
+        c1.start();
+        c2.start();
+
+        var received = [];
+        c1.addListener("onMessage", function(msg) { received.push(msg); });
+
+        var payload = Buffer.from([ 0xAA, 0x01, 0x02, 0x03, 0xBB ]);
+
+        c2.sendRaw(0x123, 0, payload);
+        c2.sendRaw(0x1ABCDEF, can.FrameFlags.EXT, payload, 1, 3);
+
+        assert.throws(function() { c2.sendRaw(1, 0, Buffer.alloc(9)); });
+        assert.throws(function() { c2.sendRaw(1, 0, payload, 4, 2); });
+
+        setTimeout(function() {
+            assert.equal(received.length, 2);
+            assert.equal(received[0].id, 0x123);
+            assert.deepEqual(received[0].data, payload);
+            assert.equal(received[1].id, 0x1ABCDEF);
+            assert.ok(received[1].ext);
+            assert.deepEqual(received[1].data, Buffer.from([ 0x01, 0x02, 0x03 ]));
+
+            c1.stop();
+            c2.stop();
+
+            done();
+        }, 100);
+    });
+
+    it('should send RTR, FD and BRS frames with sendRaw()', function(done) {
+        var c1 = can.createRawChannel("vcan0");
+        var c2 = can.createRawChannel("vcan0");
+
+        c1.start();
+        c2.start();
+
+        var received = [];
+
+        c1.addListener("onBatch", function(batch) {
+            for (var i = 0; i < batch.count; i++) {
+                received.push({
+                    id: batch.ids[i],
+                    flags: batch.flags[i],
+                    data: Buffer.from(batch.data.subarray(i * batch.stride, i * batch.stride + batch.lens[i]))
+                });
+            }
+        });
+
+        var payload = Buffer.from([ 0, 1, 2, 3, 4, 5, 6, 7, 8, 9 ]);
+
+        c2.sendRaw(0x201, can.FrameFlags.RTR, Buffer.alloc(0));
+        c2.sendRaw(0x202, can.FrameFlags.FD, payload);
+        c2.sendRaw(0x203, can.FrameFlags.FD | can.FrameFlags.BRS, payload, 2, 4);
+
+        assert.throws(function() { c2.sendRaw("0x204", 0, payload); });
+        assert.throws(function() { c2.sendRaw(0x204, undefined, payload); });
+
+        setTimeout(function() {
+            assert.equal(received.length, 3);
+
+            assert.equal(received[0].id, 0x201);
+            assert.equal(received[0].flags, can.FrameFlags.RTR);
+
+            // 10 bytes are padded with zeroes to the next valid CAN FD length
+            assert.equal(received[1].id, 0x202);
+            assert.equal(received[1].flags, can.FrameFlags.FD);
+            assert.deepEqual(received[1].data, Buffer.concat([ payload, Buffer.alloc(2) ]));
+
+            assert.equal(received[2].id, 0x203);
+            assert.equal(received[2].flags, can.FrameFlags.FD | can.FrameFlags.BRS);
+            assert.deepEqual(received[2].data, Buffer.from([ 2, 3, 4, 5 ]));
+
+            c1.stop();
+            c2.stop();
+
+            done();
+        }, 100);
+    });
+
+    it('should dispatch frames to listeners of their identifier only', function(done) {
+        var c1 = can.createRawChannelWithOptions("vcan0", {});
+        var c2 = can.createRawChannelWithOptions("vcan0", {});
+
+        c1.start();
+        c2.start();
+
+        var std_rx = [], ext_rx = [], removed_rx = 0, once_rx = 0, after_rx = 0;
+        var removed = function() { removed_rx++; };
+        var once = function() { once_rx++; c1.removeIdListener(0x126, false, once); };
+
+        c1.addIdListener(0x123, false, function(msg) { std_rx.push(msg); });
+        c1.addIdListener(0x123, true, function(msg) { ext_rx.push(msg); });
+        c1.addIdListener(0x124, false, removed);
+        c1.removeIdListener(0x124, false, removed);
+
+        // Removing itself must not skip the next listener
+        c1.addIdListener(0x126, false, once);
+        c1.addIdListener(0x126, false, function() { after_rx++; });
+
+        for (var i = 0; i < 10; i++) {
+            c2.send({ id: 0x123, data: Buffer.from([ i ]) });
+            c2.send({ id: 0x123, ext: true, data: Buffer.from([ i ]) });
+            c2.send({ id: 0x124, data: Buffer.from([ i ]) });
+            c2.send({ id: 0x125, data: Buffer.from([ i ]) });
+            c2.send({ id: 0x126, data: Buffer.from([ i ]) });
+        }
+
+        setTimeout(function() {
+            assert.equal(std_rx.length, 10);
+            assert.equal(ext_rx.length, 10);
+            assert.equal(removed_rx, 0);
+            assert.equal(once_rx, 1);
+            assert.equal(after_rx, 10);
+
+            for (var i = 0; i < 10; i++) {
+                assert.equal(std_rx[i].data[0], i);
+                assert.ok(!std_rx[i].ext);
+                assert.ok(ext_rx[i].ext);
+            }
+
+            c1.stop();
+            c2.stop();
+
+            done();
+        }, 100);
+    });
+
+    it('should count received and sent frames', function(done) {
+        var c1 = can.createRawChannelWithOptions("vcan0", {});
+        var c2 = can.createRawChannelWithOptions("vcan0", {});
+
+        c1.start();
+        c2.start();
+
+        c1.addListener("onMessage", function(msg) {});
+
+        for (var i = 0; i < 10; i++)
+            c2.send({ id: 0x200, data: Buffer.from([ i, 0, 0 ]) });
+
+        setTimeout(function() {
+            var stats = c1.getStats();
+            assert.equal(stats.rxFrames, 10);
+            assert.equal(stats.rxBytes, 30);
+            assert.equal(stats.rxDropped, 0);
+            assert.equal(stats.wakeupFrames, 10);
+            assert.ok(stats.wakeups >= 1);
+            assert.ok(stats.wakeupFramesMax <= 10);
+            assert.equal(stats.callbackErrors, 0);
+
+            assert.equal(c2.getStats().txFrames, 10);
+
+            c1.resetStats();
+            assert.equal(c1.getStats().rxFrames, 0);
+            assert.equal(c1.getStats().wakeupFramesMax, 0);
+
+            c1.stop();
+            c2.stop();
+
+            done();
+        }, 100);
+    });
+
+    it('should measure receive latency when enabled', function(done) {
+        var c1 = can.createRawChannelWithOptions("vcan0", { timestamps: true });
+        var c2 = can.createRawChannelWithOptions("vcan0", {});
+
+        c1.start();
+        c2.start();
+
+        // Frames reaching both onBatch and onMessage still count once
+        c1.addListener("onMessage", function(msg) {});
+        c1.addListener("onBatch", function(batch) {});
+
+        c2.send({ id: 0x201, data: Buffer.from([ 1 ]) });
+
+        setTimeout(function() {
+            // Nothing recorded while disabled
+            assert.equal(c1.getLatencyHistograms().dispatchToReturn.count, 0);
+
+            c1.enableLatencyHistograms();
+
+            for (var i = 0; i < 20; i++)
+                c2.send({ id: 0x201, data: Buffer.from([ i ]) });
+
+            setTimeout(function() {
+                var h = c1.getLatencyHistograms();
+
+                assert.equal(h.kernelToThread.count, 20);
+                assert.equal(h.threadToDispatch.count, 20);
+                assert.equal(h.dispatchToReturn.count, 20);
+                assert.ok(h.threadToDispatch.p50 <= h.threadToDispatch.p99);
+                assert.ok(h.threadToDispatch.p99 <= h.threadToDispatch.max);
+
+                c1.resetLatencyHistograms();
+                assert.equal(c1.getLatencyHistograms().threadToDispatch.count, 0);
+
+                c1.stop();
+                c2.stop();
+
+                done();
+            }, 100);
+        }, 50);
+    });
+
+    it('should receive without reader thread in poll mode', function(done) {
+        var c1 = can.createRawChannelWithOptions("vcan0", { timestamps: true, rx_mode: "poll" });
+        var c2 = can.createRawChannelWithOptions("vcan0", { non_block_send: true });
+
+        assert.throws(function() { can.createRawChannelWithOptions("vcan0", { rx_mode: "carrier_pigeon" }); });
+
+        c1.start();
+        c2.start();
+
+        var rx_count = 0;
+
+        c1.addListener("onMessage", function(msg) {
+            assert.equal(msg.data[0], rx_count);
+            assert.ok(msg.ts_ns > 0n);
+            rx_count++;
+        });
+
+        c1.addListener("onStopped", function() {
+            assert.equal(rx_count, 150);
+            c2.stop();
+            done();
+        });
+
+        for (var i = 0; i < 150; i++)
+            c2.send({ id: 12, data: Buffer.from([ i ]) });
+
+        setTimeout(function() { c1.stop(); }, 100);
+    });
+
+    it('should receive on several channels through the shared reactor', function(done) {
+        can.setReactorWorkers(2);
+        assert.throws(function() { can.setReactorWorkers(0); });
+
+        var rx = [ can.createRawChannelWithOptions("vcan0", { rx_mode: "reactor" }),
+                   can.createRawChannelWithOptions("vcan0", { rx_mode: "reactor" }),
+                   can.createRawChannelWithOptions("vcan0", { rx_mode: "reactor", rx_ring_size: 64 }) ];
+        var tx = can.createRawChannelWithOptions("vcan0", { non_block_send: true });
+
+        var rx_count = [ 0, 0, 0 ];
+
+        rx.forEach(function(c, n) {
+            c.addListener("onMessage", function(msg) {
+                assert.equal(msg.data.readUInt16LE(0), rx_count[n]);
+                rx_count[n]++;
+            });
+            c.start();
+        });
+        tx.start();
+
+        // More frames than the smallest ring holds
+        for (var i = 0; i < 300; i++)
+            tx.send({ id: 13, data: Buffer.from([ i & 0xFF, i >> 8 ]) });
+
+        setTimeout(function() {
+            assert.deepEqual(rx_count, [ 300, 300, 300 ]);
+
+            rx.forEach(function(c) { c.stop(); });
+            tx.stop();
+
+            done();
+        }, 200);
+    });
+
+    it('should deliver payloads as views into pooled buffers', function(done) {
+        var rx = can.createRawChannelWithOptions("vcan0", { rx_pooled: true });
+        var tx = can.createRawChannel("vcan0");
+
+        var received = [];
+
+        rx.addListener("onMessage", function(msg) { received.push(msg.data); });
+        rx.start();
+        tx.start();
+
+        for (var i = 0; i < 150; i++)
+            tx.send({ id: 0x55, data: Buffer.from([ i, 0xEE ]) });
+
+        setTimeout(function() {
+            assert.equal(received.length, 150);
+
+            var slabs = new Set();
+            received.forEach(function(data, i) {
+                assert.ok(Buffer.isBuffer(data));
+                assert.equal(data.length, 2);
+                assert.equal(data[0], i);
+                assert.equal(data[1], 0xEE);
+                slabs.add(data.buffer);
+            });
+
+            // Frames of one wakeup share their backing store
+            assert.ok(slabs.size < received.length);
+
+            rx.stop();
+            tx.stop();
+            done();
+        }, 100);
+    });
+
+    it('should send through the native transmit queue', function(done) {
+        assert.throws(function() {
+            can.createRawChannelWithOptions("vcan0", { tx_queue_size: 16, tx_overflow: "drop-all" });
+        });
+
+        var rx = can.createRawChannel("vcan0");
+        var tx = can.createRawChannelWithOptions("vcan0", { tx_queue_size: 16, tx_overflow: "drop-oldest" });
+
+        var received = [];
+
+        rx.addListener("onMessage", function(msg) { received.push(msg.data[0]); });
+        rx.start();
+        tx.start();
+
+        for (var i = 0; i < 200; i++)
+            assert.strictEqual(tx.send({ id: 0x66, data: Buffer.from([ i ]) }), true);
+
+        setTimeout(function() {
+            assert.equal(received.length, 200);
+            received.forEach(function(value, i) { assert.equal(value, i); });
+            assert.equal(tx.getStats().txQueueDropped, 0);
+
+            rx.stop();
+            tx.stop();
+            done();
+        }, 100);
+    });
+
+    it('should record received frames natively', function(done) {
+        var fs = require('fs');
+        var os = require('os');
+        var path = require('path');
+
+        var bin = path.join(os.tmpdir(), "node-can-test-" + process.pid + ".ncanlog");
+        var txt = path.join(os.tmpdir(), "node-can-test-" + process.pid + ".log");
+
+        var rx = can.createRawChannel("vcan0", true);
+        var rx2 = can.createRawChannelWithOptions("vcan0", { rx_mode: "poll" });
+        var tx = can.createRawChannel("vcan0");
+
+        rx.start();
+        rx2.start();
+        tx.start();
+
+        rx.startRecording(bin);
+        rx2.startRecording(txt, { format: "candump" });
+        assert.throws(function() { rx.startRecording(bin); });
+
+        for (var i = 0; i < 100; i++)
+            tx.send({ id: 0x100 + i, ext: i == 99, data: Buffer.from([ i, 0xAB ]) });
+
+        setTimeout(function() {
+            rx.flushRecording();
+            assert.equal(rx.getRecordingStats().written, 100);
+
+            var stats = rx.stopRecording();
+            assert.equal(stats.dropped, 0);
+            assert.equal(stats.files, 1);
+
+            var log = fs.readFileSync(bin);
+            assert.equal(log.toString("latin1", 0, 7), "NCANLOG");
+            assert.equal(log.length, 16 + 100 * 24);
+
+            // Records: ts_ns u64, can_id u32, len u8, flags u8, 2 reserved, data padded to 8
+            for (var i = 0; i < 100; i++) {
+                var rec = 16 + i * 24;
+                assert.ok(log.readBigUInt64LE(rec) > 0n);
+                assert.equal(log.readUInt32LE(rec + 8), ((0x100 + i) | (i == 99 ? 0x80000000 : 0)) >>> 0);
+                assert.equal(log[rec + 12], 2);
+                assert.equal(log[rec + 16], i);
+            }
+
+            assert.equal(rx2.stopRecording().written, 100);
+
+            var lines = fs.readFileSync(txt, "latin1").trim().split("\n");
+            assert.equal(lines.length, 100);
+            assert.ok(/^\(\d{10}\.\d{6}\) vcan0 100#00AB$/.test(lines[0]), lines[0]);
+            assert.ok(/ 00000163#63AB$/.test(lines[99]), lines[99]);
+
+            fs.unlinkSync(bin);
+            fs.unlinkSync(txt);
+
+            rx.stop();
+            rx2.stop();
+            tx.stop();
+            done();
+        }, 100);
+    });
+
+    it('should replay a capture with its original timing', function(done) {
+        var fs = require('fs');
+        var os = require('os');
+        var path = require('path');
+
+        var log = path.join(os.tmpdir(), "node-can-replay-" + process.pid + ".log");
+        var lines = [];
+
+        // 20 frames 5 ms apart, the first pass of which is replayed at double speed
+        for (var i = 0; i < 20; i++)
+            lines.push("(1700000000." + ("000000" + i * 5000).slice(-6) + ") vcan0 1A0#" + ("0" + i.toString(16)).slice(-2).toUpperCase());
+        fs.writeFileSync(log, lines.join("\n") + "\n");
+
+        var rx = can.createRawChannel("vcan0");
+        var tx = can.createRawChannel("vcan0");
+
+        var received = [];
+
+        rx.addListener("onMessage", function(msg) { received.push(msg); });
+        rx.start();
+
+        assert.throws(function() { tx.startReplay("/nonexistent/capture"); });
+        assert.throws(function() { tx.startReplay(log, { remap: { "0x1A0z": 0x2A0 } }); });
+        assert.throws(function() { tx.startReplay(log, { remap: { "0x18FEF100": 0x2A0 } }); });
+
+        tx.addListener("onReplayDone", function(stats) {
+            assert.equal(stats.sent, 40);
+            assert.equal(stats.loops, 2);
+            assert.equal(stats.stopped, false);
+            assert.equal(stats.timingError.count, 40);
+            // Two passes of 95 ms plus the 5 ms frame spacing between them, at double speed
+            assert.ok(stats.duration >= 97, "duration " + stats.duration);
+
+            setTimeout(function() {
+                assert.equal(received.length, 40);
+                // The 29 bit key leaves the 11 bit frames alone
+                received.forEach(function(msg) { assert.equal(msg.id, 0x2A0); });
+                assert.equal(received[39].data[0], 19);
+
+                fs.unlinkSync(log);
+                rx.stop();
+                done();
+            }, 20);
+        });
+
+        tx.startReplay(log, { speed: 2, loop: 2, remap: { "0x1A0": 0x2A0, "0x800001A0": 0x3A0 } });
+        assert.throws(function() { tx.startReplay(log); });
+    });
+});
+
+describe('BcmChannel', function() {
+    it('should send cyclically from the kernel', function(done) {
+        assert.throws(function() { can.createBcmChannel("non_existant_channel"); });
+
+        var bcm = can.createBcmChannel("vcan0");
+        var rx = can.createRawChannel("vcan0", true);
+
+        var rx_data = [];
+
+        rx.addListener("onMessage", function(msg) {
+            if (msg.id == 0x321)
+                rx_data.push(msg.data[0]);
+        });
+        rx.start();
+
+        bcm.setupCyclic({ id: 0x321, data: Buffer.from([ 1, 2 ]) }, 10);
+
+        setTimeout(function() {
+            bcm.updateCyclic({ id: 0x321, data: Buffer.from([ 7, 2 ]) });
+        }, 55);
+
+        setTimeout(function() {
+            bcm.stopCyclic(0x321);
+            var count = rx_data.length;
+
+            // About one frame per 10 ms, patched content without restarting the job
+            assert.ok(count >= 6 && count <= 13, "received " + count);
+            assert.equal(rx_data[0], 1);
+            assert.equal(rx_data[count - 1], 7);
+
+            setTimeout(function() {
+                assert.equal(rx_data.length, count);
+                rx.stop();
+                bcm.close();
+                done();
+            }, 30);
+        }, 105);
+    });
+
+    it('should report content changes and timeouts only', function(done) {
+        var bcm = can.createBcmChannel("vcan0");
+        var tx = can.createRawChannel("vcan0");
+
+        var changes = [];
+        var timeouts = 0;
+
+        bcm.addListener("onMessage", function(msg) {
+            assert.equal(msg.id, 0x322);
+            changes.push(msg.data[0]);
+        });
+        bcm.addListener("onTimeout", function(msg) {
+            assert.equal(msg.id, 0x322);
+            timeouts++;
+        });
+
+        // Only the first byte is watched
+        bcm.setupRx(0x322, { mask: Buffer.from([ 0xFF, 0x00 ]), timeout: 50 });
+        tx.start();
+
+        [ 1, 1, 1, 2, 2, 3 ].forEach(function(v, i) {
+            tx.send({ id: 0x322, data: Buffer.from([ v, i ]) });
+        });
+
+        setTimeout(function() {
+            assert.deepEqual(changes, [ 1, 2, 3 ]);
+            assert.equal(timeouts, 1);
+
+            tx.stop();
+            bcm.close();
+            done();
+        }, 100);
+    });
+});
+
+describe('LogReader', function() {
+    it('should query a recorded capture by time and identifier', function(done) {
+        var fs = require('fs');
+        var os = require('os');
+        var path = require('path');
+
+        var bin = path.join(os.tmpdir(), "node-can-reader-" + process.pid + ".ncanlog");
+
+        var rx = can.createRawChannel("vcan0", true);
+        var tx = can.createRawChannel("vcan0");
+
+        rx.start();
+        tx.start();
+        rx.startRecording(bin);
+
+        // CruiseControlStatus (0x37F) carries SpeedKm as signed byte 0
+        for (var i = 0; i < 100; i++)
+            tx.send({ id: i % 2 ? 0x37F : 0x100, ext: false, data: Buffer.from([ 256 - i, i ]) });
+
+        setTimeout(function() {
+            rx.stopRecording();
+            rx.stop();
+            tx.stop();
+
+            assert.throws(function() { can.createLogReader("/nonexistent/capture"); });
+
+            var reader = can.createLogReader(bin);
+            var info = reader.info();
+            assert.equal(info.frames, 100);
+            assert.equal(info.ids, 2);
+            assert.equal(info.indexLoaded, false);
+            assert.ok(fs.existsSync(bin + ".idx"));
+            assert.equal(can.createLogReader(bin).info().indexLoaded, true);
+
+            var batch = reader.query({ ids: [ 0x37F ] });
+            assert.equal(batch.count, 50);
+            assert.equal(batch.ids[0], 0x37F);
+            assert.equal(batch.data[batch.stride], 256 - 3);
+
+            // Payloads are also reachable in place
+            var mapped = new Uint8Array(reader.buffer());
+            assert.equal(mapped[batch.offsets[1] + 1], 3);
+            assert.strictEqual(reader.buffer(), mapped.buffer);
+
+            var later = reader.query({ start: batch.tsNs[10], limit: 5 });
+            assert.equal(later.count, 5);
+            assert.equal(later.tsNs[0], batch.tsNs[10]);
+            assert.equal(reader.query({ ids: [ 0x37F ], ext: true }).count, 0);
+
+            var network = can.parseNetworkDescription("./test/samples.kcd");
+            var db = new can.DatabaseService(rx, network.buses["Motor"]);
+            var speed = can.extractSignal(reader, db.messages["CruiseControlStatus"], "SpeedKm");
+            assert.equal(speed.values.length, 50);
+            assert.equal(speed.values[1], -3);
+
+            // Private mapping, the write neither faults nor reaches the file
+            mapped[batch.offsets[1] + 1] = 0xEE;
+            assert.equal(fs.readFileSync(bin)[batch.offsets[1] + 1], 3);
+
+            fs.unlinkSync(bin);
+            fs.unlinkSync(bin + ".idx");
+            done();
+        }, 100);
+    });
+});
+
+describe('IsoTpChannel', function() {
+    it('should transfer a segmented PDU', function(done) {
+        assert.throws(function() { can.createIsoTpChannel("vcan0", {}); });
+
+        var tester = can.createIsoTpChannel("vcan0", { txId: 0x7E0, rxId: 0x7E8, padding: true });
+        var ecu = can.createIsoTpChannel("vcan0", { txId: 0x7E8, rxId: 0x7E0, blockSize: 8, stMin: 0 });
+
+        var request = Buffer.alloc(4000);
+        for (var i = 0; i < request.length; i++)
+            request[i] = i & 0xff;
+
+        var pending = 2;
+
+        function finish() {
+            if (--pending)
+                return;
+
+            tester.close();
+            ecu.close();
+            assert.throws(function() { tester.send(request); });
+            done();
+        }
+
+        ecu.addListener("onMessage", function(pdu) {
+            assert.deepEqual(pdu, request);
+            ecu.send(Buffer.from([ 0x62, 0xF1, 0x90 ]));
+        });
+
+        tester.addListener("onMessage", function(pdu) {
+            assert.deepEqual(Array.from(pdu), [ 0x62, 0xF1, 0x90 ]);
+            finish();
+        });
+
+        tester.send(request, function(err) {
+            assert.equal(err, null);
+            finish();
+        });
+    });
+});
+
+describe('J1939Channel', function() {
+    it('should transfer parameter groups with addressing', function(done) {
+        var network = can.parseNetworkDescription("./test/samples.kcd");
+
+        var ecu = can.createJ1939Channel("vcan0", { node: network.nodes["12"], addr: 0x20, broadcast: true });
+        // NAME from the node's J1939 definition, the channel claims 0x80 with it before sending
+        var tester = can.createJ1939Channel("vcan0", { node: network.nodes["13"], addr: 0x80 });
+        var testerName = network.nodes["13"].j1939.getName().readBigUInt64LE(0);
+
+        assert.equal(testerName, 0x8000820000001234n);
+
+        assert.throws(function() { can.createJ1939Channel("vcan0", { name: Buffer.alloc(4) }); });
+
+        var payload = Buffer.alloc(100);
+        for (var i = 0; i < payload.length; i++)
+            payload[i] = i;
+
+        ecu.addListener("onMessage", function(msg) {
+            // 100 bytes to a specific address are segmented with CMDT by the kernel
+            assert.equal(msg.pgn, 0xEF00);
+            assert.equal(msg.src, 0x80);
+            assert.equal(msg.srcName, testerName);
+            assert.equal(msg.dest, 0x20);
+            assert.deepEqual(msg.data, payload);
+
+            ecu.send({ pgn: 0xFEF1, data: Buffer.from([ 1, 2, 3, 4, 5, 6, 7, 8 ]), priority: 3 });
+        });
+
+        tester.addListener("onMessage", function(msg) {
+            if (msg.pgn != 0xFEF1)
+                return;
+
+            assert.equal(msg.src, 0x20);
+            assert.equal(msg.dest, 0xFF);
+            assert.equal(msg.priority, 3);
+
+            ecu.close();
+            tester.close();
+            done();
+        });
+
+        tester.send({ pgn: 0xEF00, dest: 0x20, data: payload }, function(err) {
+            assert.equal(err, null);
+        });
+    });
 });
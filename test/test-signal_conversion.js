@@ -326,4 +326,208 @@ describe('signals', function() {
         assert.strictEqual(result[0], 1.0);
         done();
     });
+
+    it('should decode all signals of a message with a MessageLayout', function(done) {
+        var layout = new signals.MessageLayout([
+            { bitOffset: 0,  bitLength: 8,  littleEndian: true,  type: SIGNAL_SIGNED,   slope: 1,   intercept: 0 },
+            { bitOffset: 8,  bitLength: 16, littleEndian: true,  type: SIGNAL_UNSIGNED, slope: 0.5, intercept: -10 },
+            { bitOffset: 32, bitLength: 32, littleEndian: true,  type: SIGNAL_FLOAT32 },
+            { bitOffset: 0,  bitLength: 16, littleEndian: false, type: SIGNAL_UNSIGNED }
+        ], false);
+
+        data = Buffer.from([0xFE, 0x10, 0x00, 0x00, 0x00, 0x00, 0x80, 0x3F]);
+        var values = new Float64Array(4);
+        var active = new Uint8Array(4);
+
+        assert.strictEqual(layout.decode(data, values, active), -1);
+        assert.deepEqual(Array.from(active), [1, 1, 1, 1]);
+        assert.strictEqual(values[0], -2);
+        assert.strictEqual(values[1], 0x10 * 0.5 - 10);
+        assert.strictEqual(values[2], 1.0);
+        assert.strictEqual(values[3], signals.decodeSignal(data, 0, 16, false, SIGNAL_UNSIGNED)[0]);
+
+        done();
+    });
+
+    it('should only decode signals of the active mux group', function(done) {
+        var layout = new signals.MessageLayout([
+            { bitOffset: 8,  bitLength: 8, littleEndian: true, type: SIGNAL_UNSIGNED, muxGroup: [1] },
+            { bitOffset: 16, bitLength: 8, littleEndian: true, type: SIGNAL_UNSIGNED, muxGroup: [2, 3] }
+        ], true, { offset: 0, length: 4 });
+
+        var values = new Float64Array(2);
+        var active = new Uint8Array(2);
+
+        assert.strictEqual(layout.decode(Buffer.from([0x01, 0xAA, 0xBB]), values, active), 1);
+        assert.deepEqual(Array.from(active), [1, 0]);
+        assert.strictEqual(values[0], 0xAA);
+
+        assert.strictEqual(layout.decode(Buffer.from([0x03, 0xAA, 0xBB]), values, active), 3);
+        assert.deepEqual(Array.from(active), [0, 1]);
+        assert.strictEqual(values[1], 0xBB);
+
+        assert.strictEqual(layout.decode(Buffer.from([0x04, 0xAA, 0xBB]), values, active), 4);
+        assert.deepEqual(Array.from(active), [0, 0]);
+
+        assert.throws(function() { layout.decode(Buffer.alloc(8), new Float64Array(1), active); });
+
+        done();
+    });
+
+    it('should encode all signals of a message with a MessageLayout', function(done) {
+        var layout = new signals.MessageLayout([
+            { bitOffset: 0,  bitLength: 8,  littleEndian: true,  type: SIGNAL_SIGNED,   slope: 1,   intercept: 0 },
+            { bitOffset: 8,  bitLength: 16, littleEndian: true,  type: SIGNAL_UNSIGNED, slope: 0.5, intercept: -10 },
+            { bitOffset: 32, bitLength: 32, littleEndian: true,  type: SIGNAL_FLOAT32 },
+            { bitOffset: 24, bitLength: 8,  littleEndian: true,  type: SIGNAL_UNSIGNED }
+        ], false);
+
+        data = Buffer.alloc(8, 0xFF);
+        layout.encode(new Float64Array([-2, 0x10 * 0.5 - 10, 1.0, NaN]), -1, data);
+
+        // NaN signals are left out, the rest of the frame is cleared
+        assert.deepEqual(data, Buffer.from([0xFE, 0x10, 0x00, 0x00, 0x00, 0x00, 0x80, 0x3F]));
+
+        var values = new Float64Array(4);
+        var active = new Uint8Array(4);
+        layout.decode(data, values, active);
+        assert.deepEqual(Array.from(values), [-2, -2, 1.0, 0]);
+
+        done();
+    });
+
+    it('should encode the multiplexor and its mux group only', function(done) {
+        var layout = new signals.MessageLayout([
+            { bitOffset: 8,  bitLength: 8, littleEndian: true, type: SIGNAL_UNSIGNED, muxGroup: [1] },
+            { bitOffset: 16, bitLength: 8, littleEndian: true, type: SIGNAL_UNSIGNED, muxGroup: [2, 3] }
+        ], true, { offset: 0, length: 4 });
+
+        var values = new Float64Array([0xAA, 0xBB]);
+
+        data = Buffer.alloc(3);
+        layout.encode(values, 3, data);
+        assert.deepEqual(data, Buffer.from([0x03, 0x00, 0xBB]));
+
+        layout.encode(values, 1, data);
+        assert.deepEqual(data, Buffer.from([0x01, 0xAA, 0x00]));
+
+        assert.throws(function() { layout.encode(new Float64Array(1), 1, data); });
+
+        done();
+    });
+
+    it('should report changed signals with a deadband', function(done) {
+        var layout = new signals.MessageLayout([
+            { bitOffset: 0,  bitLength: 8,  littleEndian: true, type: SIGNAL_UNSIGNED },
+            { bitOffset: 8,  bitLength: 8,  littleEndian: true, type: SIGNAL_UNSIGNED },
+            { bitOffset: 16, bitLength: 16, littleEndian: true, type: SIGNAL_UNSIGNED }
+        ], false);
+
+        layout.setDeadband(1, 5);
+        layout.setDeadband(2, 0, 0.1);
+
+        var values = new Float64Array(3);
+        var active = new Uint8Array(3);
+        var changed = new Uint8Array(1);
+
+        // First frame reports every signal
+        layout.decode(Buffer.from([1, 100, 0xE8, 0x03]), values, active, changed);
+        assert.strictEqual(changed[0], 0x07);
+
+        layout.decode(Buffer.from([1, 100, 0xE8, 0x03]), values, active, changed);
+        assert.strictEqual(changed[0], 0x00);
+
+        // Within the deadbands (5 absolute, 10% of 1000)
+        layout.decode(Buffer.from([2, 104, 0x4C, 0x04]), values, active, changed);
+        assert.strictEqual(changed[0], 0x01);
+        assert.strictEqual(values[1], 104);
+
+        // Compared against the last reported value, not the last decoded one
+        layout.decode(Buffer.from([2, 106, 0x4D, 0x04]), values, active, changed);
+        assert.strictEqual(changed[0], 0x06);
+
+        // A value set locally becomes the reference, NaN reports the next value again
+        layout.setShadow(1, 50);
+        layout.decode(Buffer.from([2, 53, 0x4D, 0x04]), values, active, changed);
+        assert.strictEqual(changed[0], 0x00);
+
+        layout.setShadow(0, NaN);
+        layout.decode(Buffer.from([2, 53, 0x4D, 0x04]), values, active, changed);
+        assert.strictEqual(changed[0], 0x01);
+
+        assert.throws(function() { layout.setShadow(3, 1); });
+        assert.throws(function() { layout.setDeadband(3, 1); });
+        assert.throws(function() { layout.decode(Buffer.alloc(8), values, active, new Uint8Array(0)); });
+
+        done();
+    });
+
+    it('should decode one signal of many frames with decodeColumn()', function(done) {
+        var layout = new signals.MessageLayout([
+            { bitOffset: 8,  bitLength: 8, littleEndian: true, type: SIGNAL_UNSIGNED, muxGroup: [1], slope: 0.5 },
+            { bitOffset: 16, bitLength: 8, littleEndian: true, type: SIGNAL_UNSIGNED, muxGroup: [2] }
+        ], true, { offset: 0, length: 4 });
+
+        // Three frames with a stride of 8 bytes
+        var data = new Uint8Array(24);
+        data.set([0x01, 10, 20], 0);
+        data.set([0x02, 30, 40], 8);
+        data.set([0x01, 50, 60], 16);
+
+        var values = new Float64Array(3);
+
+        assert.strictEqual(layout.decodeColumn(0, data, 8, 3, values), 2);
+        assert.strictEqual(values[0], 5);
+        assert.ok(isNaN(values[1]));
+        assert.strictEqual(values[2], 25);
+
+        assert.strictEqual(layout.decodeColumn(1, data, 8, 3, values), 1);
+        assert.strictEqual(values[1], 40);
+
+        assert.throws(function() { layout.decodeColumn(2, data, 8, 3, values); });
+        assert.throws(function() { layout.decodeColumn(0, data, 8, 4, new Float64Array(4)); });
+
+        done();
+    });
+
+    it('should decode signal columns like single frames', function(done) {
+        var count = 37, stride = 12;
+        var data = new Uint8Array(count * stride);
+        for (var i = 0; i < data.length; i++)
+            data[i] = (i * 151 + 7) & 0xFF;
+
+        var descs = [
+            { bitOffset: 3,  bitLength: 13, littleEndian: true,  type: SIGNAL_UNSIGNED, slope: 0.5, intercept: -40 },
+            { bitOffset: 20, bitLength: 11, littleEndian: false, type: SIGNAL_SIGNED,   slope: 2 },
+            { bitOffset: 0,  bitLength: 64, littleEndian: true,  type: SIGNAL_UNSIGNED },
+            { bitOffset: 8,  bitLength: 32, littleEndian: false, type: SIGNAL_FLOAT32 }
+        ];
+        var layout = new signals.MessageLayout(descs, false);
+        var expected = new Float64Array(descs.length);
+        var active = new Uint8Array(descs.length);
+
+        var columns = descs.map(function() { return new Float64Array(count); });
+        signals.decodeSignalColumns(data, stride, count, descs, columns);
+
+        descs.forEach(function(d, s) {
+            var column = new Float64Array(count);
+            signals.decodeSignalColumn(data, stride, count, d.bitOffset, d.bitLength, d.littleEndian,
+                                       d.type, column, d.slope, d.intercept);
+
+            for (var i = 0; i < count; i++) {
+                layout.decode(data.subarray(i * stride, (i + 1) * stride), expected, active);
+                assert.ok(Object.is(column[i], expected[s]), 'signal ' + s + ' frame ' + i);
+                assert.ok(Object.is(columns[s][i], expected[s]), 'signal ' + s + ' frame ' + i);
+            }
+        });
+
+        assert.throws(function() {
+            signals.decodeSignalColumn(data, stride, count + 1, 0, 8, true, SIGNAL_UNSIGNED, new Float64Array(count + 1));
+        });
+        assert.throws(function() {
+            signals.decodeSignalColumn(data, stride, count, 60, 8, true, SIGNAL_UNSIGNED, new Float64Array(count));
+        });
+
+        done();
+    });
 });
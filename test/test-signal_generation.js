@@ -87,6 +87,40 @@ describe('Database', function() {
         });
     });
 
+    it('should keep the last reported value within the deadband', function(done) {
+        var db = new can.DatabaseService(channel, network.buses["Motor"]);
+        var signal = db.messages["CruiseControlStatus"].signals["SpeedKm"];
+
+        var cm = { id: db.messages["CruiseControlStatus"].id, data: Buffer.from([ 10 ]) };
+        var changes = [];
+        var updates = [];
+
+        signal.setDeadband(5);
+        signal.onChange(function(s) { changes.push(s.value); });
+        signal.onUpdate(function(s) { updates.push(s.value); });
+
+        gen_channel.send(cm);
+
+        // Within the deadband of 10, onUpdate listeners still see 10
+        cm.data[0] = 12;
+        gen_channel.send(cm);
+
+        setTimeout(function() {
+            // Received values are compared against a locally set one from now on
+            signal.update(50);
+
+            cm.data[0] = 53;
+            gen_channel.send(cm);
+
+            setTimeout(function() {
+                assert.deepEqual(changes, [ 10, 50 ]);
+                assert.deepEqual(updates, [ 10, 10, 50, 50 ]);
+                assert.equal(signal.value, 50);
+                done();
+            }, 50);
+        }, 50);
+    });
+
     it('should receive a transmitted signal', function(done) {
         var rx_db = new can.DatabaseService(channel, network.buses["Motor"]);
         var tx_db = new can.DatabaseService(gen_channel, network.buses["Motor"]);
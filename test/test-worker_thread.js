@@ -4,6 +4,18 @@ var assert = require('assert');
 var { Worker, isMainThread, parentPort, workerData } = require('worker_threads');
 
 // When loaded as a Worker, run the receiver side.
+if (!isMainThread && workerData.mode === 'ring') {
+  var { SharedRingReader } = require('../dist/shared_ring');
+  var reader = new SharedRingReader(workerData.ring);
+  var ids = [];
+  parentPort.postMessage({ type: 'ready' });
+  while (ids.length < workerData.count && reader.wait(2000)) {
+    reader.read(function(frame) { ids.push(frame.id); });
+  }
+  parentPort.postMessage({ type: 'ring', ids: ids, lost: reader.lost });
+  return;
+}
+
 if (!isMainThread) {
   var can = require('../dist/socketcan');
   var ch = can.createRawChannel(workerData.iface);
@@ -45,4 +57,43 @@ describe('RawChannel in worker_threads', function() {
       });
     });
   });
+
+  it('should broadcast frames to workers through a shared ring', function(done) {
+    var can = require('../dist/socketcan');
+    var ring = can.createSharedRing(64);
+    var rx = can.createRawChannel('vcan0');
+    var tx = can.createRawChannel('vcan0');
+    rx.attachSharedRing(new Int32Array(ring));
+    rx.start();
+    tx.start();
+
+    var count = 16;
+    var workers = [0, 1].map(function() {
+      return new Worker(__filename, { workerData: { mode: 'ring', ring: ring, count: count } });
+    });
+    var ready = 0;
+    var results = [];
+
+    workers.forEach(function(worker) {
+      worker.on('error', done);
+      worker.on('message', function(msg) {
+        if (msg.type === 'ready' && ++ready === workers.length) {
+          for (var i = 0; i < count; i++)
+            tx.send({ id: 0x100 + i, data: Buffer.from([i]) });
+        } else if (msg.type === 'ring') {
+          results.push(msg);
+          if (results.length < workers.length) return;
+
+          results.forEach(function(result) {
+            assert.equal(result.lost, 0);
+            assert.deepEqual(result.ids, Array.from({ length: count }, function(_, i) { return 0x100 + i; }));
+          });
+          rx.detachSharedRing();
+          rx.stop();
+          tx.stop();
+          done();
+        }
+      });
+    });
+  });
 });